@@ -11,13 +11,13 @@
  */
 
 #include <stdio.h>
-#include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "driver/spi_master.h"
 #include "esp_log.h"
 
 #include "ftb-8-md.h"
+#include "ftb-8-md-scroll.h"
 
 static const char *TAG = "VFD_BASIC";
 
@@ -113,17 +113,14 @@ void app_main(void)
         ftb8md_enter_standby(vfd, false);
         vTaskDelay(pdMS_TO_TICKS(1000));
 
-        /* Scrolling text effect */
+        /* Smooth scrolling text effect, one pixel column per step */
         ESP_LOGI(TAG, "Scrolling text demo...");
-        const char *scroll_text = "   FUTABA 8-MD-06INK VFD DISPLAY DEMO   ";
-        size_t text_len = strlen(scroll_text);
-
-        for (size_t i = 0; i < text_len - 7; i++) {
-            char display_buf[9];
-            strncpy(display_buf, &scroll_text[i], 8);
-            display_buf[8] = '\0';
-            ftb8md_show_string(vfd, 0, display_buf);
-            vTaskDelay(pdMS_TO_TICKS(200));
+        ftb8md_scroll_t scroll;
+        ftb8md_scroll_init(&scroll, "FUTABA 8-MD-06INK VFD DISPLAY DEMO", 1, false);
+
+        while (!ftb8md_scroll_done(&scroll)) {
+            ftb8md_scroll_step(vfd, &scroll, 1);
+            vTaskDelay(pdMS_TO_TICKS(30));
         }
 
         vTaskDelay(pdMS_TO_TICKS(1000));
@@ -7,6 +7,7 @@
  * - Time formatting with blinking colon
  * - Date display
  * - Using decimal points as separators
+ * - Switching to pre-built screens for the mode banners
  */
 
 #include <stdio.h>
@@ -20,6 +21,7 @@
 #include "esp_sntp.h"
 
 #include "ftb-8-md.h"
+#include "ftb-8-md-screen.h"
 
 static const char *TAG = "VFD_CLOCK";
 
@@ -39,6 +41,26 @@ typedef enum {
 
 static spi_device_handle_t vfd_handle = NULL;
 
+/* Mode banners, encoded once at startup */
+static ftb8md_screen_t mode_banners[DISPLAY_MODE_MAX];
+
+/**
+ * @brief Build the banner screen of every display mode
+ */
+static void build_mode_banners(void)
+{
+    static const char *const names[DISPLAY_MODE_MAX] = {
+        [DISPLAY_MODE_TIME_24H] = "24H TIME",
+        [DISPLAY_MODE_TIME_12H] = "12H TIME",
+        [DISPLAY_MODE_DATE] = "  DATE  ",
+    };
+
+    for (int i = 0; i < DISPLAY_MODE_MAX; i++) {
+        ftb8md_screen_clear(&mode_banners[i]);
+        ftb8md_screen_set_string(&mode_banners[i], 0, names[i]);
+    }
+}
+
 /**
  * @brief Display time in 24-hour format: HH.MM.SS
  */
@@ -151,6 +173,7 @@ void app_main(void)
 
     /* Initialize sample time */
     init_sample_time();
+    build_mode_banners();
 
     /* Display startup message */
     ftb8md_clear_display(vfd_handle);
@@ -197,21 +220,8 @@ void app_main(void)
             mode_counter = 0;
             current_mode = (display_mode_t)((current_mode + 1) % DISPLAY_MODE_MAX);
             
-            /* Show mode name briefly */
-            ftb8md_clear_display(vfd_handle);
-            switch (current_mode) {
-                case DISPLAY_MODE_TIME_24H:
-                    ftb8md_show_string(vfd_handle, 0, "24H TIME");
-                    break;
-                case DISPLAY_MODE_TIME_12H:
-                    ftb8md_show_string(vfd_handle, 0, "12H TIME");
-                    break;
-                case DISPLAY_MODE_DATE:
-                    ftb8md_show_string(vfd_handle, 0, "  DATE  ");
-                    break;
-                default:
-                    break;
-            }
+            /* Show mode name briefly; only the digits and dots that differ are sent */
+            ftb8md_screen_show(vfd_handle, &mode_banners[current_mode]);
             vTaskDelay(pdMS_TO_TICKS(1000));
         }
 
@@ -0,0 +1,18 @@
+/**
+ * @file charging_anim.h
+ * @brief Animation compiled from charging.txt.
+ *
+ * Generated by tools/ftb8md_animc.py from charging.txt. Do not edit.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+static const uint8_t charging_anim[] = {
+    0x46, 0x54, 0x42, 0x41, 0x01, 0x01, 0x03, 0x00, 0x2F, 0x00, 0x00, 0x00,
+    0x04, 0x04, 0x03, 0x7E, 0x41, 0x41, 0x41, 0x7E, 0x7E, 0x71, 0x71, 0x71,
+    0x7E, 0x7E, 0x7F, 0x7F, 0x7F, 0x7E, 0x02, 0x00, 0x08, 0x43, 0x48, 0x41,
+    0x52, 0x47, 0x45, 0x20, 0x04, 0x01, 0xF4, 0x01, 0x02, 0x07, 0x01, 0x05,
+    0x01, 0xF4, 0x01, 0x02, 0x07, 0x01, 0x06, 0x01, 0xF4, 0x01, 0x00,
+};
@@ -0,0 +1,47 @@
+/**
+ * @file icons.h
+ * @brief Icons of the custom character example.
+ *
+ * Generated by tools/ftb8md_fontc.py from icons.txt. Do not edit.
+ */
+
+#pragma once
+
+#include "ftb-8-md-font.h"
+
+#define ICON_DEGREE 0x00B0
+#define ICON_ARROW_UP 0x2191
+#define ICON_ARROW_DOWN 0x2193
+#define ICON_SMILEY 0x263A
+#define ICON_HEART 0x2665
+#define ICON_BATTERY_EMPTY 0xE000
+#define ICON_BATTERY_HALF 0xE001
+#define ICON_BATTERY_FULL 0xE002
+
+static const uint32_t s_custom_icons_codepoints[] = {
+    0x00B0, /* degree */
+    0x2191, /* arrow up */
+    0x2193, /* arrow down */
+    0x263A, /* smiley */
+    0x2665, /* heart */
+    0xE000, /* battery empty */
+    0xE001, /* battery half */
+    0xE002, /* battery full */
+};
+
+static const uint8_t s_custom_icons_glyphs[][FTB8MD_GLYPH_COLS] = {
+    {0x02, 0x05, 0x05, 0x02, 0x00}, /* U+00B0 */
+    {0x04, 0x02, 0x7F, 0x02, 0x04}, /* U+2191 */
+    {0x10, 0x20, 0x7F, 0x20, 0x10}, /* U+2193 */
+    {0x10, 0x26, 0x20, 0x26, 0x10}, /* U+263A */
+    {0x0C, 0x1E, 0x3C, 0x1E, 0x0C}, /* U+2665 */
+    {0x7E, 0x41, 0x41, 0x41, 0x7E}, /* U+E000 */
+    {0x7E, 0x71, 0x71, 0x71, 0x7E}, /* U+E001 */
+    {0x7E, 0x7F, 0x7F, 0x7F, 0x7E}, /* U+E002 */
+};
+
+static const ftb8md_glyph_table_t custom_icons = {
+    .codepoints = s_custom_icons_codepoints,
+    .glyphs = s_custom_icons_glyphs,
+    .count = sizeof(s_custom_icons_codepoints) / sizeof(s_custom_icons_codepoints[0]),
+};
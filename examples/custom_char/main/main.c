@@ -6,6 +6,7 @@
  * - Defining custom 5x7 characters in CGRAM
  * - Displaying custom characters
  * - Creating simple animations with custom characters
+ * - Playing a compiled animation timeline in the background
  */
 
 #include <stdio.h>
@@ -15,6 +16,9 @@
 #include "esp_log.h"
 
 #include "ftb-8-md.h"
+#include "ftb-8-md-anim.h"
+#include "icons.h"
+#include "charging_anim.h"
 
 static const char *TAG = "VFD_CUSTOM";
 
@@ -25,92 +29,20 @@ static const char *TAG = "VFD_CUSTOM";
 #define PIN_NUM_RST     4   /* Set to -1 if not connected */
 
 /**
- * @brief Custom character patterns (5x7 dot matrix)
- * 
- * Each character is defined by 5 bytes, where each byte represents a column.
- * Bit 0 is the top row, bit 6 is the bottom row.
- * 
- * Example: Heart shape
- *   Column: 0    1    2    3    4
- *   Row 0:  .    *    .    *    .     0x0E  0x1F  0x1F  0x1F  0x0E
- *   Row 1:  *    *    *    *    *
- *   Row 2:  *    *    *    *    *
- *   Row 3:  *    *    *    *    *
- *   Row 4:  .    *    *    *    .
- *   Row 5:  .    .    *    .    .
- *   Row 6:  .    .    .    .    .
+ * @brief Icons loaded into CGRAM, by character index.
+ *
+ * The glyphs are drawn as ASCII art in icons.txt and compiled into icons.h
+ * with tools/ftb8md_fontc.py (see README.md).
  */
-
-/* Heart symbol */
-static const uint8_t char_heart[5] = {
-    0x0E,  // .***. (column 0)
-    0x1F,  // ***** (column 1)
-    0x1F,  // ***** (column 2)
-    0x1F,  // ***** (column 3)
-    0x0E   // .***. (column 4)
-};
-
-/* Smiley face */
-static const uint8_t char_smiley[5] = {
-    0x00,  // ..... (column 0)
-    0x17,  // *.*.. (column 1) - left eye + mouth
-    0x10,  // ....* (column 2) - mouth bottom
-    0x17,  // *.*.. (column 3) - right eye + mouth
-    0x00   // ..... (column 4)
-};
-
-/* Up arrow */
-static const uint8_t char_arrow_up[5] = {
-    0x04,  // ..*.. (column 0)
-    0x02,  // .*... (column 1)
-    0x7F,  // ***** (column 2)
-    0x02,  // .*... (column 3)
-    0x04   // ..*.. (column 4)
-};
-
-/* Down arrow */
-static const uint8_t char_arrow_down[5] = {
-    0x10,  // ...** (column 0)
-    0x20,  // ...*. (column 1)
-    0x7F,  // ***** (column 2)
-    0x20,  // ...*. (column 3)
-    0x10   // ...** (column 4)
-};
-
-/* Battery empty */
-static const uint8_t char_battery_empty[5] = {
-    0x7F,  // ***** (column 0)
-    0x41,  // *...* (column 1)
-    0x41,  // *...* (column 2)
-    0x41,  // *...* (column 3)
-    0x7F   // ***** (column 4)
-};
-
-/* Battery half */
-static const uint8_t char_battery_half[5] = {
-    0x7F,  // ***** (column 0)
-    0x7F,  // ***** (column 1)
-    0x41,  // *...* (column 2)
-    0x41,  // *...* (column 3)
-    0x7F   // ***** (column 4)
-};
-
-/* Battery full */
-static const uint8_t char_battery_full[5] = {
-    0x7F,  // ***** (column 0)
-    0x7F,  // ***** (column 1)
-    0x7F,  // ***** (column 2)
-    0x7F,  // ***** (column 3)
-    0x7F   // ***** (column 4)
-};
-
-/* Degree symbol */
-static const uint8_t char_degree[5] = {
-    0x06,  // .**.. (column 0)
-    0x09,  // *..** (column 1)
-    0x06,  // .**.. (column 2)
-    0x00,  // ..... (column 3)
-    0x00   // ..... (column 4)
+static const uint32_t icon_slots[8] = {
+    ICON_HEART,          /* 0 */
+    ICON_SMILEY,         /* 1 */
+    ICON_ARROW_UP,       /* 2 */
+    ICON_ARROW_DOWN,     /* 3 */
+    ICON_BATTERY_EMPTY,  /* 4 */
+    ICON_BATTERY_HALF,   /* 5 */
+    ICON_BATTERY_FULL,   /* 6 */
+    ICON_DEGREE,         /* 7 */
 };
 
 void app_main(void)
@@ -143,17 +75,16 @@ void app_main(void)
     ESP_LOGI(TAG, "Loading custom characters into CGRAM...");
 
     /* Load custom characters into CGRAM (indices 0-7) */
-    ftb8md_write_custom_char(vfd, 0, char_heart);
-    ftb8md_write_custom_char(vfd, 1, char_smiley);
-    ftb8md_write_custom_char(vfd, 2, char_arrow_up);
-    ftb8md_write_custom_char(vfd, 3, char_arrow_down);
-    ftb8md_write_custom_char(vfd, 4, char_battery_empty);
-    ftb8md_write_custom_char(vfd, 5, char_battery_half);
-    ftb8md_write_custom_char(vfd, 6, char_battery_full);
-    ftb8md_write_custom_char(vfd, 7, char_degree);
+    for (int i = 0; i < 8; i++) {
+        ftb8md_write_custom_char(vfd, i, ftb8md_glyph_find(&custom_icons, icon_slots[i]));
+    }
 
     ESP_LOGI(TAG, "Custom characters loaded!");
 
+    /* Timeline player for animations compiled with tools/ftb8md_animc.py */
+    ftb8md_anim_player_t player;
+    ftb8md_anim_player_init(&player, vfd);
+
     /* Demo loop */
     while (1) {
         /* Display all custom characters */
@@ -189,19 +120,12 @@ void app_main(void)
         ftb8md_show_string(vfd, 5, "C  ");
         vTaskDelay(pdMS_TO_TICKS(3000));
 
-        /* Battery charging animation */
+        /* Battery charging animation, played from charging.txt by a timer */
         ESP_LOGI(TAG, "Battery charging animation...");
         ftb8md_clear_display(vfd);
-        ftb8md_show_string(vfd, 0, "CHARGE ");
-        
-        for (int cycle = 0; cycle < 5; cycle++) {
-            ftb8md_set_addressed_char(vfd, 7, 4);  /* Empty battery */
-            vTaskDelay(pdMS_TO_TICKS(500));
-            ftb8md_set_addressed_char(vfd, 7, 5);  /* Half battery */
-            vTaskDelay(pdMS_TO_TICKS(500));
-            ftb8md_set_addressed_char(vfd, 7, 6);  /* Full battery */
-            vTaskDelay(pdMS_TO_TICKS(500));
-        }
+        ftb8md_anim_play(&player, charging_anim, sizeof(charging_anim));
+        vTaskDelay(pdMS_TO_TICKS(7500));  /* 5 cycles; the task is free meanwhile */
+        ftb8md_anim_stop(&player);
 
         /* Arrow animation */
         ESP_LOGI(TAG, "Arrow animation...");
@@ -0,0 +1,446 @@
+/**
+ * @file ftb-8-md-anim.c
+ * @brief Timeline animation player for flash-resident animation files.
+ */
+
+#include "ftb-8-md-anim.h"
+#include "ftb-8-md-priv.h"
+
+#include "esp_log.h"
+#include "esp_partition.h"
+
+#include <string.h>
+
+static const char *TAG = "FTB8MD_ANIM";
+
+/** @brief Guards the stopping flags against the frame timers re-arming themselves */
+static portMUX_TYPE s_anim_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static const uint8_t s_magic[4] = {'F', 'T', 'B', 'A'};
+
+static uint16_t read_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static uint32_t read_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+esp_err_t ftb8md_anim_validate(const uint8_t *data, size_t len)
+{
+    if (data == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (len < FTB8MD_ANIM_HEADER_LEN)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (memcmp(data, s_magic, sizeof(s_magic)) != 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (data[4] != FTB8MD_ANIM_VERSION)
+    {
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    uint32_t body = read_u32(&data[8]);
+    if (body == 0 || body > len - FTB8MD_ANIM_HEADER_LEN)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    const uint8_t *p = &data[FTB8MD_ANIM_HEADER_LEN];
+    const uint8_t *end = p + body;
+    uint32_t hold_ms = 0;
+
+    for (;;)
+    {
+        if (p >= end)
+        {
+            // The stream must finish with an END record
+            return ESP_ERR_INVALID_SIZE;
+        }
+
+        uint8_t op = *p++;
+        size_t avail = end - p;
+
+        if (op == FTB8MD_ANIM_OP_END)
+        {
+            break;
+        }
+
+        switch (op)
+        {
+        case FTB8MD_ANIM_OP_WAIT:
+            if (avail < 2)
+            {
+                return ESP_ERR_INVALID_SIZE;
+            }
+            hold_ms += read_u16(p);
+            p += 2;
+            break;
+
+        case FTB8MD_ANIM_OP_DCRAM:
+        case FTB8MD_ANIM_OP_ADRAM:
+        case FTB8MD_ANIM_OP_CGRAM:
+        {
+            if (avail < 2)
+            {
+                return ESP_ERR_INVALID_SIZE;
+            }
+            uint8_t first = p[0];
+            uint8_t count = p[1];
+            size_t limit = op == FTB8MD_ANIM_OP_CGRAM ? FTB8MD_NUM_CGRAM : FTB8MD_NUM_DIGITS;
+            size_t size = op == FTB8MD_ANIM_OP_CGRAM ? (size_t)count * FTB8MD_GLYPH_COLS : count;
+            if (count == 0 || first + count > limit || avail < 2 + size)
+            {
+                return ESP_ERR_INVALID_SIZE;
+            }
+            p += 2 + size;
+            break;
+        }
+
+        case FTB8MD_ANIM_OP_DIMMING:
+            if (avail < 1 || p[0] > FTB8MD_MAX_DIMMING)
+            {
+                return ESP_ERR_INVALID_SIZE;
+            }
+            p += 1;
+            break;
+
+        default:
+            return ESP_ERR_INVALID_SIZE;
+        }
+    }
+
+    // A loop without hold time would keep the timer firing back to back
+    if ((data[5] & FTB8MD_ANIM_FLAG_LOOP) && hold_ms == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Apply the records of one frame.
+ *
+ * Must be called with the panel lock held.
+ *
+ * @param player Player
+ * @param panel Panel state
+ * @param[out] wait_ms Hold time of the frame
+ * @return false when the timeline has ended
+ */
+static bool anim_frame(ftb8md_anim_player_t *player, ftb8md_panel_t *panel, uint32_t *wait_ms)
+{
+    uint8_t dcram[FTB8MD_NUM_DIGITS];
+    uint8_t adram[FTB8MD_NUM_DIGITS];
+    uint8_t dcram_mask = 0;
+    uint8_t adram_mask = 0;
+    bool more = true;
+    esp_err_t ret = ESP_OK;
+    const ftb8md_shadow_t *shadow = &panel->shadow;
+
+    *wait_ms = 0;
+
+    for (bool done = false; !done;)
+    {
+        const uint8_t *p = &player->data[player->pos];
+        uint8_t op = *p++;
+
+        switch (op)
+        {
+        case FTB8MD_ANIM_OP_WAIT:
+            *wait_ms = read_u16(p);
+            p += 2;
+            done = true;
+            break;
+
+        case FTB8MD_ANIM_OP_DCRAM:
+        case FTB8MD_ANIM_OP_ADRAM:
+            for (int i = 0; i < p[1]; i++)
+            {
+                int d = p[0] + i;
+                if (op == FTB8MD_ANIM_OP_DCRAM)
+                {
+                    dcram[d] = p[2 + i];
+                    dcram_mask |= 1u << d;
+                }
+                else
+                {
+                    adram[d] = p[2 + i];
+                    adram_mask |= 1u << d;
+                }
+            }
+            p += 2 + p[1];
+            break;
+
+        case FTB8MD_ANIM_OP_CGRAM:
+            // Upload right away so the frame's digits never show a stale glyph
+            for (int i = 0; i < p[1] && ret == ESP_OK; i++)
+            {
+                uint8_t slot = p[0] + i;
+                const uint8_t *cols = &p[2 + i * FTB8MD_GLYPH_COLS];
+                if ((shadow->cgram_valid & (1u << slot)) && memcmp(shadow->cgram[slot], cols, FTB8MD_GLYPH_COLS) == 0)
+                {
+                    continue;
+                }
+
+                uint8_t cmd[1 + FTB8MD_GLYPH_COLS];
+                cmd[0] = FTB8MD_CMD_CGRAM(slot);
+                memcpy(&cmd[1], cols, FTB8MD_GLYPH_COLS);
+                ret = ftb8md_panel_send(panel, cmd, sizeof(cmd));
+            }
+            p += 2 + p[1] * FTB8MD_GLYPH_COLS;
+            break;
+
+        case FTB8MD_ANIM_OP_DIMMING:
+            if (ret == ESP_OK)
+            {
+                ret = ftb8md_set_dimming(player->handle, p[0]);
+            }
+            p += 1;
+            break;
+
+        default:
+            // FTB8MD_ANIM_OP_END
+            if (player->data[5] & FTB8MD_ANIM_FLAG_LOOP)
+            {
+                player->pos = FTB8MD_ANIM_HEADER_LEN;
+                p = &player->data[player->pos];
+            }
+            else
+            {
+                more = false;
+            }
+            done = true;
+            break;
+        }
+
+        player->pos = p - player->data;
+    }
+
+    if (ret == ESP_OK && dcram_mask != 0)
+    {
+        ret = ftb8md_panel_write_diff(panel, CMD_PREFIX_DCRAM, dcram, dcram_mask);
+    }
+    if (ret == ESP_OK && adram_mask != 0)
+    {
+        ret = ftb8md_panel_write_diff(panel, CMD_PREFIX_ADRAM, adram, adram_mask);
+    }
+    if (ret != ESP_OK && ret != ESP_ERR_TIMEOUT)
+    {
+        // Diffing resends whatever did not arrive with the next frame, also when the bus budget refused it
+        ESP_LOGW(TAG, "Failed to update frame: %s", esp_err_to_name(ret));
+    }
+
+    return more;
+}
+
+static void anim_timer_cb(void *arg)
+{
+    ftb8md_anim_player_t *player = arg;
+    ftb8md_panel_t *panel = ftb8md_panel_get(player->handle);
+    if (panel == NULL)
+    {
+        player->playing = false;
+        return;
+    }
+
+    if (!ftb8md_panel_trylock(panel, 0))
+    {
+        // Try again shortly; the timeline catches up, since the next frame is due against due_us
+        portENTER_CRITICAL(&s_anim_lock);
+        if (!player->stopping)
+        {
+            esp_timer_start_once(player->timer, FTB8MD_LOCK_RETRY_US);
+        }
+        portEXIT_CRITICAL(&s_anim_lock);
+        return;
+    }
+
+    // The player lock is the panel lock: ftb8md_anim_stop() clears playing while holding it
+    if (player->playing)
+    {
+        uint32_t wait_ms;
+        player->playing = anim_frame(player, panel, &wait_ms);
+        if (player->playing)
+        {
+            // Schedule against the timeline, not against this callback, so frame times do not drift
+            int64_t now = esp_timer_get_time();
+            player->due_us += (int64_t)wait_ms * 1000;
+            if (player->due_us < now)
+            {
+                player->due_us = now;
+            }
+            esp_timer_start_once(player->timer, player->due_us - now);
+        }
+    }
+
+    ftb8md_panel_unlock(panel);
+}
+
+esp_err_t ftb8md_anim_player_init(ftb8md_anim_player_t *player, spi_device_handle_t handle)
+{
+    if (player == NULL || ftb8md_panel_get(handle) == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(player, 0, sizeof(*player));
+    player->handle = handle;
+
+    esp_timer_create_args_t args = {
+        .callback = anim_timer_cb,
+        .arg = player,
+        .name = "ftb8md_anim",
+    };
+    if (esp_timer_create(&args, &player->timer) != ESP_OK)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t ftb8md_anim_player_deinit(ftb8md_anim_player_t *player)
+{
+    if (player == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (player->timer == NULL)
+    {
+        return ESP_OK;
+    }
+
+    // A callback that failed to get the panel must not re-arm the timer once it is stopped
+    portENTER_CRITICAL(&s_anim_lock);
+    player->stopping = true;
+    portEXIT_CRITICAL(&s_anim_lock);
+
+    ftb8md_anim_stop(player);
+    if (esp_timer_delete(player->timer) != ESP_OK)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    player->timer = NULL;
+
+    return ESP_OK;
+}
+
+esp_err_t ftb8md_anim_play(ftb8md_anim_player_t *player, const uint8_t *data, size_t len)
+{
+    if (player == NULL || player->timer == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ftb8md_anim_validate(data, len);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+
+    ftb8md_anim_stop(player);
+
+    ftb8md_panel_t *panel = ftb8md_panel_get(player->handle);
+    if (panel == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ftb8md_panel_lock(panel);
+    player->data = data;
+    player->len = len;
+    player->pos = FTB8MD_ANIM_HEADER_LEN;
+    player->due_us = esp_timer_get_time();
+    player->playing = true;
+    esp_timer_start_once(player->timer, 0);
+    ftb8md_panel_unlock(panel);
+
+    return ESP_OK;
+}
+
+void ftb8md_anim_stop(ftb8md_anim_player_t *player)
+{
+    if (player == NULL || player->timer == NULL)
+    {
+        return;
+    }
+
+    ftb8md_panel_t *panel = ftb8md_panel_get(player->handle);
+    if (panel == NULL)
+    {
+        player->playing = false;
+        esp_timer_stop(player->timer);
+        return;
+    }
+
+    ftb8md_panel_lock(panel);
+    player->playing = false;
+    esp_timer_stop(player->timer);
+    ftb8md_panel_unlock(panel);
+}
+
+bool ftb8md_anim_is_playing(const ftb8md_anim_player_t *player)
+{
+    return player != NULL && player->playing;
+}
+
+esp_err_t ftb8md_anim_map_partition(const char *label, ftb8md_anim_mapping_t *mapping)
+{
+    if (label == NULL || mapping == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    if (part == NULL)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    const void *ptr = NULL;
+    esp_partition_mmap_handle_t handle;
+    esp_err_t ret = esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA, &ptr, &handle);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to map partition %s: %s", label, esp_err_to_name(ret));
+        return ret;
+    }
+
+    ret = ftb8md_anim_validate(ptr, part->size);
+    if (ret != ESP_OK)
+    {
+        esp_partition_munmap(handle);
+        return ret;
+    }
+
+    mapping->data = ptr;
+    mapping->len = FTB8MD_ANIM_HEADER_LEN + read_u32((const uint8_t *)ptr + 8);
+    mapping->mmap = handle;
+
+    return ESP_OK;
+}
+
+void ftb8md_anim_unmap(ftb8md_anim_mapping_t *mapping)
+{
+    if (mapping == NULL || mapping->data == NULL)
+    {
+        return;
+    }
+
+    esp_partition_munmap(mapping->mmap);
+    mapping->data = NULL;
+    mapping->len = 0;
+}
@@ -0,0 +1,156 @@
+/**
+ * @file ftb-8-md-bar.c
+ * @brief Bar graph and level meter widget.
+ */
+
+#include "ftb-8-md-bar.h"
+#include "ftb-8-md-priv.h"
+
+#include <string.h>
+
+/** @brief Character shown in empty digits */
+#define BAR_EMPTY 0x20
+
+esp_err_t ftb8md_bar_init(ftb8md_bar_t *bar, spi_device_handle_t handle, int digit, int count, uint8_t slot_mask,
+                          ftb8md_bar_style_t style)
+{
+    if (bar == NULL || digit < 0 || count < 1 || digit + count > FTB8MD_NUM_DIGITS)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int n = 0;
+    for (int slot = 0; slot < FTB8MD_NUM_CGRAM && n < FTB8MD_BAR_GLYPHS; slot++)
+    {
+        if (slot_mask & (1u << slot))
+        {
+            bar->slots[n++] = (uint8_t)slot;
+        }
+    }
+    if (n < FTB8MD_BAR_GLYPHS)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    bar->handle = handle;
+    bar->digit = (uint8_t)digit;
+    bar->count = (uint8_t)count;
+    bar->pattern = FTB8MD_BAR_PATTERN_SOLID;
+    bar->style = style;
+    bar->value = 0;
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Column data of bar glyph i (1 + i columns for fill, column i for marker).
+ */
+static void bar_glyph(const ftb8md_bar_t *bar, int i, uint8_t *cols)
+{
+    for (int c = 0; c < FTB8MD_GLYPH_COLS; c++)
+    {
+        bool lit = bar->style == FTB8MD_BAR_MARKER ? c == i : c <= i;
+        cols[c] = lit ? bar->pattern : 0;
+    }
+}
+
+esp_err_t ftb8md_bar_set(ftb8md_bar_t *bar, int columns)
+{
+    if (bar == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ftb8md_panel_t *panel = ftb8md_panel_get(bar->handle);
+    if (panel == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int total = bar->count * FTB8MD_GLYPH_COLS;
+    columns = columns < 0 ? 0 : columns > total ? total : columns;
+
+    uint8_t codes[FTB8MD_NUM_DIGITS];
+    uint8_t mask = 0;
+    uint8_t needed = 0;
+
+    for (int i = 0; i < bar->count; i++)
+    {
+        // Columns of this digit up to the value: 0 (empty) to 5 (full)
+        int lit = columns - i * FTB8MD_GLYPH_COLS;
+        lit = lit < 0 ? 0 : lit > FTB8MD_GLYPH_COLS ? FTB8MD_GLYPH_COLS : lit;
+
+        // A marker only shows in the digit holding its column
+        int glyph = lit - 1;
+        if (bar->style == FTB8MD_BAR_MARKER && columns > (i + 1) * FTB8MD_GLYPH_COLS)
+        {
+            glyph = -1;
+        }
+
+        codes[bar->digit + i] = glyph < 0 ? BAR_EMPTY : bar->slots[glyph];
+        mask |= 1u << (bar->digit + i);
+        needed |= glyph < 0 ? 0 : 1u << glyph;
+    }
+
+    esp_err_t ret = ESP_OK;
+    const ftb8md_shadow_t *shadow = &panel->shadow;
+
+    ftb8md_panel_lock(panel);
+
+    // Upload glyphs CGRAM does not hold yet; after the first sweep this sends nothing
+    for (int g = 0; g < FTB8MD_BAR_GLYPHS && ret == ESP_OK; g++)
+    {
+        uint8_t slot = bar->slots[g];
+        uint8_t cmd[1 + FTB8MD_GLYPH_COLS];
+
+        if (!(needed & (1u << g)))
+        {
+            continue;
+        }
+
+        bar_glyph(bar, g, &cmd[1]);
+        if ((shadow->cgram_valid & (1u << slot)) && memcmp(shadow->cgram[slot], &cmd[1], FTB8MD_GLYPH_COLS) == 0)
+        {
+            continue;
+        }
+
+        cmd[0] = FTB8MD_CMD_CGRAM(slot);
+        ret = ftb8md_panel_send(panel, cmd, sizeof(cmd));
+    }
+
+    if (ret == ESP_OK)
+    {
+        ret = ftb8md_panel_write_diff(panel, CMD_PREFIX_DCRAM, codes, mask);
+    }
+
+    ftb8md_panel_unlock(panel);
+
+    if (ret == ESP_OK)
+    {
+        bar->value = (uint16_t)columns;
+    }
+
+    return ret;
+}
+
+esp_err_t ftb8md_bar_set_scaled(ftb8md_bar_t *bar, int32_t value, int32_t min, int32_t max)
+{
+    if (bar == NULL || min == max)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int64_t num = ((int64_t)value - min) * bar->count * FTB8MD_GLYPH_COLS;
+    int64_t den = (int64_t)max - min;
+    if (den < 0)
+    {
+        // Inverted range
+        num = -num;
+        den = -den;
+    }
+
+    // Round to the nearest column; ftb8md_bar_set() clamps values outside the range
+    int64_t columns = num < 0 ? 0 : (num * 2 + den) / (den * 2);
+
+    return ftb8md_bar_set(bar, columns > INT32_MAX ? INT32_MAX : (int)columns);
+}
@@ -0,0 +1,266 @@
+/**
+ * @file ftb-8-md-bind.c
+ * @brief Live data binding: values shown in digit regions at a human rate.
+ */
+
+#include "ftb-8-md-bind.h"
+#include "ftb-8-md-priv.h"
+
+#include "freertos/task.h"
+#include "esp_log.h"
+
+#include <stdio.h>
+
+static const char *TAG = "FTB8MD_BIND";
+
+/** @brief Longest text a formatter may produce, NUL included */
+#define BIND_TEXT_LEN 32
+
+/** @brief Guards s_bindings, s_ticking and the bound and stale flags */
+static portMUX_TYPE s_bind_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static ftb8md_binding_t *s_bindings;
+static esp_timer_handle_t s_bind_timer;
+
+/** @brief A tick is walking the bindings; ftb8md_unbind() waits for it to end */
+static bool s_ticking;
+
+/**
+ * @brief Format, lay out and write a binding whose value changed.
+ *
+ * @return false if the panel was busy or the write failed, so the next tick tries again
+ */
+static bool bind_render(ftb8md_binding_t *binding, uint32_t bits, bool force)
+{
+    const ftb8md_bind_config_t *config = &binding->config;
+    ftb8md_panel_t *panel = ftb8md_panel_get(binding->handle);
+    if (panel == NULL)
+    {
+        return false;
+    }
+
+    ftb8md_bind_value_t value = {.i = (int32_t)bits};
+    char text[BIND_TEXT_LEN];
+    if (config->format != NULL)
+    {
+        text[0] = '\0';
+        config->format(value, text, sizeof(text), config->format_arg);
+        text[sizeof(text) - 1] = '\0';
+    }
+    else if (config->type == FTB8MD_BIND_FLOAT)
+    {
+        snprintf(text, sizeof(text), config->fmt, (double)value.f);
+    }
+    else
+    {
+        snprintf(text, sizeof(text), config->fmt, value.i);
+    }
+    binding->renders++;
+
+    uint8_t codes[FTB8MD_NUM_DIGITS];
+    ftb8md_layout_encode(&config->layout, text, strlen(text), &codes[config->digit], config->width);
+    if (!force && memcmp(&codes[config->digit], &binding->codes[config->digit], config->width) == 0)
+    {
+        return true;
+    }
+
+    // The tick runs on the esp_timer task, so it never waits for a writer; a busy panel is tried next tick
+    if (!ftb8md_panel_trylock(panel, 0))
+    {
+        return false;
+    }
+
+    uint8_t mask = (uint8_t)(((1u << config->width) - 1) << config->digit);
+    esp_err_t ret = ftb8md_panel_write_diff(panel, CMD_PREFIX_DCRAM, codes, mask);
+    ftb8md_panel_unlock(panel);
+    if (ret != ESP_OK)
+    {
+        return false;
+    }
+
+    memcpy(&binding->codes[config->digit], &codes[config->digit], config->width);
+    binding->writes++;
+
+    return true;
+}
+
+static void bind_timer_cb(void *arg)
+{
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&s_bind_lock);
+    s_ticking = true;
+    for (ftb8md_binding_t *binding = s_bindings; binding != NULL; binding = binding->next)
+    {
+        // Bindings removed during this tick keep their next link until it ends
+        if (!binding->bound || (binding->rendered && !binding->stale && now < binding->due_us))
+        {
+            continue;
+        }
+
+        uint32_t bits = __atomic_load_n(&binding->value, __ATOMIC_RELAXED);
+        bool force = !binding->rendered || binding->stale;
+        if (!force && bits == binding->shown)
+        {
+            // Nothing to show; the rate limit starts again with the next change
+            continue;
+        }
+
+        // ftb8md_unbind() waits for the tick, so the binding stays valid with the lock released
+        binding->stale = false;
+        portEXIT_CRITICAL(&s_bind_lock);
+
+        bool ok = bind_render(binding, bits, force);
+        if (ok)
+        {
+            binding->shown = bits;
+            binding->rendered = true;
+            binding->due_us = now + binding->period_us;
+        }
+        else
+        {
+            ESP_LOGD(TAG, "Render of digits %d-%d failed", binding->config.digit,
+                     binding->config.digit + binding->config.width - 1);
+        }
+
+        portENTER_CRITICAL(&s_bind_lock);
+        if (!ok)
+        {
+            binding->stale = true;
+        }
+    }
+    s_ticking = false;
+    portEXIT_CRITICAL(&s_bind_lock);
+}
+
+esp_err_t ftb8md_bind(ftb8md_binding_t *binding, spi_device_handle_t handle, const ftb8md_bind_config_t *config)
+{
+    ftb8md_bind_config_t defaults = FTB8MD_BIND_CONFIG_DEFAULT();
+    if (config == NULL)
+    {
+        config = &defaults;
+    }
+
+    if (binding == NULL || ftb8md_panel_get(handle) == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (config->digit < 0 || config->width <= 0 || config->digit + config->width > FTB8MD_NUM_DIGITS ||
+        (config->format == NULL && config->fmt == NULL))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (s_bind_timer == NULL)
+    {
+        esp_timer_handle_t timer;
+        esp_timer_create_args_t args = {
+            .callback = bind_timer_cb,
+            .name = "ftb8md_bind",
+        };
+        if (esp_timer_create(&args, &timer) != ESP_OK)
+        {
+            return ESP_ERR_NO_MEM;
+        }
+
+        // Another task may have created it meanwhile
+        portENTER_CRITICAL(&s_bind_lock);
+        if (s_bind_timer == NULL)
+        {
+            s_bind_timer = timer;
+            timer = NULL;
+        }
+        portEXIT_CRITICAL(&s_bind_lock);
+        if (timer != NULL)
+        {
+            esp_timer_delete(timer);
+        }
+    }
+
+    portENTER_CRITICAL(&s_bind_lock);
+    ftb8md_binding_t *it = s_bindings;
+    while (it != NULL && it != binding)
+    {
+        it = it->next;
+    }
+    portEXIT_CRITICAL(&s_bind_lock);
+    if (it != NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    memset(binding, 0, sizeof(*binding));
+    binding->handle = handle;
+    binding->config = *config;
+    binding->period_us = config->max_rate_hz != 0 ? 1000000 / config->max_rate_hz : 0;
+
+    portENTER_CRITICAL(&s_bind_lock);
+    bool first = s_bindings == NULL;
+    binding->bound = true;
+    binding->next = s_bindings;
+    s_bindings = binding;
+    portEXIT_CRITICAL(&s_bind_lock);
+
+    if (first)
+    {
+        esp_timer_start_periodic(s_bind_timer, FTB8MD_BIND_TICK_US);
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t ftb8md_unbind(ftb8md_binding_t *binding)
+{
+    if (binding == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    bool found = false;
+    bool last = false;
+
+    portENTER_CRITICAL(&s_bind_lock);
+    for (ftb8md_binding_t **link = &s_bindings; *link != NULL; link = &(*link)->next)
+    {
+        if (*link == binding)
+        {
+            *link = binding->next;
+            binding->bound = false;
+            found = true;
+            last = s_bindings == NULL;
+            break;
+        }
+    }
+    while (found && s_ticking)
+    {
+        portEXIT_CRITICAL(&s_bind_lock);
+        vTaskDelay(1);
+        portENTER_CRITICAL(&s_bind_lock);
+    }
+    portEXIT_CRITICAL(&s_bind_lock);
+
+    if (!found)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    if (last)
+    {
+        esp_timer_stop(s_bind_timer);
+    }
+
+    return ESP_OK;
+}
+
+void ftb8md_bind_invalidate(ftb8md_binding_t *binding)
+{
+    if (binding == NULL)
+    {
+        return;
+    }
+
+    portENTER_CRITICAL(&s_bind_lock);
+    binding->stale = true;
+    portEXIT_CRITICAL(&s_bind_lock);
+}
@@ -0,0 +1,255 @@
+/**
+ * @file ftb-8-md-bitmap.c
+ * @brief 40x7 bitmap graphics mode backed by the 8 CGRAM characters.
+ */
+
+#include "ftb-8-md-bitmap.h"
+#include "ftb-8-md-priv.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/** @brief Mask of the pixel bits in a column byte */
+#define COLUMN_MASK ((1u << FTB8MD_BITMAP_HEIGHT) - 1)
+
+/**
+ * @brief Apply a pixel operation to the bits selected by mask in one column.
+ */
+static inline void apply_column(uint8_t *col, uint8_t mask, ftb8md_pixel_op_t op)
+{
+    switch (op)
+    {
+    case FTB8MD_PIXEL_SET:
+        *col |= mask;
+        break;
+    case FTB8MD_PIXEL_CLEAR:
+        *col &= ~mask;
+        break;
+    case FTB8MD_PIXEL_INVERT:
+        *col ^= mask;
+        break;
+    }
+}
+
+/**
+ * @brief Shift a column byte so that its row 0 lands on row y, dropping rows outside the bitmap.
+ */
+static inline uint8_t shift_column(uint8_t bits, int y)
+{
+    if (y >= FTB8MD_BITMAP_HEIGHT || y <= -FTB8MD_BITMAP_HEIGHT)
+    {
+        return 0;
+    }
+
+    return (uint8_t)((y >= 0 ? bits << y : bits >> -y) & COLUMN_MASK);
+}
+
+void ftb8md_bitmap_clear(ftb8md_bitmap_t *bmp)
+{
+    if (bmp != NULL)
+    {
+        memset(bmp->col, 0, sizeof(bmp->col));
+    }
+}
+
+void ftb8md_bitmap_set_pixel(ftb8md_bitmap_t *bmp, int x, int y, ftb8md_pixel_op_t op)
+{
+    if (bmp == NULL || x < 0 || x >= FTB8MD_BITMAP_WIDTH || y < 0 || y >= FTB8MD_BITMAP_HEIGHT)
+    {
+        return;
+    }
+
+    apply_column(&bmp->col[x], 1u << y, op);
+}
+
+bool ftb8md_bitmap_get_pixel(const ftb8md_bitmap_t *bmp, int x, int y)
+{
+    if (bmp == NULL || x < 0 || x >= FTB8MD_BITMAP_WIDTH || y < 0 || y >= FTB8MD_BITMAP_HEIGHT)
+    {
+        return false;
+    }
+
+    return (bmp->col[x] >> y) & 1;
+}
+
+void ftb8md_bitmap_draw_line(ftb8md_bitmap_t *bmp, int x0, int y0, int x1, int y1, ftb8md_pixel_op_t op)
+{
+    if (bmp == NULL)
+    {
+        return;
+    }
+
+    // Bresenham, all octants
+    int dx = abs(x1 - x0);
+    int dy = -abs(y1 - y0);
+    int sx = x0 < x1 ? 1 : -1;
+    int sy = y0 < y1 ? 1 : -1;
+    int err = dx + dy;
+
+    while (1)
+    {
+        ftb8md_bitmap_set_pixel(bmp, x0, y0, op);
+        if (x0 == x1 && y0 == y1)
+        {
+            break;
+        }
+
+        int e2 = 2 * err;
+        if (e2 >= dy)
+        {
+            err += dy;
+            x0 += sx;
+        }
+        if (e2 <= dx)
+        {
+            err += dx;
+            y0 += sy;
+        }
+    }
+}
+
+void ftb8md_bitmap_draw_rect(ftb8md_bitmap_t *bmp, int x, int y, int w, int h, bool fill, ftb8md_pixel_op_t op)
+{
+    if (bmp == NULL || w <= 0 || h <= 0)
+    {
+        return;
+    }
+
+    // Build whole-column masks, so each column is touched once even with INVERT
+    uint8_t body = 0;
+    for (int row = y; row < y + h; row++)
+    {
+        if (row >= 0 && row < FTB8MD_BITMAP_HEIGHT)
+        {
+            body |= 1u << row;
+        }
+    }
+
+    uint8_t edges = 0;
+    if (y >= 0 && y < FTB8MD_BITMAP_HEIGHT)
+    {
+        edges |= 1u << y;
+    }
+    if (y + h - 1 >= 0 && y + h - 1 < FTB8MD_BITMAP_HEIGHT)
+    {
+        edges |= 1u << (y + h - 1);
+    }
+
+    for (int cx = x; cx < x + w; cx++)
+    {
+        if (cx < 0 || cx >= FTB8MD_BITMAP_WIDTH)
+        {
+            continue;
+        }
+
+        bool side = (cx == x || cx == x + w - 1);
+        apply_column(&bmp->col[cx], (fill || side) ? body : edges, op);
+    }
+}
+
+void ftb8md_bitmap_blit(ftb8md_bitmap_t *bmp, int x, int y, const uint8_t *src, int w, int h, ftb8md_pixel_op_t op)
+{
+    if (bmp == NULL || src == NULL || w <= 0 || h <= 0)
+    {
+        return;
+    }
+
+    if (h > FTB8MD_BITMAP_HEIGHT)
+    {
+        h = FTB8MD_BITMAP_HEIGHT;
+    }
+
+    uint8_t rows = shift_column((uint8_t)((1u << h) - 1), y);
+
+    for (int i = 0; i < w; i++)
+    {
+        int cx = x + i;
+        if (cx < 0 || cx >= FTB8MD_BITMAP_WIDTH)
+        {
+            continue;
+        }
+
+        uint8_t bits = shift_column(src[i], y) & rows;
+        if (op == FTB8MD_PIXEL_SET)
+        {
+            bmp->col[cx] = (bmp->col[cx] & ~rows) | bits;
+        }
+        else
+        {
+            apply_column(&bmp->col[cx], bits, op);
+        }
+    }
+}
+
+esp_err_t ftb8md_bitmap_flush(spi_device_handle_t handle, const ftb8md_bitmap_t *bmp)
+{
+    ftb8md_panel_t *panel = ftb8md_panel_get(handle);
+    if (panel == NULL || bmp == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_OK;
+    const ftb8md_shadow_t *shadow = &panel->shadow;
+
+    ftb8md_panel_lock(panel);
+
+    // Upload changed characters first, so digits never show stale patterns
+    int slot = 0;
+    while (slot < FTB8MD_NUM_CGRAM && ret == ESP_OK)
+    {
+        const uint8_t *cols = &bmp->col[slot * FTB8MD_GLYPH_COLS];
+        bool known = shadow->cgram_valid & (1u << slot);
+        if (known && memcmp(shadow->cgram[slot], cols, FTB8MD_GLYPH_COLS) == 0)
+        {
+            slot++;
+            continue;
+        }
+
+        // Extend the run over adjacent changed characters
+        int first = slot++;
+        while (slot < FTB8MD_NUM_CGRAM)
+        {
+            cols = &bmp->col[slot * FTB8MD_GLYPH_COLS];
+            known = shadow->cgram_valid & (1u << slot);
+            if (known && memcmp(shadow->cgram[slot], cols, FTB8MD_GLYPH_COLS) == 0)
+            {
+                break;
+            }
+            slot++;
+        }
+
+        uint8_t cmd[FTB8MD_CMD_MAX_LEN];
+        size_t len = (size_t)(slot - first) * FTB8MD_GLYPH_COLS;
+        cmd[0] = FTB8MD_CMD_CGRAM(first);
+        memcpy(&cmd[1], &bmp->col[first * FTB8MD_GLYPH_COLS], len);
+        ret = ftb8md_panel_send(panel, cmd, 1 + len);
+    }
+
+    // Map digit N to CGRAM character N, covering only the digits that differ
+    int lo = -1;
+    int hi = -1;
+    for (int digit = 0; digit < FTB8MD_NUM_DIGITS; digit++)
+    {
+        if (!(shadow->dcram_valid & (1u << digit)) || shadow->dcram[digit] != digit)
+        {
+            lo = lo < 0 ? digit : lo;
+            hi = digit;
+        }
+    }
+
+    if (ret == ESP_OK && lo >= 0)
+    {
+        uint8_t cmd[1 + FTB8MD_NUM_DIGITS];
+        cmd[0] = FTB8MD_CMD_DCRAM(lo);
+        for (int digit = lo; digit <= hi; digit++)
+        {
+            cmd[1 + digit - lo] = (uint8_t)digit;
+        }
+        ret = ftb8md_panel_send(panel, cmd, 1 + hi - lo + 1);
+    }
+
+    ftb8md_panel_unlock(panel);
+
+    return ret;
+}
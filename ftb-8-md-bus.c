@@ -0,0 +1,362 @@
+/**
+ * @file ftb-8-md-bus.c
+ * @brief Bandwidth budgeting on a shared SPI bus.
+ */
+
+#include "ftb-8-md-bus.h"
+#include "ftb-8-md-priv.h"
+
+#include "freertos/task.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+
+#include <string.h>
+
+/**
+ * @brief Budget and usage of one SPI host.
+ */
+typedef struct
+{
+    bool limited;                /**< A budget is set */
+    ftb8md_bus_budget_t budget;  /**< Current budget */
+    int64_t tat_us;              /**< Time the byte budget is fully paid back (virtual scheduling) */
+    int64_t last_end_us;         /**< End of the last VFD transaction on the host */
+    int64_t stats_start_us;      /**< Time the statistics were reset */
+    ftb8md_bus_stats_t stats;    /**< Usage since stats_start_us */
+} bus_host_t;
+
+/** @brief Guards s_hosts */
+static portMUX_TYPE s_bus_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static bus_host_t s_hosts[SPI_HOST_MAX];
+
+/**
+ * @brief Time the panel clock needs to shift out len bytes.
+ */
+static uint32_t bus_wire_us(size_t len)
+{
+    return (uint32_t)(((uint64_t)len * 8 * 1000000 + FTB8MD_SPI_CLOCK_HZ - 1) / FTB8MD_SPI_CLOCK_HZ);
+}
+
+/**
+ * @brief Check whether the calling task may wait for the budget.
+ *
+ * esp_timer callbacks share one task with the rest of the system, and the
+ * dithering, scrubbing, animation, pager, binding and control flush timers
+ * send from there; they must neither sleep nor spin.
+ */
+static bool bus_may_wait(void)
+{
+    static TaskHandle_t s_timer_task;
+    if (s_timer_task == NULL)
+    {
+        s_timer_task = xTaskGetHandle("esp_timer");
+    }
+
+    return s_timer_task == NULL || xTaskGetCurrentTaskHandle() != s_timer_task;
+}
+
+/**
+ * @brief Reserve a slot for a transaction in the host's budget.
+ *
+ * The byte budget is enforced as a smoothed rate: each byte costs
+ * window_us / max_bytes_per_window, and at most one window worth of bytes
+ * may be sent ahead of that rate.
+ *
+ * @param host Host state
+ * @param len Length of the transaction in bytes
+ * @param now Current time
+ * @param may_wait false to reserve nothing when the transaction cannot start now
+ * @return Earliest time the transaction may start, or -1 if it was refused
+ */
+static int64_t bus_reserve_locked(bus_host_t *host, size_t len, int64_t now, bool may_wait)
+{
+    uint32_t wire = bus_wire_us(len);
+    int64_t start = now;
+    int64_t tat = host->tat_us;
+
+    if (host->limited)
+    {
+        const ftb8md_bus_budget_t *budget = &host->budget;
+
+        if (budget->max_bytes_per_window != 0)
+        {
+            int64_t cost = (int64_t)len * budget->window_us / budget->max_bytes_per_window;
+            if (tat < now)
+            {
+                tat = now;
+            }
+            if (tat + cost - (int64_t)budget->window_us > start)
+            {
+                start = tat + cost - (int64_t)budget->window_us;
+            }
+            tat += cost;
+        }
+
+        if (host->last_end_us + (int64_t)budget->min_gap_us > start)
+        {
+            start = host->last_end_us + budget->min_gap_us;
+        }
+    }
+
+    if (!may_wait && start > now)
+    {
+        host->stats.refused++;
+        return -1;
+    }
+
+    host->tat_us = tat;
+    host->last_end_us = start + wire;
+    host->stats.throttle_us += (uint64_t)(start - now);
+
+    return start;
+}
+
+/**
+ * @brief Block the calling task until a reserved start time.
+ *
+ * Gaps shorter than a tick are busy-waited, as sleeping would stretch them
+ * to a whole tick; longer waits sleep, rounded up to the next tick.
+ */
+static void bus_wait_until(int64_t start)
+{
+    int64_t tick_us = (int64_t)portTICK_PERIOD_MS * 1000;
+    int64_t wait = start - esp_timer_get_time();
+
+    if (wait >= tick_us)
+    {
+        // n + 1 tick interrupts are at least n whole tick periods apart
+        vTaskDelay((TickType_t)(wait / tick_us) + 1);
+    }
+    else if (wait > 0)
+    {
+        esp_rom_delay_us((uint32_t)wait);
+    }
+}
+
+/**
+ * @brief Send one transaction within the host's budget.
+ */
+static esp_err_t bus_send_piece(bus_host_t *host, spi_device_handle_t spi, const uint8_t *cmd, size_t len)
+{
+    if (host != NULL)
+    {
+        bool may_wait = bus_may_wait();
+        portENTER_CRITICAL(&s_bus_lock);
+        int64_t start = bus_reserve_locked(host, len, esp_timer_get_time(), may_wait);
+        portEXIT_CRITICAL(&s_bus_lock);
+
+        if (start < 0)
+        {
+            return ESP_ERR_TIMEOUT;
+        }
+        bus_wait_until(start);
+    }
+
+    spi_transaction_t trans = {
+        .length = len * 8,
+        .tx_buffer = cmd,
+    };
+
+    esp_err_t ret = spi_device_transmit(spi, &trans);
+
+    if (host != NULL)
+    {
+        int64_t end = esp_timer_get_time();
+
+        portENTER_CRITICAL(&s_bus_lock);
+        // Gaps count from the real end when other devices delayed the transaction
+        if (end > host->last_end_us)
+        {
+            host->last_end_us = end;
+        }
+        if (ret == ESP_OK)
+        {
+            host->stats.transactions++;
+            host->stats.bytes += len;
+            host->stats.wire_us += bus_wire_us(len);
+        }
+        portEXIT_CRITICAL(&s_bus_lock);
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Longest piece a command may be split into.
+ *
+ * @return Piece length, or len if the command is sent as it is
+ */
+static size_t bus_piece_len(const bus_host_t *host, const uint8_t *cmd, size_t len)
+{
+    size_t max = host != NULL && host->limited ? host->budget.max_transaction_len : 0;
+    if (max == 0 || len <= max)
+    {
+        return len;
+    }
+
+    switch (cmd[0] >> 5)
+    {
+    case CMD_PREFIX_DCRAM:
+    case CMD_PREFIX_ADRAM:
+        return max < 2 ? 2 : max;
+
+    case CMD_PREFIX_CGRAM:
+        // Characters cannot be split: the address selects a whole character
+        return max < 1 + FTB8MD_GLYPH_COLS ? 1 + FTB8MD_GLYPH_COLS : 1 + (max - 1) / FTB8MD_GLYPH_COLS * FTB8MD_GLYPH_COLS;
+
+    default:
+        return len;
+    }
+}
+
+esp_err_t ftb8md_bus_transmit(spi_host_device_t host_id, spi_device_handle_t spi, const uint8_t *cmd, size_t len)
+{
+    bus_host_t *host = host_id >= 0 && host_id < SPI_HOST_MAX ? &s_hosts[host_id] : NULL;
+
+    portENTER_CRITICAL(&s_bus_lock);
+    size_t piece = bus_piece_len(host, cmd, len);
+    portEXIT_CRITICAL(&s_bus_lock);
+
+    if (piece >= len)
+    {
+        return bus_send_piece(host, spi, cmd, len);
+    }
+
+    // Addresses auto-increment, so each piece restarts at the next address
+    bool cgram = (cmd[0] >> 5) == CMD_PREFIX_CGRAM;
+    uint8_t buf[FTB8MD_CMD_MAX_LEN];
+    esp_err_t ret = ESP_OK;
+
+    for (size_t off = 1; off < len && ret == ESP_OK; off += piece - 1)
+    {
+        size_t n = len - off < piece - 1 ? len - off : piece - 1;
+        size_t step = cgram ? (off - 1) / FTB8MD_GLYPH_COLS : off - 1;
+
+        buf[0] = cgram ? (uint8_t)((cmd[0] & 0xF8) | (((cmd[0] & 0x07) + step) & 0x07))
+                       : (uint8_t)((cmd[0] & 0xE0) | (((cmd[0] & 0x1F) + step) & 0x1F));
+        memcpy(&buf[1], &cmd[off], n);
+
+        ret = bus_send_piece(host, spi, buf, 1 + n);
+        if (ret == ESP_OK && off > 1)
+        {
+            portENTER_CRITICAL(&s_bus_lock);
+            host->stats.splits++;
+            portEXIT_CRITICAL(&s_bus_lock);
+        }
+    }
+
+    return ret;
+}
+
+esp_err_t ftb8md_bus_set_budget(spi_host_device_t host_id, const ftb8md_bus_budget_t *budget)
+{
+    if (host_id < 0 || host_id >= SPI_HOST_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (budget != NULL && budget->max_bytes_per_window != 0 && budget->window_us == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    bus_host_t *host = &s_hosts[host_id];
+
+    portENTER_CRITICAL(&s_bus_lock);
+    host->limited = budget != NULL;
+    if (budget != NULL)
+    {
+        host->budget = *budget;
+    }
+    host->tat_us = 0;
+    portEXIT_CRITICAL(&s_bus_lock);
+
+    return ESP_OK;
+}
+
+esp_err_t ftb8md_bus_get_stats(spi_host_device_t host_id, ftb8md_bus_stats_t *stats)
+{
+    if (host_id < 0 || host_id >= SPI_HOST_MAX || stats == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    bus_host_t *host = &s_hosts[host_id];
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&s_bus_lock);
+    *stats = host->stats;
+    stats->elapsed_us = (uint64_t)(now - host->stats_start_us);
+    portEXIT_CRITICAL(&s_bus_lock);
+
+    stats->duty_permille = stats->elapsed_us != 0 ? (uint16_t)(stats->wire_us * 1000 / stats->elapsed_us) : 0;
+
+    return ESP_OK;
+}
+
+void ftb8md_bus_reset_stats(spi_host_device_t host_id)
+{
+    if (host_id < 0 || host_id >= SPI_HOST_MAX)
+    {
+        return;
+    }
+
+    bus_host_t *host = &s_hosts[host_id];
+
+    portENTER_CRITICAL(&s_bus_lock);
+    memset(&host->stats, 0, sizeof(host->stats));
+    host->stats_start_us = esp_timer_get_time();
+    portEXIT_CRITICAL(&s_bus_lock);
+}
+
+esp_err_t ftb8md_bus_acquire(spi_device_handle_t handle, TickType_t timeout)
+{
+    ftb8md_panel_t *panel = ftb8md_panel_get(handle);
+    if (panel == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!ftb8md_panel_trylock(panel, timeout))
+    {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    if (panel->session_depth == 0)
+    {
+        // The worker task transmits queued commands; holding the bus here
+        // would only stall it until the session ends.
+        panel->session_bus_held = false;
+        if (!ftb8md_sched_running() && panel->par == NULL)
+        {
+            esp_err_t ret = spi_device_acquire_bus(handle, portMAX_DELAY);
+            if (ret != ESP_OK)
+            {
+                ftb8md_panel_unlock(panel);
+                return ret;
+            }
+            panel->session_bus_held = true;
+        }
+    }
+    panel->session_depth++;
+
+    // The panel lock stays taken until ftb8md_bus_release()
+    return ESP_OK;
+}
+
+void ftb8md_bus_release(spi_device_handle_t handle)
+{
+    ftb8md_panel_t *panel = ftb8md_panel_get(handle);
+    if (panel == NULL || panel->session_depth == 0)
+    {
+        return;
+    }
+
+    if (--panel->session_depth == 0 && panel->session_bus_held)
+    {
+        spi_device_release_bus(handle);
+        panel->session_bus_held = false;
+    }
+    ftb8md_panel_unlock(panel);
+}
@@ -0,0 +1,85 @@
+/**
+ * @file ftb-8-md-cost.c
+ * @brief Bus cost of command sequences.
+ */
+
+#include "ftb-8-md-cost.h"
+#include "ftb-8-md-priv.h"
+
+static const ftb8md_cost_model_t s_default_model = FTB8MD_COST_MODEL_DEFAULT();
+
+void ftb8md_cost_add(ftb8md_cost_t *cost, const ftb8md_cost_model_t *model, size_t len)
+{
+    if (model == NULL)
+    {
+        model = &s_default_model;
+    }
+
+    cost->transactions++;
+    cost->bytes += len;
+    cost->wire_us += model->overhead_us +
+                     (uint32_t)(((uint64_t)len * 8 * 1000000 + model->clock_hz - 1) / model->clock_hz);
+}
+
+uint32_t ftb8md_cost_frame_rate(const ftb8md_cost_t *frame, uint16_t share_permille)
+{
+    if (frame->wire_us == 0)
+    {
+        return UINT32_MAX;
+    }
+
+    return (uint32_t)((uint64_t)share_permille * 1000 / frame->wire_us);
+}
+
+#if FTB8MD_COST_ENABLED
+esp_err_t ftb8md_cost_begin(spi_device_handle_t handle, const ftb8md_cost_model_t *model)
+{
+    ftb8md_panel_t *panel = ftb8md_panel_get(handle);
+    if (panel == NULL || (model != NULL && model->clock_hz == 0))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_OK;
+
+    ftb8md_panel_lock(panel);
+    if (panel->cost_active)
+    {
+        ret = ESP_ERR_INVALID_STATE;
+    }
+    else
+    {
+        panel->cost_model = model != NULL ? *model : s_default_model;
+        panel->cost = (ftb8md_cost_t){0};
+        panel->cost_active = true;
+    }
+    ftb8md_panel_unlock(panel);
+
+    return ret;
+}
+
+esp_err_t ftb8md_cost_end(spi_device_handle_t handle, ftb8md_cost_t *cost)
+{
+    ftb8md_panel_t *panel = ftb8md_panel_get(handle);
+    if (panel == NULL || cost == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_OK;
+
+    ftb8md_panel_lock(panel);
+    if (!panel->cost_active)
+    {
+        ret = ESP_ERR_INVALID_STATE;
+    }
+    else
+    {
+        *cost = panel->cost;
+        panel->cost_active = false;
+    }
+    ftb8md_panel_unlock(panel);
+
+    return ret;
+}
+#endif
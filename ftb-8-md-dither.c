@@ -0,0 +1,289 @@
+/**
+ * @file ftb-8-md-dither.c
+ * @brief Per-digit brightness by temporal dithering.
+ */
+
+#include "ftb-8-md-dither.h"
+#include "ftb-8-md-priv.h"
+#include "ftb-8-md-sched.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include <string.h>
+
+static const char *TAG = "FTB8MD_DITHER";
+
+/** @brief Character shown while a digit is blanked */
+#define DITHER_BLANK 0x20
+
+/**
+ * @brief Digits that are blank in a frame.
+ */
+static uint8_t dither_off_mask(const ftb8md_panel_t *panel, uint8_t frame)
+{
+    uint8_t mask = 0;
+
+    for (int d = 0; d < FTB8MD_NUM_DIGITS; d++)
+    {
+        if (panel->dither_level[d] <= frame)
+        {
+            mask |= 1u << d;
+        }
+    }
+
+    return mask;
+}
+
+/**
+ * @brief Digits dithering has to switch: known and not showing a blank anyway.
+ */
+static uint8_t dither_visible_mask(const ftb8md_panel_t *panel)
+{
+    uint8_t mask = 0;
+
+    for (int d = 0; d < FTB8MD_NUM_DIGITS; d++)
+    {
+        if (panel->shadow.dcram[d] != DITHER_BLANK)
+        {
+            mask |= 1u << d;
+        }
+    }
+
+    // Unknown digits are left alone; blanking them could not be undone
+    return mask & panel->shadow.dcram_valid;
+}
+
+/**
+ * @brief Number of runs of consecutive digits in a mask.
+ */
+static int dither_runs(uint8_t mask)
+{
+    return __builtin_popcount(mask & ~(mask << 1));
+}
+
+/**
+ * @brief Blank digits, or show their real characters again.
+ *
+ * Consecutive digits are written with one command. The shadow is not
+ * touched, so it keeps the real characters.
+ *
+ * @param panel Panel state (locked)
+ * @param mask Digits to write
+ * @param blank true to blank the digits, false to show them
+ * @return ESP_OK on success, or an error code on failure
+ */
+static esp_err_t dither_write(ftb8md_panel_t *panel, uint8_t mask, bool blank)
+{
+    esp_err_t ret = ESP_OK;
+    int d = 0;
+
+    while (d < FTB8MD_NUM_DIGITS && ret == ESP_OK)
+    {
+        if (!(mask & (1u << d)))
+        {
+            d++;
+            continue;
+        }
+
+        uint8_t cmd[1 + FTB8MD_NUM_DIGITS];
+        uint8_t run = 0;
+        size_t len = 1;
+
+        cmd[0] = FTB8MD_CMD_DCRAM(d);
+        for (; d < FTB8MD_NUM_DIGITS && (mask & (1u << d)); d++)
+        {
+            cmd[len++] = blank ? DITHER_BLANK : panel->shadow.dcram[d];
+            run |= 1u << d;
+        }
+
+        ret = ftb8md_sched_running() ? ftb8md_sched_submit(panel, cmd, len, FTB8MD_PRIO_NORMAL, false)
+                                     : ftb8md_panel_transmit(panel, cmd, len);
+        if (ret == ESP_OK)
+        {
+            panel->dither_blanked = blank ? panel->dither_blanked | run : panel->dither_blanked & ~run;
+        }
+    }
+
+    return ret;
+}
+
+static void dither_timer_cb(void *arg)
+{
+    ftb8md_panel_t *panel = arg;
+
+    // Never block the esp_timer task on a writer; the frame is held until the next tick instead
+    if (!ftb8md_panel_trylock(panel, 0))
+    {
+        return;
+    }
+
+    // Nor on a full queue: with commands still waiting the frame is held as well
+    if (ftb8md_sched_running() && !ftb8md_sched_idle())
+    {
+        ftb8md_panel_unlock(panel);
+        return;
+    }
+
+    panel->dither_frame = (panel->dither_frame + 1) % panel->dither_levels;
+
+    uint8_t off = dither_off_mask(panel, panel->dither_frame) & dither_visible_mask(panel);
+    esp_err_t ret = dither_write(panel, off & ~panel->dither_blanked, true);
+    if (ret == ESP_OK)
+    {
+        ret = dither_write(panel, panel->dither_blanked & ~off, false);
+    }
+
+    ftb8md_panel_unlock(panel);
+
+    // Over the bus budget the frame is simply held; the next tick writes what it needs
+    if (ret != ESP_OK && ret != ESP_ERR_TIMEOUT)
+    {
+        ESP_LOGW(TAG, "Failed to update frame: %s", esp_err_to_name(ret));
+    }
+}
+
+esp_err_t ftb8md_dither_start(spi_device_handle_t handle, const ftb8md_dither_config_t *config)
+{
+    ftb8md_dither_config_t defaults = FTB8MD_DITHER_CONFIG_DEFAULT();
+    if (config == NULL)
+    {
+        config = &defaults;
+    }
+
+    ftb8md_panel_t *panel = ftb8md_panel_get(handle);
+    if (panel == NULL || config->frame_us == 0 || config->levels < 2 || config->levels > FTB8MD_DITHER_MAX_LEVELS)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_OK;
+
+    ftb8md_panel_lock(panel);
+
+    if (panel->dither_timer == NULL)
+    {
+        esp_timer_create_args_t args = {
+            .callback = dither_timer_cb,
+            .arg = panel,
+            .name = "ftb8md_dither",
+        };
+        ret = esp_timer_create(&args, &panel->dither_timer);
+    }
+    else
+    {
+        esp_timer_stop(panel->dither_timer);
+    }
+
+    if (ret == ESP_OK)
+    {
+        panel->dither_levels = config->levels;
+        panel->dither_frame_us = config->frame_us;
+        // The first tick starts a new cycle
+        panel->dither_frame = config->levels - 1;
+        memset(panel->dither_level, config->levels, sizeof(panel->dither_level));
+        ret = esp_timer_start_periodic(panel->dither_timer, config->frame_us);
+    }
+    else
+    {
+        panel->dither_timer = NULL;
+        ret = ESP_ERR_NO_MEM;
+    }
+
+    ftb8md_panel_unlock(panel);
+
+    return ret;
+}
+
+esp_err_t ftb8md_dither_stop(spi_device_handle_t handle)
+{
+    ftb8md_panel_t *panel = ftb8md_panel_get(handle);
+    if (panel == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_OK;
+
+    ftb8md_panel_lock(panel);
+    if (panel->dither_timer != NULL)
+    {
+        esp_timer_stop(panel->dither_timer);
+        esp_timer_delete(panel->dither_timer);
+        panel->dither_timer = NULL;
+        ret = dither_write(panel, panel->dither_blanked, false);
+    }
+    ftb8md_panel_unlock(panel);
+
+    return ret;
+}
+
+esp_err_t ftb8md_dither_set_level(spi_device_handle_t handle, int digit, int count, uint8_t level)
+{
+    ftb8md_panel_t *panel = ftb8md_panel_get(handle);
+    if (panel == NULL || digit < 0 || count < 0 || digit + count > FTB8MD_NUM_DIGITS)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_OK;
+
+    ftb8md_panel_lock(panel);
+    if (panel->dither_timer == NULL)
+    {
+        ret = ESP_ERR_INVALID_STATE;
+    }
+    else if (level > panel->dither_levels)
+    {
+        ret = ESP_ERR_INVALID_ARG;
+    }
+    else
+    {
+        memset(&panel->dither_level[digit], level, count);
+    }
+    ftb8md_panel_unlock(panel);
+
+    return ret;
+}
+
+esp_err_t ftb8md_dither_get_load(spi_device_handle_t handle, ftb8md_dither_load_t *load)
+{
+    ftb8md_panel_t *panel = ftb8md_panel_get(handle);
+    if (panel == NULL || load == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ftb8md_panel_lock(panel);
+
+    if (panel->dither_timer == NULL)
+    {
+        ftb8md_panel_unlock(panel);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Frame 0 shows every dimmed digit, frame k blanks the digits at level k
+    uint8_t n = panel->dither_levels;
+    uint8_t visible = dither_visible_mask(panel);
+    uint8_t on = ~dither_off_mask(panel, 0) & dither_off_mask(panel, n - 1) & visible;
+    uint32_t transactions = dither_runs(on);
+    uint32_t bytes = __builtin_popcount(on) + dither_runs(on);
+
+    for (uint8_t k = 1; k < n; k++)
+    {
+        uint8_t off = dither_off_mask(panel, k) & ~dither_off_mask(panel, k - 1) & visible;
+        transactions += dither_runs(off);
+        bytes += __builtin_popcount(off) + dither_runs(off);
+    }
+
+    uint64_t cycle_us = (uint64_t)n * panel->dither_frame_us;
+
+    ftb8md_panel_unlock(panel);
+
+    load->transactions_per_cycle = transactions;
+    load->bytes_per_cycle = bytes;
+    load->bytes_per_sec = (uint32_t)((uint64_t)bytes * 1000000 / cycle_us);
+    load->bus_permille = (uint16_t)((uint64_t)load->bytes_per_sec * 8 * 1000 / FTB8MD_SPI_CLOCK_HZ);
+
+    return ESP_OK;
+}
@@ -0,0 +1,132 @@
+/**
+ * @file ftb-8-md-glyphs.c
+ * @brief Built-in glyphs for code points that are not in the panel ROM.
+ *
+ * Generated by tools/ftb8md_fontc.py from tools/fonts/extended.txt. Do not edit.
+ */
+
+#include "ftb-8-md-font.h"
+
+static const uint32_t s_extended_codepoints[] = {
+    0x00A1, /* inverted exclamation mark */
+    0x00A3, /* pound sign */
+    0x00A5, /* yen sign */
+    0x00A7, /* section sign */
+    0x00B0, /* degree sign */
+    0x00B1, /* plus-minus sign */
+    0x00B2, /* superscript two */
+    0x00B3, /* superscript three */
+    0x00B5, /* micro sign */
+    0x00B7, /* middle dot */
+    0x00BF, /* inverted question mark */
+    0x00C4, /* latin capital letter a with diaeresis */
+    0x00C5, /* latin capital letter a with ring above */
+    0x00C7, /* latin capital letter c with cedilla */
+    0x00C9, /* latin capital letter e with acute */
+    0x00D1, /* latin capital letter n with tilde */
+    0x00D6, /* latin capital letter o with diaeresis */
+    0x00D7, /* multiplication sign */
+    0x00DC, /* latin capital letter u with diaeresis */
+    0x00DF, /* latin small letter sharp s */
+    0x00E0, /* latin small letter a with grave */
+    0x00E1, /* latin small letter a with acute */
+    0x00E2, /* latin small letter a with circumflex */
+    0x00E4, /* latin small letter a with diaeresis */
+    0x00E5, /* latin small letter a with ring above */
+    0x00E7, /* latin small letter c with cedilla */
+    0x00E8, /* latin small letter e with grave */
+    0x00E9, /* latin small letter e with acute */
+    0x00EA, /* latin small letter e with circumflex */
+    0x00EB, /* latin small letter e with diaeresis */
+    0x00ED, /* latin small letter i with acute */
+    0x00EE, /* latin small letter i with circumflex */
+    0x00F1, /* latin small letter n with tilde */
+    0x00F3, /* latin small letter o with acute */
+    0x00F4, /* latin small letter o with circumflex */
+    0x00F6, /* latin small letter o with diaeresis */
+    0x00F7, /* division sign */
+    0x00FA, /* latin small letter u with acute */
+    0x00FC, /* latin small letter u with diaeresis */
+    0x03A9, /* greek capital letter omega */
+    0x2026, /* horizontal ellipsis */
+    0x203B, /* reference mark */
+    0x20AC, /* euro sign */
+    0x2103, /* degree celsius */
+    0x2190, /* leftwards arrow */
+    0x2191, /* upwards arrow */
+    0x2192, /* rightwards arrow */
+    0x2193, /* downwards arrow */
+    0x25A0, /* black square */
+    0x25A1, /* white square */
+    0x25B2, /* black up-pointing triangle */
+    0x25BC, /* black down-pointing triangle */
+    0x2665, /* black heart suit */
+    0x266A, /* eighth note */
+    0x2713, /* check mark */
+    0x30FB, /* katakana middle dot */
+};
+
+static const uint8_t s_extended_glyphs[][FTB8MD_GLYPH_COLS] = {
+    {0x00, 0x00, 0x7D, 0x00, 0x00}, /* U+00A1 */
+    {0x48, 0x3E, 0x49, 0x41, 0x22}, /* U+00A3 */
+    {0x15, 0x16, 0x7C, 0x16, 0x15}, /* U+00A5 */
+    {0x4A, 0x55, 0x55, 0x55, 0x29}, /* U+00A7 */
+    {0x06, 0x09, 0x09, 0x06, 0x00}, /* U+00B0 */
+    {0x44, 0x44, 0x5F, 0x44, 0x44}, /* U+00B1 */
+    {0x00, 0x19, 0x15, 0x12, 0x00}, /* U+00B2 */
+    {0x00, 0x11, 0x15, 0x0A, 0x00}, /* U+00B3 */
+    {0x7C, 0x20, 0x20, 0x10, 0x3C}, /* U+00B5 */
+    {0x00, 0x00, 0x08, 0x00, 0x00}, /* U+00B7 */
+    {0x30, 0x48, 0x45, 0x40, 0x20}, /* U+00BF */
+    {0x78, 0x15, 0x14, 0x15, 0x78}, /* U+00C4 */
+    {0x70, 0x2A, 0x2D, 0x2A, 0x70}, /* U+00C5 */
+    {0x0E, 0x51, 0x71, 0x11, 0x0A}, /* U+00C7 */
+    {0x7C, 0x54, 0x56, 0x55, 0x44}, /* U+00C9 */
+    {0x7E, 0x09, 0x12, 0x21, 0x7C}, /* U+00D1 */
+    {0x38, 0x45, 0x44, 0x45, 0x38}, /* U+00D6 */
+    {0x22, 0x14, 0x08, 0x14, 0x22}, /* U+00D7 */
+    {0x3C, 0x41, 0x40, 0x41, 0x3C}, /* U+00DC */
+    {0x7E, 0x01, 0x45, 0x4A, 0x30}, /* U+00DF */
+    {0x20, 0x55, 0x56, 0x54, 0x78}, /* U+00E0 */
+    {0x20, 0x54, 0x56, 0x55, 0x78}, /* U+00E1 */
+    {0x20, 0x56, 0x55, 0x56, 0x78}, /* U+00E2 */
+    {0x20, 0x55, 0x54, 0x55, 0x78}, /* U+00E4 */
+    {0x20, 0x57, 0x57, 0x54, 0x78}, /* U+00E5 */
+    {0x0C, 0x52, 0x72, 0x12, 0x00}, /* U+00E7 */
+    {0x38, 0x55, 0x56, 0x54, 0x18}, /* U+00E8 */
+    {0x38, 0x54, 0x56, 0x55, 0x18}, /* U+00E9 */
+    {0x38, 0x56, 0x55, 0x56, 0x18}, /* U+00EA */
+    {0x38, 0x55, 0x54, 0x55, 0x18}, /* U+00EB */
+    {0x00, 0x48, 0x7A, 0x41, 0x00}, /* U+00ED */
+    {0x00, 0x4A, 0x79, 0x42, 0x00}, /* U+00EE */
+    {0x7A, 0x09, 0x0A, 0x09, 0x70}, /* U+00F1 */
+    {0x30, 0x48, 0x4A, 0x49, 0x30}, /* U+00F3 */
+    {0x30, 0x4A, 0x49, 0x4A, 0x30}, /* U+00F4 */
+    {0x38, 0x45, 0x44, 0x45, 0x38}, /* U+00F6 */
+    {0x08, 0x08, 0x2A, 0x08, 0x08}, /* U+00F7 */
+    {0x38, 0x40, 0x42, 0x21, 0x78}, /* U+00FA */
+    {0x3C, 0x41, 0x40, 0x21, 0x7C}, /* U+00FC */
+    {0x4E, 0x71, 0x01, 0x71, 0x4E}, /* U+03A9 */
+    {0x40, 0x00, 0x40, 0x00, 0x40}, /* U+2026 */
+    {0x49, 0x22, 0x1C, 0x22, 0x49}, /* U+203B */
+    {0x14, 0x3E, 0x55, 0x55, 0x41}, /* U+20AC */
+    {0x01, 0x3E, 0x41, 0x41, 0x22}, /* U+2103 */
+    {0x08, 0x1C, 0x2A, 0x08, 0x08}, /* U+2190 */
+    {0x04, 0x02, 0x7F, 0x02, 0x04}, /* U+2191 */
+    {0x08, 0x08, 0x2A, 0x1C, 0x08}, /* U+2192 */
+    {0x10, 0x20, 0x7F, 0x20, 0x10}, /* U+2193 */
+    {0x3E, 0x3E, 0x3E, 0x3E, 0x3E}, /* U+25A0 */
+    {0x3E, 0x22, 0x22, 0x22, 0x3E}, /* U+25A1 */
+    {0x20, 0x38, 0x3E, 0x38, 0x20}, /* U+25B2 */
+    {0x02, 0x0E, 0x3E, 0x0E, 0x02}, /* U+25BC */
+    {0x0C, 0x1E, 0x3C, 0x1E, 0x0C}, /* U+2665 */
+    {0x20, 0x70, 0x3F, 0x02, 0x04}, /* U+266A */
+    {0x08, 0x10, 0x08, 0x04, 0x02}, /* U+2713 */
+    {0x00, 0x08, 0x1C, 0x08, 0x00}, /* U+30FB */
+};
+
+const ftb8md_glyph_table_t ftb8md_glyphs_extended = {
+    .codepoints = s_extended_codepoints,
+    .glyphs = s_extended_glyphs,
+    .count = sizeof(s_extended_codepoints) / sizeof(s_extended_codepoints[0]),
+};
@@ -0,0 +1,428 @@
+/**
+ * @file ftb-8-md-layer.c
+ * @brief Layer compositor with priorities, transparency and expiry.
+ */
+
+#include "ftb-8-md-layer.h"
+#include "ftb-8-md-priv.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include <string.h>
+
+static const char *TAG = "FTB8MD_LAYER";
+
+/** @brief Guards the closing flags against the expiry timers re-arming themselves */
+static portMUX_TYPE s_layer_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void ftb8md_compositor_init(ftb8md_compositor_t *comp, spi_device_handle_t handle)
+{
+    if (comp == NULL)
+    {
+        return;
+    }
+
+    memset(comp, 0, sizeof(*comp));
+    comp->handle = handle;
+}
+
+void ftb8md_layer_init(ftb8md_layer_t *layer, int priority)
+{
+    if (layer == NULL)
+    {
+        return;
+    }
+
+    memset(layer, 0, sizeof(*layer));
+    layer->priority = priority;
+}
+
+void ftb8md_layer_clear(ftb8md_layer_t *layer)
+{
+    if (layer == NULL)
+    {
+        return;
+    }
+
+    layer->opaque = 0;
+}
+
+void ftb8md_layer_set_string(ftb8md_layer_t *layer, int digit, const char *str)
+{
+    if (layer == NULL || str == NULL || digit < 0)
+    {
+        return;
+    }
+
+    for (int d = digit; d < FTB8MD_NUM_DIGITS && *str != '\0'; d++, str++)
+    {
+        layer->code[d] = (uint8_t)*str;
+        layer->opaque |= 1u << d;
+    }
+}
+
+void ftb8md_layer_set_char(ftb8md_layer_t *layer, int digit, uint8_t code)
+{
+    if (layer == NULL || digit < 0 || digit >= FTB8MD_NUM_DIGITS)
+    {
+        return;
+    }
+
+    layer->code[digit] = code;
+    layer->opaque |= 1u << digit;
+}
+
+void ftb8md_layer_set_adram(ftb8md_layer_t *layer, int digit, uint8_t value)
+{
+    if (layer == NULL || digit < 0 || digit >= FTB8MD_NUM_DIGITS)
+    {
+        return;
+    }
+
+    layer->adram[digit] = value;
+}
+
+void ftb8md_layer_set_transparent(ftb8md_layer_t *layer, int digit, int count)
+{
+    if (layer == NULL)
+    {
+        return;
+    }
+
+    for (int d = digit; d < digit + count && d < FTB8MD_NUM_DIGITS; d++)
+    {
+        if (d >= 0)
+        {
+            layer->opaque &= ~(1u << d);
+        }
+    }
+}
+
+/**
+ * @brief Remove a layer from the stack without redrawing.
+ */
+static void layer_unlink(ftb8md_compositor_t *comp, ftb8md_layer_t *layer)
+{
+    for (ftb8md_layer_t **p = &comp->top; *p != NULL; p = &(*p)->next)
+    {
+        if (*p == layer)
+        {
+            *p = layer->next;
+            break;
+        }
+    }
+
+    layer->next = NULL;
+    layer->owner = NULL;
+}
+
+/**
+ * @brief Remove layers whose timeout has passed.
+ */
+static void expire_layers(ftb8md_compositor_t *comp, int64_t now)
+{
+    ftb8md_layer_t **p = &comp->top;
+    while (*p != NULL)
+    {
+        ftb8md_layer_t *layer = *p;
+        if (layer->expires_us != 0 && layer->expires_us <= now)
+        {
+            *p = layer->next;
+            layer->next = NULL;
+            layer->owner = NULL;
+        }
+        else
+        {
+            p = &layer->next;
+        }
+    }
+}
+
+/**
+ * @brief Composite the stack and write the digits that change.
+ *
+ * Must be called with the panel lock held.
+ */
+static esp_err_t compose(ftb8md_compositor_t *comp, ftb8md_panel_t *panel)
+{
+    uint8_t code[FTB8MD_NUM_DIGITS];
+    uint8_t adram[FTB8MD_NUM_DIGITS];
+    uint8_t covered = 0;
+
+    memset(code, FTB8MD_LAYER_BACKGROUND, sizeof(code));
+    memset(adram, 0, sizeof(adram));
+
+    // Top-down: the first layer covering a digit decides it
+    for (const ftb8md_layer_t *layer = comp->top; layer != NULL && covered != FTB8MD_DIGIT_MASK; layer = layer->next)
+    {
+        uint8_t take = layer->opaque & ~covered;
+        for (int d = 0; d < FTB8MD_NUM_DIGITS; d++)
+        {
+            if (take & (1u << d))
+            {
+                code[d] = layer->code[d];
+                adram[d] = layer->adram[d];
+            }
+        }
+        covered |= take;
+    }
+
+    esp_err_t ret = ftb8md_panel_write_diff(panel, CMD_PREFIX_DCRAM, code, FTB8MD_DIGIT_MASK);
+    if (ret == ESP_OK)
+    {
+        ret = ftb8md_panel_write_diff(panel, CMD_PREFIX_ADRAM, adram, FTB8MD_DIGIT_MASK);
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Arm the expiry timer, unless ftb8md_compositor_deinit() has started.
+ */
+static void timer_arm(ftb8md_compositor_t *comp, uint64_t delay_us)
+{
+    portENTER_CRITICAL(&s_layer_lock);
+    if (!comp->closing)
+    {
+        esp_timer_start_once(comp->timer, delay_us);
+    }
+    portEXIT_CRITICAL(&s_layer_lock);
+}
+
+/**
+ * @brief Re-arm the expiry timer for the earliest timeout in the stack.
+ *
+ * Must be called with the panel lock held.
+ */
+static void timer_update(ftb8md_compositor_t *comp)
+{
+    if (comp->timer == NULL)
+    {
+        return;
+    }
+
+    esp_timer_stop(comp->timer);
+    int64_t next = ftb8md_compositor_next_expiry(comp);
+    if (next >= 0)
+    {
+        timer_arm(comp, (uint64_t)next);
+    }
+}
+
+static void compositor_timer_cb(void *arg)
+{
+    ftb8md_compositor_t *comp = arg;
+    ftb8md_panel_t *panel = ftb8md_panel_get(comp->handle);
+    if (panel == NULL)
+    {
+        return;
+    }
+
+    // Runs on the esp_timer task, which must not wait for a writer
+    if (!ftb8md_panel_trylock(panel, 0))
+    {
+        timer_arm(comp, FTB8MD_LOCK_RETRY_US);
+        return;
+    }
+
+    expire_layers(comp, esp_timer_get_time());
+    esp_err_t ret = compose(comp, panel);
+    if (ret == ESP_ERR_TIMEOUT)
+    {
+        // Refused by the bus budget; the uncovered digits are still to be sent
+        timer_arm(comp, FTB8MD_LOCK_RETRY_US);
+    }
+    else
+    {
+        timer_update(comp);
+    }
+
+    ftb8md_panel_unlock(panel);
+
+    if (ret != ESP_OK && ret != ESP_ERR_TIMEOUT)
+    {
+        ESP_LOGW(TAG, "Failed to remove expired layers: %s", esp_err_to_name(ret));
+    }
+}
+
+esp_err_t ftb8md_compositor_deinit(ftb8md_compositor_t *comp)
+{
+    if (comp == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (comp->timer == NULL)
+    {
+        return ESP_OK;
+    }
+
+    portENTER_CRITICAL(&s_layer_lock);
+    comp->closing = true;
+    portEXIT_CRITICAL(&s_layer_lock);
+
+    // Holding the panel lock waits out a callback that is compositing
+    ftb8md_panel_t *panel = ftb8md_panel_get(comp->handle);
+    if (panel != NULL)
+    {
+        ftb8md_panel_lock(panel);
+    }
+
+    esp_timer_stop(comp->timer);
+    esp_err_t ret = esp_timer_delete(comp->timer);
+    if (ret == ESP_OK)
+    {
+        comp->timer = NULL;
+    }
+
+    if (panel != NULL)
+    {
+        ftb8md_panel_unlock(panel);
+    }
+
+    return ret == ESP_OK ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t ftb8md_compositor_push(ftb8md_compositor_t *comp, ftb8md_layer_t *layer, uint32_t timeout_ms)
+{
+    if (comp == NULL || layer == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ftb8md_panel_t *panel = ftb8md_panel_get(comp->handle);
+    if (panel == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ftb8md_panel_lock(panel);
+
+    if (layer->owner != NULL && layer->owner != comp)
+    {
+        ftb8md_panel_unlock(panel);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (timeout_ms != 0 && comp->timer == NULL)
+    {
+        esp_timer_create_args_t args = {
+            .callback = compositor_timer_cb,
+            .arg = comp,
+            .name = "ftb8md_layer",
+        };
+        if (esp_timer_create(&args, &comp->timer) != ESP_OK)
+        {
+            ftb8md_panel_unlock(panel);
+            return ESP_ERR_NO_MEM;
+        }
+        comp->closing = false;
+    }
+
+    if (layer->owner != NULL)
+    {
+        layer_unlink(comp, layer);
+    }
+
+    int64_t now = esp_timer_get_time();
+    layer->expires_us = timeout_ms != 0 ? now + (int64_t)timeout_ms * 1000 : 0;
+
+    // Insert above all layers of lower or equal priority
+    ftb8md_layer_t **p = &comp->top;
+    while (*p != NULL && (*p)->priority > layer->priority)
+    {
+        p = &(*p)->next;
+    }
+    layer->next = *p;
+    layer->owner = comp;
+    *p = layer;
+
+    expire_layers(comp, now);
+    esp_err_t ret = compose(comp, panel);
+    timer_update(comp);
+
+    ftb8md_panel_unlock(panel);
+
+    return ret;
+}
+
+esp_err_t ftb8md_compositor_remove(ftb8md_compositor_t *comp, ftb8md_layer_t *layer)
+{
+    if (comp == NULL || layer == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ftb8md_panel_t *panel = ftb8md_panel_get(comp->handle);
+    if (panel == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ftb8md_panel_lock(panel);
+
+    if (layer->owner != comp)
+    {
+        ftb8md_panel_unlock(panel);
+        return layer->owner == NULL ? ESP_OK : ESP_ERR_INVALID_STATE;
+    }
+
+    layer_unlink(comp, layer);
+    expire_layers(comp, esp_timer_get_time());
+    esp_err_t ret = compose(comp, panel);
+    timer_update(comp);
+
+    ftb8md_panel_unlock(panel);
+
+    return ret;
+}
+
+esp_err_t ftb8md_compositor_refresh(ftb8md_compositor_t *comp)
+{
+    if (comp == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ftb8md_panel_t *panel = ftb8md_panel_get(comp->handle);
+    if (panel == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ftb8md_panel_lock(panel);
+
+    expire_layers(comp, esp_timer_get_time());
+    esp_err_t ret = compose(comp, panel);
+    timer_update(comp);
+
+    ftb8md_panel_unlock(panel);
+
+    return ret;
+}
+
+int64_t ftb8md_compositor_next_expiry(const ftb8md_compositor_t *comp)
+{
+    if (comp == NULL)
+    {
+        return -1;
+    }
+
+    int64_t next = -1;
+    for (const ftb8md_layer_t *layer = comp->top; layer != NULL; layer = layer->next)
+    {
+        if (layer->expires_us != 0 && (next < 0 || layer->expires_us < next))
+        {
+            next = layer->expires_us;
+        }
+    }
+
+    if (next < 0)
+    {
+        return -1;
+    }
+
+    int64_t now = esp_timer_get_time();
+    return next > now ? next - now : 0;
+}
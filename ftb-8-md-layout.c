@@ -0,0 +1,328 @@
+/**
+ * @file ftb-8-md-layout.c
+ * @brief Text layout: alignment, truncation and paging of long messages.
+ */
+
+#include "ftb-8-md-layout.h"
+#include "ftb-8-md-priv.h"
+
+#include "esp_log.h"
+
+#include <string.h>
+
+static const char *TAG = "FTB8MD_LAYOUT";
+
+/** @brief Guards the stopping flags against the page timers re-arming themselves */
+static portMUX_TYPE s_pager_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static const ftb8md_layout_t s_default_layout = FTB8MD_LAYOUT_DEFAULT();
+static const ftb8md_pages_config_t s_default_pages = FTB8MD_PAGES_CONFIG_DEFAULT();
+
+/**
+ * @brief Lay out text in a field, with an ellipsis if it is cut or more text follows it.
+ *
+ * @param more true if the text continues elsewhere, so it is marked as truncated even if it fits
+ * @return Number of bytes of the text shown
+ */
+static size_t layout_codes(const ftb8md_layout_t *layout, const char *str, size_t len, uint8_t *codes, int width,
+                           bool more)
+{
+    bool cut = more || len > (size_t)width;
+    bool mark = cut && layout->ellipsis != FTB8MD_LAYOUT_NO_ELLIPSIS;
+
+    // The ellipsis follows the text directly and is aligned together with it
+    size_t room = (size_t)width - (mark ? 1 : 0);
+    size_t shown = len < room ? len : room;
+    size_t used = shown + (mark ? 1 : 0);
+    size_t spare = (size_t)width - used;
+    size_t start = layout->align == FTB8MD_ALIGN_RIGHT ? spare : layout->align == FTB8MD_ALIGN_CENTER ? spare / 2 : 0;
+
+    memset(codes, layout->fill, (size_t)width);
+    memcpy(&codes[start], str, shown);
+    if (mark)
+    {
+        codes[start + shown] = (uint8_t)layout->ellipsis;
+    }
+
+    return shown;
+}
+
+size_t ftb8md_layout_encode(const ftb8md_layout_t *layout, const char *str, size_t len, uint8_t *codes, int width)
+{
+    if (str == NULL || codes == NULL || width <= 0)
+    {
+        return 0;
+    }
+
+    return layout_codes(layout != NULL ? layout : &s_default_layout, str, len, codes, width, false);
+}
+
+esp_err_t ftb8md_show_aligned(spi_device_handle_t handle, int digit, int width, const char *str,
+                              const ftb8md_layout_t *layout)
+{
+    ftb8md_panel_t *panel = ftb8md_panel_get(handle);
+    if (panel == NULL || str == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (digit < 0 || width <= 0 || digit + width > FTB8MD_NUM_DIGITS)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t codes[FTB8MD_NUM_DIGITS];
+    ftb8md_layout_encode(layout, str, strlen(str), &codes[digit], width);
+
+    return ftb8md_panel_write_diff(panel, CMD_PREFIX_DCRAM, codes, (uint8_t)(((1u << width) - 1) << digit));
+}
+
+size_t ftb8md_pages_build(const char *str, const ftb8md_pages_config_t *config, ftb8md_page_t *pages,
+                          size_t max_pages)
+{
+    if (str == NULL || pages == NULL)
+    {
+        return 0;
+    }
+
+    if (config == NULL)
+    {
+        config = &s_default_pages;
+    }
+
+    size_t count = 0;
+    const char *p = str;
+    while (count < max_pages)
+    {
+        while (*p == ' ' || *p == '\n')
+        {
+            p++;
+        }
+        if (*p == '\0')
+        {
+            break;
+        }
+
+        // Take whole words while they fit; a word longer than a page is split
+        size_t n = 0;
+        size_t i = 0;
+        for (;;)
+        {
+            while (p[i] == ' ')
+            {
+                i++;
+            }
+            if (p[i] == '\0' || p[i] == '\n')
+            {
+                break;
+            }
+
+            size_t word = strcspn(&p[i], " \n");
+            if (i + word > FTB8MD_NUM_DIGITS)
+            {
+                if (n == 0)
+                {
+                    n = FTB8MD_NUM_DIGITS;
+                }
+                break;
+            }
+            i += word;
+            n = i;
+        }
+
+        const char *rest = p + n;
+        while (*rest == ' ' || *rest == '\n')
+        {
+            rest++;
+        }
+
+        ftb8md_page_t *page = &pages[count++];
+        bool more = count == max_pages && *rest != '\0';
+        size_t shown = layout_codes(&config->layout, p, n, page->codes, FTB8MD_NUM_DIGITS, more);
+        page->dwell_ms = config->dwell_ms + config->dwell_per_char_ms * (uint32_t)shown;
+
+        p += n;
+    }
+
+    return count;
+}
+
+esp_err_t ftb8md_page_show(spi_device_handle_t handle, const ftb8md_page_t *page)
+{
+    ftb8md_panel_t *panel = ftb8md_panel_get(handle);
+    if (panel == NULL || page == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return ftb8md_panel_write_diff(panel, CMD_PREFIX_DCRAM, page->codes, FTB8MD_DIGIT_MASK);
+}
+
+static void pager_timer_cb(void *arg)
+{
+    ftb8md_pager_t *pager = arg;
+    ftb8md_panel_t *panel = ftb8md_panel_get(pager->handle);
+    if (panel == NULL)
+    {
+        pager->playing = false;
+        return;
+    }
+
+    if (!ftb8md_panel_trylock(panel, 0))
+    {
+        // Show the page shortly after the writer is done; its dwell starts then
+        portENTER_CRITICAL(&s_pager_lock);
+        if (!pager->stopping)
+        {
+            esp_timer_start_once(pager->timer, FTB8MD_LOCK_RETRY_US);
+        }
+        portEXIT_CRITICAL(&s_pager_lock);
+        return;
+    }
+
+    esp_err_t ret = ESP_OK;
+
+    // The pager lock is the panel lock: ftb8md_pager_stop() clears playing while holding it
+    if (pager->playing)
+    {
+        const ftb8md_page_t *page = &pager->pages[pager->index];
+        ret = ftb8md_panel_write_diff(panel, CMD_PREFIX_DCRAM, page->codes, FTB8MD_DIGIT_MASK);
+
+        if (ret != ESP_OK)
+        {
+            // Show the same page again: soon if the bus budget refused it, after its dwell on an SPI error
+            esp_timer_start_once(pager->timer,
+                                 ret == ESP_ERR_TIMEOUT ? FTB8MD_LOCK_RETRY_US : (uint64_t)page->dwell_ms * 1000);
+        }
+        else if (pager->index + 1 < pager->count || pager->loop)
+        {
+            pager->index = (pager->index + 1) % pager->count;
+            esp_timer_start_once(pager->timer, (uint64_t)page->dwell_ms * 1000);
+        }
+        else
+        {
+            pager->playing = false;
+        }
+    }
+
+    ftb8md_panel_unlock(panel);
+
+    if (ret != ESP_OK && ret != ESP_ERR_TIMEOUT)
+    {
+        ESP_LOGW(TAG, "Failed to show page: %s", esp_err_to_name(ret));
+    }
+}
+
+esp_err_t ftb8md_pager_init(ftb8md_pager_t *pager, spi_device_handle_t handle)
+{
+    if (pager == NULL || ftb8md_panel_get(handle) == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(pager, 0, sizeof(*pager));
+    pager->handle = handle;
+
+    esp_timer_create_args_t args = {
+        .callback = pager_timer_cb,
+        .arg = pager,
+        .name = "ftb8md_pager",
+    };
+    if (esp_timer_create(&args, &pager->timer) != ESP_OK)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t ftb8md_pager_deinit(ftb8md_pager_t *pager)
+{
+    if (pager == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (pager->timer == NULL)
+    {
+        return ESP_OK;
+    }
+
+    // A callback that failed to get the panel must not re-arm the timer once it is stopped
+    portENTER_CRITICAL(&s_pager_lock);
+    pager->stopping = true;
+    portEXIT_CRITICAL(&s_pager_lock);
+
+    ftb8md_pager_stop(pager);
+    if (esp_timer_delete(pager->timer) != ESP_OK)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    pager->timer = NULL;
+
+    return ESP_OK;
+}
+
+esp_err_t ftb8md_pager_start(ftb8md_pager_t *pager, const ftb8md_page_t *pages, size_t count, bool loop)
+{
+    if (pager == NULL || pager->timer == NULL || pages == NULL || count == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // A loop of pages without dwell time would keep the timer task busy
+    uint64_t cycle_ms = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        cycle_ms += pages[i].dwell_ms;
+    }
+    if (loop && cycle_ms == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ftb8md_pager_stop(pager);
+
+    ftb8md_panel_t *panel = ftb8md_panel_get(pager->handle);
+    if (panel == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ftb8md_panel_lock(panel);
+    pager->pages = pages;
+    pager->count = count;
+    pager->index = 0;
+    pager->loop = loop;
+    pager->playing = true;
+    esp_timer_start_once(pager->timer, 0);
+    ftb8md_panel_unlock(panel);
+
+    return ESP_OK;
+}
+
+void ftb8md_pager_stop(ftb8md_pager_t *pager)
+{
+    if (pager == NULL || pager->timer == NULL)
+    {
+        return;
+    }
+
+    ftb8md_panel_t *panel = ftb8md_panel_get(pager->handle);
+    if (panel == NULL)
+    {
+        pager->playing = false;
+        esp_timer_stop(pager->timer);
+        return;
+    }
+
+    ftb8md_panel_lock(panel);
+    pager->playing = false;
+    esp_timer_stop(pager->timer);
+    ftb8md_panel_unlock(panel);
+}
+
+bool ftb8md_pager_is_playing(const ftb8md_pager_t *pager)
+{
+    return pager != NULL && pager->playing;
+}
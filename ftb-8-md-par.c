@@ -0,0 +1,709 @@
+/**
+ * @file ftb-8-md-par.c
+ * @brief Parallel transport: several panels clocked together from one shared clock.
+ */
+
+#include "ftb-8-md-par.h"
+#include "ftb-8-md-priv.h"
+#include "ftb-8-md-sched.h"
+
+#include "freertos/task.h"
+#include "driver/gpio.h"
+#include "esp_log.h"
+#include "esp_rom_sys.h"
+#include "soc/soc_caps.h"
+
+#if SOC_DEDICATED_GPIO_SUPPORTED
+#include "driver/dedic_gpio.h"
+#endif
+
+#include <string.h>
+
+static const char *TAG = "FTB8MD_PAR";
+
+/** @brief Bundle channel of the clock; data line N is channel N + 1 */
+#define PAR_CLK 0x01
+
+/** @brief Half clock period; the panel takes at most 500 kHz */
+#define PAR_HALF_PERIOD_US 1
+
+/* Command slots of a frame, sent in this order */
+enum
+{
+    SLOT_CGRAM,   /**< Glyphs before the digits that show them */
+    SLOT_DCRAM,
+    SLOT_ADRAM,
+    SLOT_DIMMING,
+    SLOT_POWER,
+    SLOT_STANDBY,
+    SLOT_COUNT,
+};
+
+/**
+ * @brief One panel of a group: what was written to it and what a frame still has to send.
+ */
+typedef struct
+{
+    ftb8md_panel_t *panel;                              /**< Driver state of the panel */
+    int cs_pin;                                         /**< Chip select */
+    uint8_t dcram[FTB8MD_NUM_DIGITS];                   /**< Last written character codes */
+    uint8_t adram[FTB8MD_NUM_DIGITS];                   /**< Last written segment pins */
+    uint8_t cgram[FTB8MD_NUM_CGRAM][FTB8MD_GLYPH_COLS]; /**< Last written CGRAM columns */
+    uint8_t dimming;                                    /**< Last written dimming level */
+    bool power_on;                                      /**< Last written display on/off state */
+    bool standby;                                       /**< Last written standby state */
+    uint8_t known_dcram;                                /**< Digits whose dcram entry is known */
+    uint8_t known_adram;                                /**< Digits whose adram entry is known */
+    uint8_t dirty_dcram;                                /**< Digits a frame has to send */
+    uint8_t dirty_adram;                                /**< Dots a frame has to send */
+    uint8_t dirty_cgram;                                /**< CGRAM characters a frame has to send */
+    uint8_t dirty_ctrl;                                 /**< FTB8MD_CTRL_* registers a frame has to send */
+} par_lane_t;
+
+struct ftb8md_par
+{
+    bool used;                                /**< The slot holds a group */
+#if SOC_DEDICATED_GPIO_SUPPORTED
+    dedic_gpio_bundle_handle_t bundle;        /**< Clock and data lines */
+#endif
+    uint32_t bundle_mask;                     /**< All channels of the bundle */
+    SemaphoreHandle_t lock;                   /**< Recursive mutex, held by the task with an open frame */
+    StaticSemaphore_t lock_buf;               /**< Storage for lock */
+    SemaphoreHandle_t clock_lock;             /**< Mutex over the clocking, the lanes and stats */
+    StaticSemaphore_t clock_lock_buf;         /**< Storage for clock_lock */
+    TaskHandle_t frame_owner;                 /**< Task with an open frame */
+    uint8_t frame_depth;                      /**< Nesting depth of the open frame */
+    uint8_t num_lanes;                        /**< Number of panels */
+    par_lane_t lanes[FTB8MD_PAR_MAX_PANELS];  /**< Panels */
+    ftb8md_par_stats_t stats;                 /**< Statistics */
+};
+
+static struct ftb8md_par s_groups[FTB8MD_PAR_MAX_GROUPS];
+
+/** @brief Guards slot allocation in s_groups */
+static portMUX_TYPE s_groups_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static par_lane_t *par_lane(ftb8md_panel_t *panel)
+{
+    return &panel->par->lanes[panel->par_lane];
+}
+
+/**
+ * @brief Record a command in the lane.
+ *
+ * @param lane Lane
+ * @param cmd Encoded command
+ * @param len Length of the command in bytes
+ * @param dirty true to leave the written entries for the frame to send
+ * @return false if the command is not one a frame can collect
+ */
+static bool par_apply(par_lane_t *lane, const uint8_t *cmd, size_t len, bool dirty)
+{
+    unsigned addr = cmd[0] & 0x1F;
+    uint8_t mask = 0;
+
+    switch (cmd[0] >> 5)
+    {
+    case CMD_PREFIX_DCRAM:
+        for (size_t i = 1; i < len && addr < FTB8MD_NUM_DIGITS; i++, addr++)
+        {
+            lane->dcram[addr] = cmd[i];
+            mask |= 1u << addr;
+        }
+        lane->known_dcram |= mask;
+        lane->dirty_dcram = dirty ? lane->dirty_dcram | mask : lane->dirty_dcram & ~mask;
+        return true;
+
+    case CMD_PREFIX_ADRAM:
+        for (size_t i = 1; i < len && addr < FTB8MD_NUM_DIGITS; i++, addr++)
+        {
+            lane->adram[addr] = cmd[i] & 0x0F;
+            mask |= 1u << addr;
+        }
+        lane->known_adram |= mask;
+        lane->dirty_adram = dirty ? lane->dirty_adram | mask : lane->dirty_adram & ~mask;
+        return true;
+
+    case CMD_PREFIX_CGRAM:
+        addr &= 0x07;
+        for (size_t i = 1; i + FTB8MD_GLYPH_COLS <= len && addr < FTB8MD_NUM_CGRAM; i += FTB8MD_GLYPH_COLS, addr++)
+        {
+            memcpy(lane->cgram[addr], &cmd[i], FTB8MD_GLYPH_COLS);
+            mask |= 1u << addr;
+        }
+        lane->dirty_cgram = dirty ? lane->dirty_cgram | mask : lane->dirty_cgram & ~mask;
+        return true;
+
+    default:
+        if ((cmd[0] & 0xFC) == FTB8MD_CMD_DIMMING && len >= 2)
+        {
+            lane->dimming = cmd[1];
+            mask = FTB8MD_CTRL_DIMMING;
+        }
+        else if ((cmd[0] & 0xFC) == FTB8MD_CMD_DISPLAY_ON)
+        {
+            lane->power_on = (cmd[0] & 0x02) == 0;
+            mask = FTB8MD_CTRL_POWER;
+        }
+        else if ((cmd[0] & 0xFC) == (FTB8MD_CMD_MODE_NORMAL & 0xFC))
+        {
+            lane->standby = (cmd[0] & 0x01) != 0;
+            mask = FTB8MD_CTRL_STANDBY;
+        }
+        else
+        {
+            // Digit count and URAM writes are not tracked
+            return false;
+        }
+        lane->dirty_ctrl = dirty ? lane->dirty_ctrl | mask : lane->dirty_ctrl & ~mask;
+        return true;
+    }
+}
+
+/**
+ * @brief Find a run of dirty entries.
+ *
+ * Runs bridge a single clean entry whose value is known, as one byte costs
+ * less than a second command.
+ *
+ * @param dirty Entries to send
+ * @param known Entries whose value is known
+ * @param run Index of the run
+ * @param[out] first First entry of the run
+ * @param[out] last Last entry of the run
+ * @return false if there are fewer runs
+ */
+static bool par_run(uint8_t dirty, uint8_t known, int run, int *first, int *last)
+{
+    int d = 0;
+
+    for (;;)
+    {
+        while (d < FTB8MD_NUM_DIGITS && !(dirty & (1u << d)))
+        {
+            d++;
+        }
+        if (d == FTB8MD_NUM_DIGITS)
+        {
+            return false;
+        }
+
+        int end = d;
+        while (end + 1 < FTB8MD_NUM_DIGITS &&
+               ((dirty & (1u << (end + 1))) ||
+                (end + 2 < FTB8MD_NUM_DIGITS && (known & (1u << (end + 1))) && (dirty & (1u << (end + 2))))))
+        {
+            end++;
+        }
+
+        if (run-- == 0)
+        {
+            *first = d;
+            *last = end;
+            return true;
+        }
+        d = end + 1;
+    }
+}
+
+/**
+ * @brief Build the command a lane sends in one round of a frame.
+ *
+ * @param lane Lane
+ * @param slot SLOT_* kind of command
+ * @param run Index of the command within the slot
+ * @param[out] cmd Encoded command (FTB8MD_CMD_MAX_LEN bytes)
+ * @return Length of the command, or 0 if the lane has nothing to send
+ */
+static uint8_t par_build(const par_lane_t *lane, int slot, int run, uint8_t *cmd)
+{
+    int first, last;
+
+    switch (slot)
+    {
+    case SLOT_CGRAM:
+        // Only adjacent characters are merged; a gap would cost a whole character
+        if (!par_run(lane->dirty_cgram, 0, run, &first, &last))
+        {
+            return 0;
+        }
+        cmd[0] = FTB8MD_CMD_CGRAM(first);
+        memcpy(&cmd[1], lane->cgram[first], (size_t)(last - first + 1) * FTB8MD_GLYPH_COLS);
+        return (uint8_t)(1 + (last - first + 1) * FTB8MD_GLYPH_COLS);
+
+    case SLOT_DCRAM:
+    case SLOT_ADRAM:
+    {
+        bool dcram = slot == SLOT_DCRAM;
+        if (!par_run(dcram ? lane->dirty_dcram : lane->dirty_adram, dcram ? lane->known_dcram : lane->known_adram,
+                     run, &first, &last))
+        {
+            return 0;
+        }
+        cmd[0] = dcram ? FTB8MD_CMD_DCRAM(first) : FTB8MD_CMD_ADRAM(first);
+        memcpy(&cmd[1], dcram ? &lane->dcram[first] : &lane->adram[first], last - first + 1);
+        return (uint8_t)(1 + last - first + 1);
+    }
+
+    case SLOT_DIMMING:
+        if (run != 0 || !(lane->dirty_ctrl & FTB8MD_CTRL_DIMMING))
+        {
+            return 0;
+        }
+        cmd[0] = FTB8MD_CMD_DIMMING;
+        cmd[1] = lane->dimming;
+        return 2;
+
+    case SLOT_POWER:
+        if (run != 0 || !(lane->dirty_ctrl & FTB8MD_CTRL_POWER))
+        {
+            return 0;
+        }
+        memcpy(cmd, ftb8md_cmd_power[lane->power_on], 2);
+        return 2;
+
+    default:
+        if (run != 0 || !(lane->dirty_ctrl & FTB8MD_CTRL_STANDBY))
+        {
+            return 0;
+        }
+        memcpy(cmd, ftb8md_cmd_standby[lane->standby], 2);
+        return 2;
+    }
+}
+
+/**
+ * @brief Shift out one command per lane in the same clock cycles.
+ *
+ * Each panel is selected for the length of its own command only. SPI mode 3,
+ * LSB first: data changes while the clock is low and is sampled on the
+ * rising edge. Must be called with the clock lock held.
+ *
+ * @param par Group
+ * @param cmds Command per lane
+ * @param lens Length per lane, 0 for lanes without a command
+ */
+static void par_clock(struct ftb8md_par *par, uint8_t cmds[][FTB8MD_CMD_MAX_LEN], const uint8_t *lens)
+{
+    uint8_t max = 0;
+
+    for (int l = 0; l < par->num_lanes; l++)
+    {
+        if (lens[l] != 0)
+        {
+            gpio_set_level((gpio_num_t)par->lanes[l].cs_pin, 0);
+            max = lens[l] > max ? lens[l] : max;
+        }
+        par->stats.bytes += lens[l];
+    }
+    par->stats.clock_bytes += max;
+    esp_rom_delay_us(PAR_HALF_PERIOD_US);
+
+    for (int i = 0; i < max; i++)
+    {
+        // Transpose the byte of every lane into one bundle word per bit
+        uint32_t words[8] = {0};
+        for (int l = 0; l < par->num_lanes; l++)
+        {
+            if (i < lens[l])
+            {
+                for (int b = 0; b < 8; b++)
+                {
+                    words[b] |= (uint32_t)((cmds[l][i] >> b) & 1) << (l + 1);
+                }
+            }
+        }
+
+        for (int b = 0; b < 8; b++)
+        {
+#if SOC_DEDICATED_GPIO_SUPPORTED
+            dedic_gpio_bundle_write(par->bundle, par->bundle_mask, words[b]);
+            esp_rom_delay_us(PAR_HALF_PERIOD_US);
+            dedic_gpio_bundle_write(par->bundle, par->bundle_mask, words[b] | PAR_CLK);
+            esp_rom_delay_us(PAR_HALF_PERIOD_US);
+#endif
+        }
+
+        // Deselect panels whose command is complete; the clock keeps running for the others
+        for (int l = 0; l < par->num_lanes; l++)
+        {
+            if (lens[l] == i + 1)
+            {
+                gpio_set_level((gpio_num_t)par->lanes[l].cs_pin, 1);
+            }
+        }
+    }
+    esp_rom_delay_us(PAR_HALF_PERIOD_US);
+}
+
+esp_err_t ftb8md_par_transmit(ftb8md_panel_t *panel, const uint8_t *cmd, size_t len)
+{
+    struct ftb8md_par *par = panel->par;
+    uint8_t cmds[FTB8MD_PAR_MAX_PANELS][FTB8MD_CMD_MAX_LEN];
+    uint8_t lens[FTB8MD_PAR_MAX_PANELS] = {0};
+
+    if (len > FTB8MD_CMD_MAX_LEN)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    memcpy(cmds[panel->par_lane], cmd, len);
+    lens[panel->par_lane] = (uint8_t)len;
+
+    // Called by the scheduler worker too, so only the clock lock is taken: a producer may hold the group
+    // lock while it waits for the worker to free a queue entry
+    xSemaphoreTake(par->clock_lock, portMAX_DELAY);
+    par_clock(par, cmds, lens);
+    par_apply(par_lane(panel), cmd, len, false);
+    xSemaphoreGive(par->clock_lock);
+
+    return ESP_OK;
+}
+
+bool ftb8md_par_lock(ftb8md_panel_t *panel, TickType_t timeout)
+{
+    return xSemaphoreTakeRecursive(panel->par->lock, timeout) == pdTRUE;
+}
+
+void ftb8md_par_unlock(ftb8md_panel_t *panel)
+{
+    xSemaphoreGiveRecursive(panel->par->lock);
+}
+
+bool ftb8md_par_defer(ftb8md_panel_t *panel, const uint8_t *cmd, size_t len)
+{
+    struct ftb8md_par *par = panel->par;
+
+    // The group lock is already held through the panel lock, which takes it first
+    xSemaphoreTakeRecursive(par->lock, portMAX_DELAY);
+    bool deferred = false;
+    if (par->frame_depth != 0)
+    {
+        xSemaphoreTake(par->clock_lock, portMAX_DELAY);
+        deferred = par_apply(par_lane(panel), cmd, len, true);
+        xSemaphoreGive(par->clock_lock);
+    }
+    xSemaphoreGiveRecursive(par->lock);
+
+    return deferred;
+}
+
+/**
+ * @brief Send what the open frame collected, slot by slot, all lanes in parallel.
+ *
+ * Called with the group lock and the clock lock held.
+ */
+static void par_flush(struct ftb8md_par *par)
+{
+    uint8_t cmds[FTB8MD_PAR_MAX_PANELS][FTB8MD_CMD_MAX_LEN];
+    uint8_t lens[FTB8MD_PAR_MAX_PANELS];
+
+    for (int slot = 0; slot < SLOT_COUNT; slot++)
+    {
+        for (int run = 0;; run++)
+        {
+            bool any = false;
+            for (int l = 0; l < par->num_lanes; l++)
+            {
+                lens[l] = par_build(&par->lanes[l], slot, run, cmds[l]);
+                any |= lens[l] != 0;
+            }
+            if (!any)
+            {
+                break;
+            }
+
+            par_clock(par, cmds, lens);
+            for (int l = 0; l < par->num_lanes; l++)
+            {
+                if (lens[l] != 0)
+                {
+                    ftb8md_panel_wire_update(par->lanes[l].panel, cmds[l], lens[l]);
+                    ftb8md_trace_emit(par->lanes[l].panel, FTB8MD_TRACE_TX, cmds[l], lens[l]);
+                }
+            }
+        }
+    }
+
+    for (int l = 0; l < par->num_lanes; l++)
+    {
+        par_lane_t *lane = &par->lanes[l];
+        lane->dirty_dcram = 0;
+        lane->dirty_adram = 0;
+        lane->dirty_cgram = 0;
+        lane->dirty_ctrl = 0;
+    }
+    par->stats.frames++;
+}
+
+esp_err_t ftb8md_par_frame_begin(ftb8md_par_handle_t par)
+{
+    if (par == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Held until the frame ends, so writes by other tasks wait for it. Panel locks of the group take
+    // this lock first (ftb8md_panel_lock()), so the frame never waits for a task that holds one.
+    xSemaphoreTakeRecursive(par->lock, portMAX_DELAY);
+#if FTB8MD_SCHED_ENABLED
+    if (par->frame_depth == 0)
+    {
+        // Writes queued before the frame must reach the panels before it is flushed; none can be queued
+        // for the group while the lock is held, and the worker does not need it to drain the queue
+        ftb8md_sched_flush(portMAX_DELAY);
+    }
+#endif
+    par->frame_owner = xTaskGetCurrentTaskHandle();
+    par->frame_depth++;
+
+    return ESP_OK;
+}
+
+esp_err_t ftb8md_par_frame_end(ftb8md_par_handle_t par)
+{
+    if (par == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (par->frame_depth == 0 || par->frame_owner != xTaskGetCurrentTaskHandle())
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (--par->frame_depth == 0)
+    {
+        xSemaphoreTake(par->clock_lock, portMAX_DELAY);
+        par_flush(par);
+        xSemaphoreGive(par->clock_lock);
+        par->frame_owner = NULL;
+    }
+    xSemaphoreGiveRecursive(par->lock);
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Release the panel slots, pins and group slot of a group.
+ */
+static void par_release(struct ftb8md_par *par)
+{
+    for (int l = 0; l < par->num_lanes; l++)
+    {
+        if (par->lanes[l].panel != NULL)
+        {
+            ftb8md_panel_free(par->lanes[l].panel);
+            par->lanes[l].panel = NULL;
+        }
+    }
+#if SOC_DEDICATED_GPIO_SUPPORTED
+    if (par->bundle != NULL)
+    {
+        dedic_gpio_del_bundle(par->bundle);
+        par->bundle = NULL;
+    }
+#endif
+    if (par->lock != NULL)
+    {
+        vSemaphoreDelete(par->lock);
+        par->lock = NULL;
+    }
+    if (par->clock_lock != NULL)
+    {
+        vSemaphoreDelete(par->clock_lock);
+        par->clock_lock = NULL;
+    }
+
+    portENTER_CRITICAL(&s_groups_lock);
+    par->used = false;
+    portEXIT_CRITICAL(&s_groups_lock);
+}
+
+esp_err_t ftb8md_par_create(const ftb8md_par_config_t *config, ftb8md_par_handle_t *ret_par,
+                            spi_device_handle_t panels[])
+{
+    if (config == NULL || ret_par == NULL || panels == NULL || config->num_panels == 0 ||
+        config->num_panels > FTB8MD_PAR_MAX_PANELS)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+#if !SOC_DEDICATED_GPIO_SUPPORTED
+    ESP_LOGE(TAG, "Dedicated GPIO is not available on this target");
+    return ESP_ERR_NOT_SUPPORTED;
+#else
+    struct ftb8md_par *par = NULL;
+
+    portENTER_CRITICAL(&s_groups_lock);
+    for (int i = 0; i < FTB8MD_PAR_MAX_GROUPS; i++)
+    {
+        if (!s_groups[i].used)
+        {
+            par = &s_groups[i];
+            par->used = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_groups_lock);
+
+    if (par == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    par->bundle = NULL;
+    par->lock = xSemaphoreCreateRecursiveMutexStatic(&par->lock_buf);
+    par->clock_lock = xSemaphoreCreateMutexStatic(&par->clock_lock_buf);
+    par->frame_owner = NULL;
+    par->frame_depth = 0;
+    par->num_lanes = config->num_panels;
+    memset(par->lanes, 0, sizeof(par->lanes));
+    memset(&par->stats, 0, sizeof(par->stats));
+
+    // Clock idles high (SPI mode 3); panels start deselected
+    uint64_t out_pins = 1ULL << config->clk_pin;
+    int bundle_pins[1 + FTB8MD_PAR_MAX_PANELS] = {config->clk_pin};
+    for (int l = 0; l < par->num_lanes; l++)
+    {
+        out_pins |= (1ULL << config->din_pins[l]) | (1ULL << config->cs_pins[l]);
+        bundle_pins[1 + l] = config->din_pins[l];
+    }
+    if (config->reset_pin >= 0)
+    {
+        out_pins |= 1ULL << config->reset_pin;
+    }
+
+    gpio_config_t io_conf = {
+        .pin_bit_mask = out_pins,
+        .mode = GPIO_MODE_OUTPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+    };
+    esp_err_t ret = gpio_config(&io_conf);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to configure pins: %s", esp_err_to_name(ret));
+        par_release(par);
+        return ret;
+    }
+    for (int l = 0; l < par->num_lanes; l++)
+    {
+        par->lanes[l].cs_pin = config->cs_pins[l];
+        gpio_set_level((gpio_num_t)config->cs_pins[l], 1);
+    }
+
+    dedic_gpio_bundle_config_t bundle_cfg = {
+        .gpio_array = bundle_pins,
+        .array_size = 1 + par->num_lanes,
+        .flags = {
+            .out_en = 1,
+        },
+    };
+    ret = dedic_gpio_new_bundle(&bundle_cfg, &par->bundle);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to create GPIO bundle: %s", esp_err_to_name(ret));
+        par->bundle = NULL;
+        par_release(par);
+        return ret;
+    }
+    par->bundle_mask = (1u << (1 + par->num_lanes)) - 1;
+    dedic_gpio_bundle_write(par->bundle, par->bundle_mask, PAR_CLK);
+
+    if (config->reset_pin >= 0)
+    {
+        gpio_set_level((gpio_num_t)config->reset_pin, 0);
+        vTaskDelay(pdMS_TO_TICKS(10));
+        gpio_set_level((gpio_num_t)config->reset_pin, 1);
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
+    for (int l = 0; l < par->num_lanes; l++)
+    {
+        par_lane_t *lane = &par->lanes[l];
+        spi_device_handle_t handle = (spi_device_handle_t)(void *)lane;
+
+        lane->panel = ftb8md_panel_alloc(handle, SPI_HOST_MAX, config->reset_pin >= 0);
+        if (lane->panel == NULL)
+        {
+            ESP_LOGE(TAG, "Too many panels registered (max %d)", FTB8MD_MAX_PANELS);
+            par_release(par);
+            return ESP_ERR_NO_MEM;
+        }
+        lane->panel->par = par;
+        lane->panel->par_lane = (uint8_t)l;
+        if (config->reset_pin >= 0)
+        {
+            // Values after RESET, as in the shadow
+            memset(lane->dcram, 0x20, sizeof(lane->dcram));
+            lane->known_dcram = FTB8MD_DIGIT_MASK;
+            lane->known_adram = FTB8MD_DIGIT_MASK;
+        }
+        panels[l] = handle;
+    }
+
+    // Initialize all panels at once: 8 digits, full brightness, display on
+    uint8_t cmds[FTB8MD_PAR_MAX_PANELS][FTB8MD_CMD_MAX_LEN];
+    uint8_t lens[FTB8MD_PAR_MAX_PANELS];
+    for (int l = 0; l < par->num_lanes; l++)
+    {
+        cmds[l][0] = FTB8MD_CMD_DIGIT_SET;
+        cmds[l][1] = FTB8MD_NUM_DIGITS - 1;
+        lens[l] = 2;
+    }
+    xSemaphoreTake(par->clock_lock, portMAX_DELAY);
+    par_clock(par, cmds, lens);
+    xSemaphoreGive(par->clock_lock);
+
+    ftb8md_par_frame_begin(par);
+    for (int l = 0; l < par->num_lanes; l++)
+    {
+        ftb8md_set_dimming(panels[l], 240);
+        ftb8md_set_display_power(panels[l], true);
+    }
+    ftb8md_par_frame_end(par);
+
+    *ret_par = par;
+    ESP_LOGI(TAG, "%u panels initialized", par->num_lanes);
+
+    return ESP_OK;
+#endif
+}
+
+esp_err_t ftb8md_par_delete(ftb8md_par_handle_t par)
+{
+    if (par == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (par->frame_depth != 0)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+#if FTB8MD_SCHED_ENABLED
+    // Queued commands still refer to the panels
+    ftb8md_sched_flush(portMAX_DELAY);
+#endif
+
+    par_release(par);
+
+    return ESP_OK;
+}
+
+esp_err_t ftb8md_par_get_stats(ftb8md_par_handle_t par, ftb8md_par_stats_t *stats)
+{
+    if (par == NULL || stats == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(par->clock_lock, portMAX_DELAY);
+    *stats = par->stats;
+    xSemaphoreGive(par->clock_lock);
+
+    return ESP_OK;
+}
@@ -0,0 +1,490 @@
+/**
+ * @file ftb-8-md-pipe.c
+ * @brief Core-affine render pipeline fed by per-core lock-free queues.
+ */
+
+#include "ftb-8-md-pipe.h"
+#include "ftb-8-md-priv.h"
+
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include <assert.h>
+#include <string.h>
+
+static const char *TAG = "FTB8MD_PIPE";
+
+static_assert((FTB8MD_PIPE_QUEUE_LEN & (FTB8MD_PIPE_QUEUE_LEN - 1)) == 0,
+              "FTB8MD_PIPE_QUEUE_LEN must be a power of two");
+
+/** @brief Cache line size; producer and consumer indices live on separate lines */
+#define PIPE_LINE_SIZE 64
+
+/**
+ * @brief Posted update of consecutive DCRAM or ADRAM digits.
+ */
+typedef struct
+{
+    spi_device_handle_t handle;      /**< Destination panel */
+    int64_t stamp;                   /**< Time of the post (esp_timer_get_time()) */
+    uint8_t slot;                    /**< Index of the panel's slot */
+    uint8_t prefix;                  /**< CMD_PREFIX_DCRAM or CMD_PREFIX_ADRAM */
+    uint8_t digit;                   /**< First digit */
+    uint8_t count;                   /**< Digits in data */
+    uint8_t data[FTB8MD_NUM_DIGITS]; /**< New contents of the digits */
+} pipe_update_t;
+
+/**
+ * @brief Updates of one panel that found the ring of a core full.
+ *
+ * Posts merge into it instead of being dropped, so the newest value of every
+ * digit survives. The producer bumps seq to odd before and to even after
+ * merging; the render task copies it out and retries if seq moved meanwhile.
+ * Masks only grow, and the stamps keep a value from replacing a newer one
+ * when it is collected again.
+ */
+typedef struct
+{
+    uint32_t seq;                           /**< Odd while the producer merges */
+    spi_device_handle_t handle;             /**< Destination panel */
+    uint8_t dcram[FTB8MD_NUM_DIGITS];       /**< Newest character codes */
+    uint8_t adram[FTB8MD_NUM_DIGITS];       /**< Newest segment patterns */
+    uint8_t dcram_mask;                     /**< Digits of dcram ever merged */
+    uint8_t adram_mask;                     /**< Digits of adram ever merged */
+    int64_t dcram_stamp[FTB8MD_NUM_DIGITS]; /**< Post time per digit of dcram */
+    int64_t adram_stamp[FTB8MD_NUM_DIGITS]; /**< Post time per digit of adram */
+} pipe_overflow_t;
+
+/**
+ * @brief Single-producer single-consumer ring of one core.
+ *
+ * The producer is whatever task or ISR runs on the core, serialised by
+ * masking interrupts there; the consumer is the render task. Indices run
+ * freely and are reduced modulo the queue length.
+ */
+typedef struct
+{
+    uint32_t head __attribute__((aligned(PIPE_LINE_SIZE))); /**< Next slot to fill (written by the producer) */
+    uint32_t posted;                                        /**< Updates posted (written by the producer) */
+    uint32_t full;                                          /**< Posts merged into overflow (written by the producer) */
+    uint32_t tail __attribute__((aligned(PIPE_LINE_SIZE))); /**< Next slot to drain (written by the consumer) */
+    pipe_update_t slots[FTB8MD_PIPE_QUEUE_LEN] __attribute__((aligned(PIPE_LINE_SIZE))); /**< Updates */
+    pipe_overflow_t overflow[FTB8MD_MAX_PANELS];            /**< Posts that found the ring full, per panel slot */
+} pipe_ring_t;
+
+/**
+ * @brief Updates of one panel collected during a frame.
+ */
+typedef struct
+{
+    spi_device_handle_t handle;                /**< Panel the updates are for */
+    uint8_t dcram[FTB8MD_NUM_DIGITS];          /**< New character codes */
+    uint8_t adram[FTB8MD_NUM_DIGITS];          /**< New segment patterns */
+    uint8_t dcram_mask;                        /**< Digits of dcram to write */
+    uint8_t adram_mask;                        /**< Digits of adram to write */
+    int64_t dcram_stamp[FTB8MD_NUM_DIGITS];    /**< Post time of the newest code collected per digit */
+    int64_t adram_stamp[FTB8MD_NUM_DIGITS];    /**< Post time of the newest pattern collected per digit */
+    uint32_t overflow_seq[portNUM_PROCESSORS]; /**< Version of each core's overflow collected last */
+} pipe_frame_t;
+
+static pipe_ring_t s_rings[portNUM_PROCESSORS];
+static pipe_frame_t s_frame[FTB8MD_MAX_PANELS]; /**< Owned by the render task */
+
+static TaskHandle_t s_task;
+static SemaphoreHandle_t s_stopped;
+static StaticSemaphore_t s_stopped_buf;
+static volatile bool s_running;
+static volatile bool s_stopping;
+static TickType_t s_frame_ticks;
+static uint32_t s_frames;     /**< Written by the render task */
+static uint32_t s_high_water; /**< Written by the render task */
+
+/**
+ * @brief Copy an update into the ring of the calling core.
+ */
+static esp_err_t pipe_post(ftb8md_panel_t *panel, uint8_t prefix, int digit, const uint8_t *data, size_t count)
+{
+    if (!s_running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // With interrupts masked on this core the caller can neither migrate nor be interleaved with another
+    // producer of the same ring; nothing is shared with the other core but the ring indices
+    UBaseType_t state = portSET_INTERRUPT_MASK_FROM_ISR();
+    pipe_ring_t *ring = &s_rings[xPortGetCoreID()];
+    int slot = ftb8md_panel_index(panel);
+    int64_t stamp = esp_timer_get_time();
+    uint32_t head = ring->head;
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= FTB8MD_PIPE_QUEUE_LEN)
+    {
+        // Keep the newest value rather than dropping it; the render task picks it up with the next frame
+        pipe_overflow_t *overflow = &ring->overflow[slot];
+        uint32_t seq = overflow->seq;
+        __atomic_store_n(&overflow->seq, seq + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+
+        if (overflow->handle != panel->spi)
+        {
+            overflow->handle = panel->spi;
+            overflow->dcram_mask = 0;
+            overflow->adram_mask = 0;
+        }
+
+        bool dcram = prefix == CMD_PREFIX_DCRAM;
+        uint8_t *values = dcram ? overflow->dcram : overflow->adram;
+        int64_t *stamps = dcram ? overflow->dcram_stamp : overflow->adram_stamp;
+        memcpy(&values[digit], data, count);
+        for (size_t i = 0; i < count; i++)
+        {
+            stamps[digit + i] = stamp;
+        }
+        uint8_t mask = (uint8_t)(((1u << count) - 1) << digit);
+        if (dcram)
+        {
+            overflow->dcram_mask |= mask;
+        }
+        else
+        {
+            overflow->adram_mask |= mask;
+        }
+
+        __atomic_store_n(&overflow->seq, seq + 2, __ATOMIC_RELEASE);
+        ring->full++;
+    }
+    else
+    {
+        pipe_update_t *update = &ring->slots[head % FTB8MD_PIPE_QUEUE_LEN];
+        update->handle = panel->spi;
+        update->stamp = stamp;
+        update->slot = (uint8_t)slot;
+        update->prefix = prefix;
+        update->digit = (uint8_t)digit;
+        update->count = (uint8_t)count;
+        memcpy(update->data, data, count);
+        __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    }
+    ring->posted++;
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(state);
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Merge the value of one digit into the frame of its panel.
+ *
+ * The rings are drained one after the other, and a task that migrated may
+ * have its older post still queued on the other core, or drained a frame
+ * later. Each digit therefore keeps the time of the value it holds, and only
+ * a value posted at the same time or later replaces it.
+ */
+static void pipe_collect(pipe_frame_t *frame, uint8_t prefix, int digit, uint8_t value, int64_t stamp)
+{
+    bool dcram = prefix == CMD_PREFIX_DCRAM;
+    int64_t *last = dcram ? &frame->dcram_stamp[digit] : &frame->adram_stamp[digit];
+    if (stamp < *last)
+    {
+        return;
+    }
+
+    *last = stamp;
+    if (dcram)
+    {
+        frame->dcram[digit] = value;
+        frame->dcram_mask |= (uint8_t)(1u << digit);
+    }
+    else
+    {
+        frame->adram[digit] = value;
+        frame->adram_mask |= (uint8_t)(1u << digit);
+    }
+}
+
+/**
+ * @brief Get the frame of a panel slot, void if the slot was registered again.
+ */
+static pipe_frame_t *pipe_frame(int slot, spi_device_handle_t handle)
+{
+    pipe_frame_t *frame = &s_frame[slot];
+    if (frame->handle != handle)
+    {
+        memset(frame, 0, sizeof(*frame));
+        frame->handle = handle;
+    }
+
+    return frame;
+}
+
+/**
+ * @brief Collect what a core merged into its overflow since the last frame.
+ */
+static void pipe_collect_overflow(int core, int slot)
+{
+    const pipe_overflow_t *overflow = &s_rings[core].overflow[slot];
+    pipe_overflow_t copy;
+    uint32_t seq;
+
+    // The producer runs with interrupts masked and merges a few bytes, so a torn copy is rare and short-lived
+    for (;;)
+    {
+        seq = __atomic_load_n(&overflow->seq, __ATOMIC_ACQUIRE);
+        if (seq == 0 || seq == s_frame[slot].overflow_seq[core])
+        {
+            return;
+        }
+        if (seq & 1)
+        {
+            continue;
+        }
+
+        memcpy(&copy, overflow, sizeof(copy));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&overflow->seq, __ATOMIC_RELAXED) == seq)
+        {
+            break;
+        }
+    }
+
+    s_frame[slot].overflow_seq[core] = seq;
+    if (ftb8md_panel_get(copy.handle) == NULL)
+    {
+        // Left over from a panel since unregistered
+        return;
+    }
+
+    pipe_frame_t *frame = pipe_frame(slot, copy.handle);
+    frame->overflow_seq[core] = seq;
+    for (int digit = 0; digit < FTB8MD_NUM_DIGITS; digit++)
+    {
+        if (copy.dcram_mask & (1u << digit))
+        {
+            pipe_collect(frame, CMD_PREFIX_DCRAM, digit, copy.dcram[digit], copy.dcram_stamp[digit]);
+        }
+        if (copy.adram_mask & (1u << digit))
+        {
+            pipe_collect(frame, CMD_PREFIX_ADRAM, digit, copy.adram[digit], copy.adram_stamp[digit]);
+        }
+    }
+}
+
+/**
+ * @brief Collect the updates queued on every core and write them, one diffed burst per panel.
+ */
+static void pipe_drain(void)
+{
+    for (int core = 0; core < portNUM_PROCESSORS; core++)
+    {
+        pipe_ring_t *ring = &s_rings[core];
+        uint32_t tail = ring->tail;
+        uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        if (head - tail > s_high_water)
+        {
+            s_high_water = head - tail;
+        }
+
+        for (; tail != head; tail++)
+        {
+            const pipe_update_t *update = &ring->slots[tail % FTB8MD_PIPE_QUEUE_LEN];
+            pipe_frame_t *frame = pipe_frame(update->slot, update->handle);
+            for (int i = 0; i < update->count; i++)
+            {
+                pipe_collect(frame, update->prefix, update->digit + i, update->data[i], update->stamp);
+            }
+        }
+
+        // The slots go back to the producer only once they have been copied
+        __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+
+        for (int slot = 0; slot < FTB8MD_MAX_PANELS; slot++)
+        {
+            pipe_collect_overflow(core, slot);
+        }
+    }
+
+    bool wrote = false;
+    for (int i = 0; i < FTB8MD_MAX_PANELS; i++)
+    {
+        pipe_frame_t *frame = &s_frame[i];
+        if ((frame->dcram_mask | frame->adram_mask) == 0)
+        {
+            continue;
+        }
+
+        // The panel may have been unregistered since the updates were posted
+        ftb8md_panel_t *panel = ftb8md_panel_get(frame->handle);
+        if (panel == NULL)
+        {
+            frame->dcram_mask = 0;
+            frame->adram_mask = 0;
+            continue;
+        }
+
+        // Digits whose write fails stay collected and are tried again with the next frame
+        ftb8md_panel_lock(panel);
+        if (frame->dcram_mask != 0 &&
+            ftb8md_panel_write_diff(panel, CMD_PREFIX_DCRAM, frame->dcram, frame->dcram_mask) == ESP_OK)
+        {
+            frame->dcram_mask = 0;
+        }
+        if (frame->adram_mask != 0 &&
+            ftb8md_panel_write_diff(panel, CMD_PREFIX_ADRAM, frame->adram, frame->adram_mask) == ESP_OK)
+        {
+            frame->adram_mask = 0;
+        }
+        ftb8md_panel_unlock(panel);
+        wrote = true;
+    }
+
+    if (wrote)
+    {
+        s_frames++;
+    }
+}
+
+static void pipe_task(void *arg)
+{
+    TickType_t last = xTaskGetTickCount();
+    for (;;)
+    {
+        // Everything posted before the stop request is rendered by this last drain
+        bool stop = s_stopping;
+        pipe_drain();
+        if (stop)
+        {
+            break;
+        }
+        vTaskDelayUntil(&last, s_frame_ticks);
+    }
+
+    xSemaphoreGive(s_stopped);
+    vTaskDelete(NULL);
+}
+
+esp_err_t ftb8md_pipe_start(const ftb8md_pipe_config_t *config)
+{
+    ftb8md_pipe_config_t defaults = FTB8MD_PIPE_CONFIG_DEFAULT();
+    if (config == NULL)
+    {
+        config = &defaults;
+    }
+
+    if (s_running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (s_stopped == NULL)
+    {
+        s_stopped = xSemaphoreCreateBinaryStatic(&s_stopped_buf);
+    }
+
+    for (int core = 0; core < portNUM_PROCESSORS; core++)
+    {
+        s_rings[core].posted = 0;
+        s_rings[core].full = 0;
+    }
+    s_frames = 0;
+    s_high_water = 0;
+    s_frame_ticks = pdMS_TO_TICKS(config->frame_ms) > 0 ? pdMS_TO_TICKS(config->frame_ms) : 1;
+    s_stopping = false;
+
+    if (xTaskCreatePinnedToCore(pipe_task, "ftb8md_pipe", config->task_stack_size, NULL, config->task_priority,
+                                &s_task, config->task_core) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create render task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    s_running = true;
+
+    return ESP_OK;
+}
+
+esp_err_t ftb8md_pipe_stop(void)
+{
+    if (!s_running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_running = false;
+    s_stopping = true;
+    xSemaphoreTake(s_stopped, portMAX_DELAY);
+    s_task = NULL;
+
+    return ESP_OK;
+}
+
+esp_err_t ftb8md_pipe_write_dcram(spi_device_handle_t handle, int digit, const uint8_t *codes, size_t count)
+{
+    ftb8md_panel_t *panel = ftb8md_panel_get(handle);
+    if (panel == NULL || codes == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (digit < 0 || digit >= FTB8MD_NUM_DIGITS || count == 0 || count > (size_t)(FTB8MD_NUM_DIGITS - digit))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return pipe_post(panel, CMD_PREFIX_DCRAM, digit, codes, count);
+}
+
+esp_err_t ftb8md_pipe_write_adram(spi_device_handle_t handle, int digit, const uint8_t *segments, size_t count)
+{
+    ftb8md_panel_t *panel = ftb8md_panel_get(handle);
+    if (panel == NULL || segments == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (digit < 0 || digit >= FTB8MD_NUM_DIGITS || count == 0 || count > (size_t)(FTB8MD_NUM_DIGITS - digit))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return pipe_post(panel, CMD_PREFIX_ADRAM, digit, segments, count);
+}
+
+esp_err_t ftb8md_pipe_show_string(spi_device_handle_t handle, int digit, const char *str)
+{
+    ftb8md_panel_t *panel = ftb8md_panel_get(handle);
+    if (panel == NULL || str == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (digit < 0 || digit >= FTB8MD_NUM_DIGITS)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t count = strnlen(str, (size_t)(FTB8MD_NUM_DIGITS - digit));
+    if (count == 0)
+    {
+        return s_running ? ESP_OK : ESP_ERR_INVALID_STATE;
+    }
+
+    return pipe_post(panel, CMD_PREFIX_DCRAM, digit, (const uint8_t *)str, count);
+}
+
+esp_err_t ftb8md_pipe_get_stats(ftb8md_pipe_stats_t *stats)
+{
+    if (stats == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (int core = 0; core < portNUM_PROCESSORS; core++)
+    {
+        stats->posted[core] = s_rings[core].posted;
+        stats->full[core] = s_rings[core].full;
+    }
+    stats->frames = s_frames;
+    stats->queue_high_water = s_high_water;
+
+    return ESP_OK;
+}
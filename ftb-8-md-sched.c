@@ -0,0 +1,859 @@
+/**
+ * @file ftb-8-md-sched.c
+ * @brief Asynchronous command scheduler with priority classes.
+ */
+
+#include "ftb-8-md-sched.h"
+#include "ftb-8-md-priv.h"
+
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include <string.h>
+
+static const char *TAG = "FTB8MD_SCHED";
+
+/** @brief Longest queued command (CGRAM is split per character) */
+#define ENTRY_MAX_LEN FTB8MD_CMD_PIECE_MAX_LEN
+
+/** @brief Command kind of control commands (0xE0-0xEF) in entry_target() */
+#define KIND_CTRL 0x07
+
+/** @brief Command kind of RAM writes without data in entry_target(); they overlap nothing */
+#define KIND_EMPTY 0x08
+
+/** @brief Number of command kinds entry_target() reports */
+#define KIND_COUNT 9
+
+/** @brief Deadline of commands without one; sorts after every real deadline */
+#define NO_DEADLINE INT64_MAX
+
+#define EVT_IDLE (1 << 0)    /**< Queue drained */
+#define EVT_STOPPED (1 << 1) /**< Worker task exited */
+#define EVT_WORK (1 << 2)    /**< Entries queued, or the worker is to stop */
+
+/**
+ * @brief Queued command.
+ */
+typedef struct sched_entry
+{
+    struct sched_entry *next;    /**< Next entry in the same list */
+    ftb8md_panel_t *panel;       /**< Destination panel */
+    int64_t queued_us;           /**< Time the command was queued */
+    int64_t deadline_us;         /**< Latest time to finish sending the command, or NO_DEADLINE */
+    uint32_t seq;                /**< Submission order */
+    uint8_t prio;                /**< Priority class */
+    uint8_t len;                 /**< Length of data */
+    bool refresh;                /**< Send even if the panel already holds the value */
+    bool drop_late;              /**< Drop instead of sending once the deadline has passed */
+    uint8_t kind;                /**< Command kind (see entry_target()) */
+    uint8_t lo;                  /**< First register written */
+    uint8_t hi;                  /**< Last register written */
+    uint8_t glyphs;              /**< CGRAM characters a DCRAM write shows */
+    uint8_t data[ENTRY_MAX_LEN]; /**< Encoded command */
+} sched_entry_t;
+
+/**
+ * @brief FIFO of queued commands.
+ */
+typedef struct
+{
+    sched_entry_t *head; /**< Oldest entry */
+    sched_entry_t *tail; /**< Newest entry */
+} sched_list_t;
+
+/**
+ * @brief Write options of a task inside an ftb8md_opts_begin() scope.
+ */
+typedef struct
+{
+    TaskHandle_t task;        /**< Task, NULL while the slot is free */
+    ftb8md_write_opts_t opts; /**< Options of the task */
+} sched_scope_t;
+
+/**
+ * @brief Pending fence.
+ */
+typedef struct
+{
+    ftb8md_done_cb_t cb; /**< Callback, NULL while the slot is free */
+    void *arg;           /**< Argument of cb */
+    uint32_t seq;        /**< Covers the entries submitted before this sequence number */
+    esp_err_t result;    /**< First failure among the covered entries */
+} sched_fence_t;
+
+/** @brief Guards all scheduler state below */
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static sched_entry_t s_pool[FTB8MD_SCHED_QUEUE_LEN];
+static sched_entry_t *s_free;
+static sched_list_t s_queue[FTB8MD_PRIO_COUNT];
+static uint32_t s_pending; /**< Queued plus in flight */
+static uint32_t s_seq;
+static sched_scope_t s_scopes[FTB8MD_SCHED_MAX_SCOPES];
+static sched_fence_t s_fences[FTB8MD_SCHED_MAX_FENCES];
+static const sched_entry_t *s_in_flight; /**< Entry the worker is sending */
+static sched_entry_t *s_walk[FTB8MD_SCHED_QUEUE_LEN]; /**< Scratch list of dequeue_locked() */
+
+static SemaphoreHandle_t s_free_sem;
+static StaticSemaphore_t s_free_sem_buf;
+static EventGroupHandle_t s_events;
+static StaticEventGroup_t s_events_buf;
+static TaskHandle_t s_worker;
+static volatile bool s_running;
+static bool s_stopping;
+
+static ftb8md_sched_stats_t s_stats;
+static uint64_t s_latency_sum[FTB8MD_PRIO_COUNT];
+
+/**
+ * @brief Work out which panel registers a command writes.
+ *
+ * @param data Encoded command
+ * @param len Length of the command
+ * @param[out] kind Command prefix, KIND_CTRL for control commands, or KIND_EMPTY for RAM writes without data
+ * @param[out] lo First address written (control commands: the opcode group)
+ * @param[out] hi Last address written
+ * @param[out] glyphs CGRAM characters a DCRAM write shows
+ */
+static void entry_target(const uint8_t *data, size_t len, uint8_t *kind, uint8_t *lo, uint8_t *hi, uint8_t *glyphs)
+{
+    *kind = data[0] >> 5;
+    *lo = data[0] & 0x1F;
+    *glyphs = 0;
+
+    if (len == 1 && *kind != KIND_CTRL)
+    {
+        // Only the address is sent; the empty range cannot replace or block anything
+        *kind = KIND_EMPTY;
+        *lo = 1;
+        *hi = 0;
+        return;
+    }
+
+    switch (*kind)
+    {
+    case CMD_PREFIX_DCRAM:
+        *hi = *lo + (len - 1) - 1;
+        for (size_t i = 1; i < len; i++)
+        {
+            if (data[i] < FTB8MD_NUM_CGRAM)
+            {
+                *glyphs |= 1u << data[i];
+            }
+        }
+        break;
+
+    case CMD_PREFIX_ADRAM:
+        *hi = *lo + (len - 1) - 1;
+        break;
+
+    case CMD_PREFIX_CGRAM:
+        *lo &= 0x07;
+        *hi = *lo + (len - 1) / FTB8MD_GLYPH_COLS - 1;
+        break;
+
+    case KIND_CTRL:
+        // Each control register has its own opcode group
+        *lo = *hi = data[0] & 0x1C;
+        break;
+
+    default:
+        *lo = 0;
+        *hi = 0xFF;
+        break;
+    }
+}
+
+/**
+ * @brief Registers from lo to hi as a mask, clipped to the 32 addresses of a kind.
+ */
+static uint32_t target_mask(uint8_t lo, uint8_t hi)
+{
+    if (lo > hi || lo > 31)
+    {
+        return 0;
+    }
+
+    uint32_t upto = hi >= 31 ? UINT32_MAX : (2u << hi) - 1;
+    return upto & ~((1u << lo) - 1);
+}
+
+static void list_remove(sched_list_t *list, sched_entry_t *prev, sched_entry_t *entry)
+{
+    if (prev == NULL)
+    {
+        list->head = entry->next;
+    }
+    else
+    {
+        prev->next = entry->next;
+    }
+    if (list->tail == entry)
+    {
+        list->tail = prev;
+    }
+    entry->next = NULL;
+}
+
+/**
+ * @brief Insert an entry keeping the list in submission order.
+ */
+static void list_insert(sched_list_t *list, sched_entry_t *entry)
+{
+    sched_entry_t *prev = NULL;
+    sched_entry_t *cur = list->head;
+
+    // New submissions go to the tail; only promoted entries walk the list
+    if (list->tail != NULL && (int32_t)(entry->seq - list->tail->seq) > 0)
+    {
+        prev = list->tail;
+        cur = NULL;
+    }
+    while (cur != NULL && (int32_t)(entry->seq - cur->seq) > 0)
+    {
+        prev = cur;
+        cur = cur->next;
+    }
+
+    entry->next = cur;
+    if (prev == NULL)
+    {
+        list->head = entry;
+    }
+    else
+    {
+        prev->next = entry;
+    }
+    if (cur == NULL)
+    {
+        list->tail = entry;
+    }
+}
+
+/**
+ * @brief Queue an entry, dropping older writes it replaces.
+ *
+ * Older writes to the same registers that the new one fully overwrites are
+ * dropped. Older writes it only partly overlaps are promoted to its class,
+ * so they cannot reach the panel after it. A DCRAM write showing CGRAM
+ * characters likewise promotes pending uploads of those characters, so a
+ * digit never shows a glyph before it has been loaded.
+ *
+ * @return Number of entries returned to the pool
+ */
+static int enqueue_locked(sched_entry_t *entry)
+{
+    uint8_t kind = entry->kind;
+    uint8_t lo = entry->lo;
+    uint8_t hi = entry->hi;
+
+    int freed = 0;
+    for (int p = 0; p < FTB8MD_PRIO_COUNT; p++)
+    {
+        sched_entry_t *prev = NULL;
+        sched_entry_t *cur = s_queue[p].head;
+        while (cur != NULL)
+        {
+            sched_entry_t *next = cur->next;
+
+            bool same_panel = cur->panel == entry->panel;
+            bool overlap = same_panel && cur->kind == kind && cur->lo <= hi && cur->hi >= lo;
+            bool needed = same_panel && cur->kind == CMD_PREFIX_CGRAM && (entry->glyphs & (1u << cur->lo));
+            if (overlap && cur->lo >= lo && cur->hi <= hi)
+            {
+                list_remove(&s_queue[p], prev, cur);
+                cur->next = s_free;
+                s_free = cur;
+                s_pending--;
+                s_stats.superseded++;
+                freed++;
+            }
+            else if ((overlap || needed) && p < entry->prio)
+            {
+                list_remove(&s_queue[p], prev, cur);
+                cur->prio = entry->prio;
+                list_insert(&s_queue[entry->prio], cur);
+            }
+            else
+            {
+                prev = cur;
+            }
+            cur = next;
+        }
+    }
+
+    entry->seq = s_seq++;
+    list_insert(&s_queue[entry->prio], entry);
+    s_pending++;
+    if (s_pending > s_stats.queue_high_water)
+    {
+        s_stats.queue_high_water = s_pending;
+    }
+
+    return freed;
+}
+
+/**
+ * @brief Take the next entry of the highest non-empty class.
+ *
+ * Within the class the entry with the earliest deadline goes first, ties and
+ * entries without a deadline in submission order. Older entries that must
+ * reach the panel first, because they write overlapping registers or upload
+ * CGRAM characters it shows, are taken in its place, oldest first, so
+ * deadlines never reorder writes to the same registers.
+ */
+static sched_entry_t *dequeue_locked(void)
+{
+    for (int p = FTB8MD_PRIO_COUNT - 1; p >= 0; p--)
+    {
+        sched_list_t *list = &s_queue[p];
+        if (list->head == NULL)
+        {
+            continue;
+        }
+
+        // The list is in submission order, so the first minimum wins ties
+        sched_entry_t *best = list->head;
+        for (sched_entry_t *cur = best->next; cur != NULL; cur = cur->next)
+        {
+            if (cur->deadline_us < best->deadline_us)
+            {
+                best = cur;
+            }
+        }
+
+        int n = 0;
+        for (sched_entry_t *cur = list->head; cur != best; cur = cur->next)
+        {
+            s_walk[n++] = cur;
+        }
+
+        // One pass from best back to the head: an entry is needed if it must precede one that is, and
+        // the oldest needed entry has nothing left to wait for
+        uint32_t regs[KIND_COUNT] = {0};
+        regs[best->kind] = target_mask(best->lo, best->hi);
+        uint8_t glyphs = best->glyphs;
+        int take = n;
+        for (int i = n - 1; i >= 0; i--)
+        {
+            const sched_entry_t *cur = s_walk[i];
+            uint32_t mask = target_mask(cur->lo, cur->hi);
+            if (cur->panel == best->panel &&
+                ((regs[cur->kind] & mask) != 0 || (cur->kind == CMD_PREFIX_CGRAM && (glyphs & mask) != 0)))
+            {
+                regs[cur->kind] |= mask;
+                glyphs |= cur->glyphs;
+                take = i;
+            }
+        }
+
+        sched_entry_t *entry = take == n ? best : s_walk[take];
+        list_remove(list, take > 0 ? s_walk[take - 1] : NULL, entry);
+        return entry;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Take the fences whose entries are all done.
+ *
+ * @param[out] done Completed fences, removed from s_fences
+ * @return Number of completed fences
+ */
+static int fences_take_locked(sched_fence_t *done)
+{
+    // Lists are in submission order, so their heads hold the oldest outstanding entries
+    bool outstanding = s_in_flight != NULL;
+    uint32_t oldest = outstanding ? s_in_flight->seq : 0;
+    for (int p = 0; p < FTB8MD_PRIO_COUNT; p++)
+    {
+        sched_entry_t *head = s_queue[p].head;
+        if (head != NULL && (!outstanding || (int32_t)(head->seq - oldest) < 0))
+        {
+            oldest = head->seq;
+            outstanding = true;
+        }
+    }
+
+    int n = 0;
+    for (int i = 0; i < FTB8MD_SCHED_MAX_FENCES; i++)
+    {
+        sched_fence_t *fence = &s_fences[i];
+        if (fence->cb != NULL && (!outstanding || (int32_t)(oldest - fence->seq) >= 0))
+        {
+            done[n++] = *fence;
+            fence->cb = NULL;
+        }
+    }
+
+    return n;
+}
+
+static void sched_worker(void *arg)
+{
+    for (;;)
+    {
+        portENTER_CRITICAL(&s_lock);
+        sched_entry_t *entry = dequeue_locked();
+        bool stop = entry == NULL && s_stopping;
+        s_in_flight = entry;
+        portEXIT_CRITICAL(&s_lock);
+
+        if (stop)
+        {
+            break;
+        }
+        if (entry == NULL)
+        {
+            xEventGroupWaitBits(s_events, EVT_WORK, pdTRUE, pdFALSE, portMAX_DELAY);
+            continue;
+        }
+
+        // A late update that is worthless late is not worth the bus time
+        bool expired = entry->drop_late && esp_timer_get_time() > entry->deadline_us;
+
+        // Control registers that already hold the value are not sent again
+        bool redundant = !expired && !entry->refresh &&
+                         ftb8md_panel_ctrl_redundant(entry->panel, entry->data, entry->len);
+
+        esp_err_t ret = expired || redundant ? ESP_OK : ftb8md_panel_transmit(entry->panel, entry->data, entry->len);
+        if (expired || ret != ESP_OK)
+        {
+            // The shadow already assumes this write; make the next diff resend it
+            ftb8md_panel_mark_lost(entry->panel, entry->data, entry->len);
+        }
+        int64_t now = esp_timer_get_time();
+        uint32_t latency = (uint32_t)(now - entry->queued_us);
+
+        portENTER_CRITICAL(&s_lock);
+        if (expired)
+        {
+            s_stats.dropped_late++;
+        }
+        else if (redundant)
+        {
+            s_stats.superseded++;
+        }
+        else if (ret == ESP_OK)
+        {
+            if (now > entry->deadline_us)
+            {
+                s_stats.late++;
+            }
+            s_stats.sent[entry->prio]++;
+            s_latency_sum[entry->prio] += latency;
+            if (latency > s_stats.max_latency_us[entry->prio])
+            {
+                s_stats.max_latency_us[entry->prio] = latency;
+            }
+        }
+        else
+        {
+            s_stats.failed++;
+        }
+        for (int i = 0; (expired || ret != ESP_OK) && i < FTB8MD_SCHED_MAX_FENCES; i++)
+        {
+            sched_fence_t *fence = &s_fences[i];
+            if (fence->cb != NULL && fence->result == ESP_OK && (int32_t)(entry->seq - fence->seq) < 0)
+            {
+                fence->result = expired ? ESP_ERR_TIMEOUT : ret;
+            }
+        }
+        s_in_flight = NULL;
+        entry->next = s_free;
+        s_free = entry;
+        bool idle = --s_pending == 0;
+        sched_fence_t done[FTB8MD_SCHED_MAX_FENCES];
+        int n_done = fences_take_locked(done);
+        portEXIT_CRITICAL(&s_lock);
+
+        xSemaphoreGive(s_free_sem);
+        for (int i = 0; i < n_done; i++)
+        {
+            done[i].cb(done[i].result, done[i].arg);
+        }
+        if (idle)
+        {
+            xEventGroupSetBits(s_events, EVT_IDLE);
+        }
+    }
+
+    xEventGroupSetBits(s_events, EVT_STOPPED);
+    vTaskDelete(NULL);
+}
+
+bool ftb8md_sched_running(void)
+{
+    return s_running;
+}
+
+bool ftb8md_sched_idle(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    bool idle = s_pending == 0;
+    portEXIT_CRITICAL(&s_lock);
+
+    return idle;
+}
+
+/**
+ * @brief Write options for a command queued by the current task.
+ *
+ * @param cmd Encoded command
+ * @param prio Requested class, or FTB8MD_PRIO_AUTO for the write options of the task
+ * @param[out] opts Options with a resolved priority class
+ */
+static void submit_options(const uint8_t *cmd, ftb8md_priority_t prio, ftb8md_write_opts_t *opts)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    *opts = (ftb8md_write_opts_t)FTB8MD_WRITE_OPTS_DEFAULT();
+
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < FTB8MD_SCHED_MAX_SCOPES; i++)
+    {
+        if (s_scopes[i].task == task)
+        {
+            *opts = s_scopes[i].opts;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (prio != FTB8MD_PRIO_AUTO)
+    {
+        opts->priority = prio;
+    }
+    if (opts->priority < 0 || opts->priority >= FTB8MD_PRIO_COUNT)
+    {
+        opts->priority = (cmd[0] >> 5) == CMD_PREFIX_CGRAM ? FTB8MD_PRIO_BACKGROUND : FTB8MD_PRIO_NORMAL;
+    }
+}
+
+esp_err_t ftb8md_sched_submit(ftb8md_panel_t *panel, const uint8_t *cmd, size_t len, int prio, bool refresh)
+{
+    bool cgram = (cmd[0] >> 5) == CMD_PREFIX_CGRAM;
+    size_t piece = cgram ? 1 + FTB8MD_GLYPH_COLS : len;
+
+    // Only the worker frees entries; from a completion callback it would wait for itself on a full queue
+    if (xTaskGetCurrentTaskHandle() == s_worker)
+    {
+        ESP_LOGE(TAG, "Write from a completion callback");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (len == 0 || piece > ENTRY_MAX_LEN || (cgram && (len == 1 || (len - 1) % FTB8MD_GLYPH_COLS != 0)))
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    ftb8md_write_opts_t opts;
+    submit_options(cmd, (ftb8md_priority_t)prio, &opts);
+    int64_t deadline = opts.deadline_us != 0 ? esp_timer_get_time() + opts.deadline_us : NO_DEADLINE;
+
+    // Queue CGRAM bursts one character at a time so urgent commands can get in between; a command of
+    // a single byte still takes one entry
+    size_t off = 1;
+    do
+    {
+        uint8_t data[ENTRY_MAX_LEN];
+        data[0] = cgram ? FTB8MD_CMD_CGRAM((cmd[0] & 0x07) + off / FTB8MD_GLYPH_COLS) : cmd[0];
+        memcpy(&data[1], &cmd[off], piece - 1);
+        uint8_t kind, lo, hi, glyphs;
+        entry_target(data, piece, &kind, &lo, &hi, &glyphs);
+
+        xSemaphoreTake(s_free_sem, portMAX_DELAY);
+
+        portENTER_CRITICAL(&s_lock);
+        bool stopping = s_stopping;
+        int freed = 0;
+        if (!stopping)
+        {
+            sched_entry_t *entry = s_free;
+            s_free = entry->next;
+            entry->panel = panel;
+            entry->queued_us = esp_timer_get_time();
+            entry->deadline_us = deadline;
+            entry->prio = (uint8_t)opts.priority;
+            entry->refresh = refresh;
+            entry->drop_late = deadline != NO_DEADLINE && opts.drop_late;
+            entry->kind = kind;
+            entry->lo = lo;
+            entry->hi = hi;
+            entry->glyphs = glyphs;
+            entry->len = (uint8_t)piece;
+            memcpy(entry->data, data, piece);
+            freed = enqueue_locked(entry);
+        }
+        portEXIT_CRITICAL(&s_lock);
+
+        if (stopping)
+        {
+            // ftb8md_sched_stop() has begun and the worker may be gone: send directly once the
+            // writes queued before have gone out
+            xSemaphoreGive(s_free_sem);
+            ftb8md_sched_flush(portMAX_DELAY);
+            esp_err_t ret = ftb8md_panel_transmit(panel, data, piece);
+            if (ret != ESP_OK)
+            {
+                return ret;
+            }
+        }
+        else
+        {
+            while (freed-- > 0)
+            {
+                xSemaphoreGive(s_free_sem);
+            }
+            // Woken through the event group, which outlives the worker should it exit meanwhile
+            xEventGroupSetBits(s_events, EVT_WORK);
+        }
+        off += piece - 1;
+    } while (off < len);
+
+    return ESP_OK;
+}
+
+esp_err_t ftb8md_sched_start(const ftb8md_sched_config_t *config)
+{
+    ftb8md_sched_config_t defaults = FTB8MD_SCHED_CONFIG_DEFAULT();
+    if (config == NULL)
+    {
+        config = &defaults;
+    }
+
+    if (s_running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (s_events == NULL)
+    {
+        s_events = xEventGroupCreateStatic(&s_events_buf);
+        s_free_sem = xSemaphoreCreateCountingStatic(FTB8MD_SCHED_QUEUE_LEN, FTB8MD_SCHED_QUEUE_LEN, &s_free_sem_buf);
+        for (int i = 0; i < FTB8MD_SCHED_QUEUE_LEN; i++)
+        {
+            s_pool[i].next = s_free;
+            s_free = &s_pool[i];
+        }
+    }
+
+    s_stopping = false;
+    ftb8md_sched_reset_stats();
+
+    if (xTaskCreatePinnedToCore(sched_worker, "ftb8md_sched", config->task_stack_size, NULL, config->task_priority,
+                                &s_worker, config->task_core) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create worker task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    s_running = true;
+
+    return ESP_OK;
+}
+
+esp_err_t ftb8md_sched_stop(void)
+{
+    if (!s_running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    ftb8md_sched_flush(portMAX_DELAY);
+
+    // The worker may exit as soon as s_stopping is set
+    xEventGroupClearBits(s_events, EVT_STOPPED);
+
+    s_running = false;
+    portENTER_CRITICAL(&s_lock);
+    s_stopping = true;
+    portEXIT_CRITICAL(&s_lock);
+
+    // From here on ftb8md_sched_submit() sends directly; the worker drains what was queued before and exits
+    xEventGroupSetBits(s_events, EVT_WORK);
+    xEventGroupWaitBits(s_events, EVT_STOPPED, pdTRUE, pdFALSE, portMAX_DELAY);
+    s_worker = NULL;
+
+    // Nothing should be left; should anything be, make the next diff resend it rather than lose it
+    for (;;)
+    {
+        portENTER_CRITICAL(&s_lock);
+        sched_entry_t *entry = dequeue_locked();
+        if (entry != NULL)
+        {
+            entry->next = s_free;
+            s_free = entry;
+            s_pending--;
+            s_stats.failed++;
+        }
+        portEXIT_CRITICAL(&s_lock);
+
+        if (entry == NULL)
+        {
+            break;
+        }
+        ftb8md_panel_mark_lost(entry->panel, entry->data, entry->len);
+        xSemaphoreGive(s_free_sem);
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t ftb8md_sched_flush(TickType_t timeout)
+{
+    if (s_events == NULL)
+    {
+        return ESP_OK;
+    }
+
+    TickType_t start = xTaskGetTickCount();
+    for (;;)
+    {
+        portENTER_CRITICAL(&s_lock);
+        uint32_t pending = s_pending;
+        portEXIT_CRITICAL(&s_lock);
+
+        if (pending == 0)
+        {
+            return ESP_OK;
+        }
+
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (timeout != portMAX_DELAY && elapsed >= timeout)
+        {
+            return ESP_ERR_TIMEOUT;
+        }
+
+        // A stale idle bit only causes another pass through the loop
+        xEventGroupWaitBits(s_events, EVT_IDLE, pdTRUE, pdFALSE,
+                            timeout == portMAX_DELAY ? portMAX_DELAY : timeout - elapsed);
+    }
+}
+
+esp_err_t ftb8md_sched_fence(ftb8md_done_cb_t cb, void *arg)
+{
+    if (cb == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    bool now = true;
+    esp_err_t ret = ESP_OK;
+
+    portENTER_CRITICAL(&s_lock);
+    if (s_running && s_pending != 0)
+    {
+        ret = ESP_ERR_NO_MEM;
+        for (int i = 0; i < FTB8MD_SCHED_MAX_FENCES; i++)
+        {
+            sched_fence_t *fence = &s_fences[i];
+            if (fence->cb == NULL)
+            {
+                fence->cb = cb;
+                fence->arg = arg;
+                fence->seq = s_seq;
+                fence->result = ESP_OK;
+                now = false;
+                ret = ESP_OK;
+                break;
+            }
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (now && ret == ESP_OK)
+    {
+        cb(ESP_OK, arg);
+    }
+
+    return ret;
+}
+
+esp_err_t ftb8md_opts_begin(const ftb8md_write_opts_t *opts)
+{
+    if (opts == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    sched_scope_t *scope = NULL;
+
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < FTB8MD_SCHED_MAX_SCOPES; i++)
+    {
+        if (s_scopes[i].task == task)
+        {
+            scope = &s_scopes[i];
+            break;
+        }
+        if (scope == NULL && s_scopes[i].task == NULL)
+        {
+            scope = &s_scopes[i];
+        }
+    }
+    if (scope != NULL)
+    {
+        scope->task = task;
+        scope->opts = *opts;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    return scope != NULL ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+void ftb8md_opts_end(void)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    ftb8md_done_cb_t cb = NULL;
+    void *arg = NULL;
+
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < FTB8MD_SCHED_MAX_SCOPES; i++)
+    {
+        if (s_scopes[i].task == task)
+        {
+            s_scopes[i].task = NULL;
+            cb = s_scopes[i].opts.done_cb;
+            arg = s_scopes[i].opts.done_arg;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (cb != NULL && ftb8md_sched_fence(cb, arg) != ESP_OK)
+    {
+        cb(ESP_ERR_NO_MEM, arg);
+    }
+}
+
+esp_err_t ftb8md_sched_get_stats(ftb8md_sched_stats_t *stats)
+{
+    if (stats == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    *stats = s_stats;
+    for (int p = 0; p < FTB8MD_PRIO_COUNT; p++)
+    {
+        stats->avg_latency_us[p] = s_stats.sent[p] != 0 ? (uint32_t)(s_latency_sum[p] / s_stats.sent[p]) : 0;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    return ESP_OK;
+}
+
+void ftb8md_sched_reset_stats(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    memset(&s_stats, 0, sizeof(s_stats));
+    memset(s_latency_sum, 0, sizeof(s_latency_sum));
+    s_stats.queue_high_water = s_pending;
+    portEXIT_CRITICAL(&s_lock);
+}
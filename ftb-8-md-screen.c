@@ -0,0 +1,205 @@
+/**
+ * @file ftb-8-md-screen.c
+ * @brief Pre-encoded screens for instant screen switching.
+ */
+
+#include "ftb-8-md-screen.h"
+#include "ftb-8-md-bus.h"
+#include "ftb-8-md-priv.h"
+
+#include <string.h>
+
+void ftb8md_screen_clear(ftb8md_screen_t *screen)
+{
+    if (screen == NULL)
+    {
+        return;
+    }
+
+    memset(screen, 0, sizeof(*screen));
+    memset(screen->dcram, ' ', sizeof(screen->dcram));
+}
+
+esp_err_t ftb8md_screen_set_string(ftb8md_screen_t *screen, int digit, const char *str)
+{
+    if (screen == NULL || str == NULL || digit < 0 || digit >= FTB8MD_NUM_DIGITS)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t count = strnlen(str, (size_t)(FTB8MD_NUM_DIGITS - digit));
+    memcpy(&screen->dcram[digit], str, count);
+
+    return ESP_OK;
+}
+
+esp_err_t ftb8md_screen_set_codes(ftb8md_screen_t *screen, int digit, const uint8_t *codes, size_t count)
+{
+    if (screen == NULL || codes == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (digit < 0 || digit >= FTB8MD_NUM_DIGITS || count == 0 || count > (size_t)(FTB8MD_NUM_DIGITS - digit))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memcpy(&screen->dcram[digit], codes, count);
+
+    return ESP_OK;
+}
+
+esp_err_t ftb8md_screen_set_dot(ftb8md_screen_t *screen, int digit, bool dot_on)
+{
+    if (screen == NULL || digit < 0 || digit >= FTB8MD_NUM_DIGITS)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (dot_on)
+    {
+        screen->adram[digit] |= FTB8MD_ADRAM_DOT;
+    }
+    else
+    {
+        screen->adram[digit] &= (uint8_t)~FTB8MD_ADRAM_DOT;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t ftb8md_screen_set_adram(ftb8md_screen_t *screen, int digit, uint8_t bits)
+{
+    if (screen == NULL || digit < 0 || digit >= FTB8MD_NUM_DIGITS)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    screen->adram[digit] = bits;
+
+    return ESP_OK;
+}
+
+esp_err_t ftb8md_screen_set_custom_char(ftb8md_screen_t *screen, int char_index, const uint8_t grid_data[5])
+{
+    if (screen == NULL || grid_data == NULL || char_index < 0 || char_index >= FTB8MD_NUM_CGRAM)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memcpy(screen->cgram[char_index], grid_data, FTB8MD_GLYPH_COLS);
+    screen->cgram_used |= 1u << char_index;
+
+    return ESP_OK;
+}
+
+esp_err_t ftb8md_screen_set_addressed_char(ftb8md_screen_t *screen, int digit, int char_index)
+{
+    if (screen == NULL || digit < 0 || digit >= FTB8MD_NUM_DIGITS || char_index < 0 ||
+        char_index >= FTB8MD_NUM_CGRAM)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    screen->dcram[digit] = (uint8_t)char_index;
+
+    return ESP_OK;
+}
+
+esp_err_t ftb8md_screen_capture(ftb8md_screen_t *screen, spi_device_handle_t handle)
+{
+    ftb8md_panel_t *panel = ftb8md_panel_get(handle);
+    if (panel == NULL || screen == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_OK;
+    const ftb8md_shadow_t *shadow = &panel->shadow;
+
+    ftb8md_panel_lock(panel);
+    if (shadow->dcram_valid != FTB8MD_DIGIT_MASK || shadow->adram_valid != FTB8MD_DIGIT_MASK)
+    {
+        ret = ESP_ERR_INVALID_STATE;
+    }
+    else
+    {
+        memcpy(screen->dcram, shadow->dcram, sizeof(screen->dcram));
+        memcpy(screen->adram, shadow->adram, sizeof(screen->adram));
+        memcpy(screen->cgram, shadow->cgram, sizeof(screen->cgram));
+        screen->cgram_used = shadow->cgram_valid;
+    }
+    ftb8md_panel_unlock(panel);
+
+    return ret;
+}
+
+/**
+ * @brief Check whether the panel needs a custom character of the screen.
+ */
+static bool screen_cgram_changed(const ftb8md_shadow_t *shadow, const ftb8md_screen_t *screen, int slot)
+{
+    if (!(screen->cgram_used & (1u << slot)))
+    {
+        return false;
+    }
+
+    return !(shadow->cgram_valid & (1u << slot)) ||
+           memcmp(shadow->cgram[slot], screen->cgram[slot], FTB8MD_GLYPH_COLS) != 0;
+}
+
+esp_err_t ftb8md_screen_show(spi_device_handle_t handle, const ftb8md_screen_t *screen)
+{
+    ftb8md_panel_t *panel = ftb8md_panel_get(handle);
+    if (panel == NULL || screen == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Holding the panel and its bus keeps the switch one uninterrupted burst
+    esp_err_t ret = ftb8md_bus_acquire(handle, portMAX_DELAY);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+
+    const ftb8md_shadow_t *shadow = &panel->shadow;
+
+    // Upload changed characters first, so digits never show stale patterns
+    int slot = 0;
+    while (slot < FTB8MD_NUM_CGRAM && ret == ESP_OK)
+    {
+        if (!screen_cgram_changed(shadow, screen, slot))
+        {
+            slot++;
+            continue;
+        }
+
+        // Extend the run over adjacent changed characters
+        int first = slot++;
+        while (slot < FTB8MD_NUM_CGRAM && screen_cgram_changed(shadow, screen, slot))
+        {
+            slot++;
+        }
+
+        uint8_t cmd[FTB8MD_CMD_MAX_LEN];
+        size_t len = (size_t)(slot - first) * FTB8MD_GLYPH_COLS;
+        cmd[0] = FTB8MD_CMD_CGRAM(first);
+        memcpy(&cmd[1], screen->cgram[first], len);
+        ret = ftb8md_panel_send(panel, cmd, 1 + len);
+    }
+
+    if (ret == ESP_OK)
+    {
+        ret = ftb8md_panel_write_diff(panel, CMD_PREFIX_DCRAM, screen->dcram, FTB8MD_DIGIT_MASK);
+    }
+    if (ret == ESP_OK)
+    {
+        ret = ftb8md_panel_write_diff(panel, CMD_PREFIX_ADRAM, screen->adram, FTB8MD_DIGIT_MASK);
+    }
+
+    ftb8md_bus_release(handle);
+
+    return ret;
+}
@@ -0,0 +1,89 @@
+/**
+ * @file ftb-8-md-scroll.c
+ * @brief Pixel-smooth horizontal scrolling via CGRAM regeneration.
+ */
+
+#include "ftb-8-md-scroll.h"
+#include "ftb-8-md-font.h"
+
+#include <string.h>
+
+/**
+ * @brief Number of columns in the text stream.
+ */
+static int stream_width(const ftb8md_scroll_t *scroll)
+{
+    return (int)scroll->len * (FTB8MD_GLYPH_COLS + scroll->spacing);
+}
+
+/**
+ * @brief Column byte at a position of the text stream (blank outside the text).
+ */
+static uint8_t stream_column(const ftb8md_scroll_t *scroll, int pos)
+{
+    if (pos < 0 || pos >= stream_width(scroll))
+    {
+        return 0;
+    }
+
+    int pitch = FTB8MD_GLYPH_COLS + scroll->spacing;
+    int col = pos % pitch;
+    if (col >= FTB8MD_GLYPH_COLS)
+    {
+        return 0;
+    }
+
+    const uint8_t *glyph = ftb8md_font_ascii_glyph(scroll->text[pos / pitch]);
+    return glyph != NULL ? glyph[col] : 0;
+}
+
+void ftb8md_scroll_init(ftb8md_scroll_t *scroll, const char *text, int spacing, bool loop)
+{
+    if (scroll == NULL)
+    {
+        return;
+    }
+
+    scroll->text = text != NULL ? text : "";
+    scroll->len = strlen(scroll->text);
+    scroll->spacing = spacing < 0 ? 0 : spacing;
+    scroll->offset = -FTB8MD_BITMAP_WIDTH;
+    scroll->loop = loop;
+    ftb8md_bitmap_clear(&scroll->frame);
+}
+
+void ftb8md_scroll_render(const ftb8md_scroll_t *scroll, ftb8md_bitmap_t *bmp)
+{
+    if (scroll == NULL || bmp == NULL)
+    {
+        return;
+    }
+
+    for (int x = 0; x < FTB8MD_BITMAP_WIDTH; x++)
+    {
+        bmp->col[x] = stream_column(scroll, scroll->offset + x);
+    }
+}
+
+esp_err_t ftb8md_scroll_step(spi_device_handle_t handle, ftb8md_scroll_t *scroll, int columns)
+{
+    if (handle == NULL || scroll == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    scroll->offset += columns;
+    if (scroll->offset >= stream_width(scroll))
+    {
+        scroll->offset = scroll->loop ? -FTB8MD_BITMAP_WIDTH : stream_width(scroll);
+    }
+
+    ftb8md_scroll_render(scroll, &scroll->frame);
+
+    return ftb8md_bitmap_flush(handle, &scroll->frame);
+}
+
+bool ftb8md_scroll_done(const ftb8md_scroll_t *scroll)
+{
+    return scroll == NULL || (!scroll->loop && scroll->offset >= stream_width(scroll));
+}
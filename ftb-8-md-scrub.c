@@ -0,0 +1,336 @@
+/**
+ * @file ftb-8-md-scrub.c
+ * @brief Background refresh of the panel RAM from the shadow copy.
+ */
+
+#include "ftb-8-md-scrub.h"
+#include "ftb-8-md-priv.h"
+#include "ftb-8-md-sched.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include <string.h>
+
+static const char *TAG = "FTB8MD_SCRUB";
+
+/** @brief Credit for one byte in ftb8md_panel_t::scrub_credit */
+#define SCRUB_BYTE 1000000LL
+
+/** @brief Shortest scrubber tick */
+#define SCRUB_MIN_PERIOD_US 1000
+
+/**
+ * @brief Regions walked by the scrubber, in order.
+ */
+enum
+{
+    REGION_DCRAM,
+    REGION_ADRAM,
+    REGION_CGRAM,
+    REGION_CTRL,
+    REGION_COUNT,
+};
+
+/* Control registers resent in REGION_CTRL, in order */
+enum
+{
+    CTRL_DIGIT_SET,
+    CTRL_DIMMING,
+    CTRL_POWER,
+    CTRL_STANDBY,
+    CTRL_COUNT,
+};
+
+/**
+ * @brief Build the command resending one control register.
+ *
+ * @return Length of the command, or 0 if the register is unknown or about to be sent anyway
+ */
+static size_t scrub_ctrl(const ftb8md_panel_t *panel, int reg, uint8_t *cmd)
+{
+    const ftb8md_shadow_t *shadow = &panel->shadow;
+    uint8_t known = shadow->ctrl_valid & ~panel->ctrl_pending;
+
+    switch (reg)
+    {
+    case CTRL_DIGIT_SET:
+        cmd[0] = FTB8MD_CMD_DIGIT_SET;
+        cmd[1] = FTB8MD_NUM_DIGITS - 1;
+        return 2;
+
+    case CTRL_DIMMING:
+        if (!(known & FTB8MD_CTRL_DIMMING))
+        {
+            return 0;
+        }
+        cmd[0] = FTB8MD_CMD_DIMMING;
+        cmd[1] = shadow->dimming;
+        return 2;
+
+    case CTRL_POWER:
+        if (!(known & FTB8MD_CTRL_POWER))
+        {
+            return 0;
+        }
+        memcpy(cmd, ftb8md_cmd_power[shadow->power_on], 2);
+        return 2;
+
+    default:
+        if (!(known & FTB8MD_CTRL_STANDBY))
+        {
+            return 0;
+        }
+        memcpy(cmd, ftb8md_cmd_standby[shadow->standby], 2);
+        return 2;
+    }
+}
+
+/**
+ * @brief Build the next slice from the shadow.
+ *
+ * Unknown entries are skipped. The cursor is only advanced in the copies
+ * passed in; the caller commits it once the slice has been sent.
+ *
+ * @param panel Panel state (locked)
+ * @param[in,out] region Region of the cursor
+ * @param[in,out] index Position of the cursor in the region
+ * @param[out] cmd Slice command
+ * @param[out] wrapped Set when the cursor passed the end of the panel
+ * @return Length of the slice, or 0 if the shadow holds nothing known
+ */
+static size_t scrub_next(const ftb8md_panel_t *panel, uint8_t *region, uint8_t *index, uint8_t *cmd, bool *wrapped)
+{
+    const ftb8md_shadow_t *shadow = &panel->shadow;
+
+    *wrapped = false;
+
+    // One pass over all regions, plus the region the cursor started in
+    for (int step = 0; step <= REGION_COUNT; step++)
+    {
+        size_t len = 0;
+
+        switch (*region)
+        {
+        case REGION_DCRAM:
+        case REGION_ADRAM:
+        {
+            bool dcram = *region == REGION_DCRAM;
+            uint8_t valid = dcram ? shadow->dcram_valid : shadow->adram_valid;
+            const uint8_t *data = dcram ? shadow->dcram : shadow->adram;
+
+            while (*index < FTB8MD_NUM_DIGITS && !(valid & (1u << *index)))
+            {
+                (*index)++;
+            }
+            if (*index >= FTB8MD_NUM_DIGITS)
+            {
+                break;
+            }
+
+            cmd[0] = dcram ? FTB8MD_CMD_DCRAM(*index) : FTB8MD_CMD_ADRAM(*index);
+            len = 1;
+            while (*index < FTB8MD_NUM_DIGITS && (valid & (1u << *index)) && len <= panel->scrub_slice_digits)
+            {
+                cmd[len++] = data[(*index)++];
+            }
+            return len;
+        }
+
+        case REGION_CGRAM:
+            while (*index < FTB8MD_NUM_CGRAM && !(shadow->cgram_valid & (1u << *index)))
+            {
+                (*index)++;
+            }
+            if (*index >= FTB8MD_NUM_CGRAM)
+            {
+                break;
+            }
+
+            cmd[0] = FTB8MD_CMD_CGRAM(*index);
+            memcpy(&cmd[1], shadow->cgram[*index], FTB8MD_GLYPH_COLS);
+            (*index)++;
+            return 1 + FTB8MD_GLYPH_COLS;
+
+        default:
+            while (*index < CTRL_COUNT && len == 0)
+            {
+                len = scrub_ctrl(panel, (*index)++, cmd);
+            }
+            if (len != 0)
+            {
+                return len;
+            }
+            break;
+        }
+
+        // Region exhausted
+        *index = 0;
+        if (++*region >= REGION_COUNT)
+        {
+            *region = 0;
+            *wrapped = true;
+        }
+    }
+
+    return 0;
+}
+
+static void scrub_timer_cb(void *arg)
+{
+    ftb8md_panel_t *panel = arg;
+
+    if (!ftb8md_panel_trylock(panel, 0))
+    {
+        // Another task is writing; it will refresh those entries anyway
+        panel->scrub_stats.skipped++;
+        return;
+    }
+
+    // Credit is capped at the longest slice, so a busy period is not followed by a burst
+    int slice_max = 1 + (panel->scrub_slice_digits > FTB8MD_GLYPH_COLS ? panel->scrub_slice_digits : FTB8MD_GLYPH_COLS);
+    int64_t limit = slice_max * SCRUB_BYTE;
+    panel->scrub_credit += (int64_t)panel->scrub_period_us * panel->scrub_bytes_per_sec;
+    if (panel->scrub_credit > limit)
+    {
+        panel->scrub_credit = limit;
+    }
+
+    bool sched = ftb8md_sched_running();
+    if (sched && !ftb8md_sched_idle())
+    {
+        panel->scrub_stats.skipped++;
+        ftb8md_panel_unlock(panel);
+        return;
+    }
+
+    uint8_t cmd[FTB8MD_CMD_PIECE_MAX_LEN];
+    uint8_t region = panel->scrub_region;
+    uint8_t index = panel->scrub_index;
+    bool wrapped;
+    size_t len = scrub_next(panel, &region, &index, cmd, &wrapped);
+
+    if (len != 0 && panel->scrub_credit >= (int64_t)len * SCRUB_BYTE)
+    {
+        // The shadow already holds this data, so it is sent without touching it
+        esp_err_t ret = sched ? ftb8md_sched_submit(panel, cmd, len, FTB8MD_PRIO_BACKGROUND, true)
+                              : ftb8md_panel_transmit(panel, cmd, len);
+        if (ret == ESP_OK)
+        {
+            ftb8md_panel_dither_unblank(panel, cmd, len);
+            panel->scrub_credit -= (int64_t)len * SCRUB_BYTE;
+            panel->scrub_stats.slices++;
+            panel->scrub_stats.bytes += len;
+            if (wrapped)
+            {
+                panel->scrub_stats.passes++;
+            }
+            panel->scrub_region = region;
+            panel->scrub_index = index;
+        }
+        else if (ret == ESP_ERR_TIMEOUT)
+        {
+            // Over the bus budget; the slice is tried again with the next tick
+            panel->scrub_stats.skipped++;
+        }
+        else
+        {
+            ESP_LOGW(TAG, "Failed to send slice: %s", esp_err_to_name(ret));
+        }
+    }
+
+    ftb8md_panel_unlock(panel);
+}
+
+esp_err_t ftb8md_scrub_start(spi_device_handle_t handle, const ftb8md_scrub_config_t *config)
+{
+    ftb8md_scrub_config_t defaults = FTB8MD_SCRUB_CONFIG_DEFAULT();
+    if (config == NULL)
+    {
+        config = &defaults;
+    }
+
+    ftb8md_panel_t *panel = ftb8md_panel_get(handle);
+    if (panel == NULL || config->bytes_per_sec == 0 || config->slice_digits == 0 ||
+        config->slice_digits > FTB8MD_NUM_DIGITS)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_OK;
+
+    ftb8md_panel_lock(panel);
+
+    if (panel->scrub_timer == NULL)
+    {
+        esp_timer_create_args_t args = {
+            .callback = scrub_timer_cb,
+            .arg = panel,
+            .name = "ftb8md_scrub",
+        };
+        ret = esp_timer_create(&args, &panel->scrub_timer);
+        memset(&panel->scrub_stats, 0, sizeof(panel->scrub_stats));
+        panel->scrub_region = 0;
+        panel->scrub_index = 0;
+        panel->scrub_credit = 0;
+    }
+    else
+    {
+        esp_timer_stop(panel->scrub_timer);
+    }
+
+    if (ret == ESP_OK)
+    {
+        panel->scrub_bytes_per_sec = config->bytes_per_sec;
+        panel->scrub_slice_digits = config->slice_digits;
+
+        // Tick about once per full DCRAM slice; credit evens out the different slice lengths
+        uint64_t period = (uint64_t)(1 + config->slice_digits) * 1000000 / config->bytes_per_sec;
+        panel->scrub_period_us = period > SCRUB_MIN_PERIOD_US ? (uint32_t)period : SCRUB_MIN_PERIOD_US;
+        ret = esp_timer_start_periodic(panel->scrub_timer, panel->scrub_period_us);
+    }
+    else
+    {
+        panel->scrub_timer = NULL;
+        ret = ESP_ERR_NO_MEM;
+    }
+
+    ftb8md_panel_unlock(panel);
+
+    return ret;
+}
+
+esp_err_t ftb8md_scrub_stop(spi_device_handle_t handle)
+{
+    ftb8md_panel_t *panel = ftb8md_panel_get(handle);
+    if (panel == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ftb8md_panel_lock(panel);
+    if (panel->scrub_timer != NULL)
+    {
+        esp_timer_stop(panel->scrub_timer);
+        esp_timer_delete(panel->scrub_timer);
+        panel->scrub_timer = NULL;
+    }
+    ftb8md_panel_unlock(panel);
+
+    return ESP_OK;
+}
+
+esp_err_t ftb8md_scrub_get_stats(spi_device_handle_t handle, ftb8md_scrub_stats_t *stats)
+{
+    ftb8md_panel_t *panel = ftb8md_panel_get(handle);
+    if (panel == NULL || stats == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ftb8md_panel_lock(panel);
+    *stats = panel->scrub_stats;
+    ftb8md_panel_unlock(panel);
+
+    return ESP_OK;
+}
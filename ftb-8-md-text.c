@@ -0,0 +1,255 @@
+/**
+ * @file ftb-8-md-text.c
+ * @brief UTF-8 text rendering with CGRAM glyph substitution.
+ */
+
+#include "ftb-8-md-text.h"
+#include "ftb-8-md-priv.h"
+
+#include <string.h>
+
+/** @brief Marks a digit whose code still has to be assigned a CGRAM character */
+#define CODE_PENDING 0xFFFF
+
+void ftb8md_text_init(ftb8md_text_t *text, const ftb8md_glyph_table_t *table, uint8_t slot_mask)
+{
+    if (text == NULL)
+    {
+        return;
+    }
+
+    memset(text, 0, sizeof(*text));
+    text->table = table != NULL ? table : &ftb8md_glyphs_extended;
+    text->slot_mask = slot_mask;
+}
+
+size_t ftb8md_utf8_decode(const char *str, uint32_t *codepoint)
+{
+    const uint8_t *s = (const uint8_t *)str;
+    uint32_t cp;
+    size_t len;
+
+    if (s[0] < 0x80)
+    {
+        *codepoint = s[0];
+        return 1;
+    }
+    else if ((s[0] & 0xE0) == 0xC0)
+    {
+        cp = s[0] & 0x1F;
+        len = 2;
+    }
+    else if ((s[0] & 0xF0) == 0xE0)
+    {
+        cp = s[0] & 0x0F;
+        len = 3;
+    }
+    else if ((s[0] & 0xF8) == 0xF0)
+    {
+        cp = s[0] & 0x07;
+        len = 4;
+    }
+    else
+    {
+        *codepoint = 0xFFFD;
+        return 1;
+    }
+
+    for (size_t i = 1; i < len; i++)
+    {
+        // Also stops at the terminating NUL
+        if ((s[i] & 0xC0) != 0x80)
+        {
+            *codepoint = 0xFFFD;
+            return 1;
+        }
+        cp = (cp << 6) | (s[i] & 0x3F);
+    }
+
+    static const uint32_t min_cp[] = {0, 0, 0x80, 0x800, 0x10000};
+    if (cp < min_cp[len] || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+    {
+        *codepoint = 0xFFFD;
+        return 1;
+    }
+
+    *codepoint = cp;
+    return len;
+}
+
+int ftb8md_text_rom_code(uint32_t codepoint)
+{
+    // Only the ASCII block is common to all CGROM variants (datasheet table 2
+    // is "general-purpose code 02"); everything else is synthesised in CGRAM.
+    if (codepoint >= 0x20 && codepoint <= 0x7E)
+    {
+        return (int)codepoint;
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Find the CGRAM character of the context that already holds a glyph.
+ *
+ * The shadow is checked as well, so a character overwritten by someone else is not reused.
+ */
+static int find_loaded(const ftb8md_text_t *text, const ftb8md_shadow_t *shadow, uint32_t cp, const uint8_t *glyph)
+{
+    for (int slot = 0; slot < FTB8MD_NUM_CGRAM; slot++)
+    {
+        if ((text->slot_mask & (1u << slot)) && text->slot_cp[slot] == cp &&
+            (shadow->cgram_valid & (1u << slot)) && memcmp(shadow->cgram[slot], glyph, FTB8MD_GLYPH_COLS) == 0)
+        {
+            return slot;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Pick a CGRAM character to load a new glyph into.
+ *
+ * @param busy CGRAM characters that must not be replaced
+ * @return Slot index, or -1 if every usable character is busy
+ */
+static int pick_victim(const ftb8md_text_t *text, uint8_t busy)
+{
+    int victim = -1;
+
+    for (int slot = 0; slot < FTB8MD_NUM_CGRAM; slot++)
+    {
+        if (!(text->slot_mask & (1u << slot)) || (busy & (1u << slot)))
+        {
+            continue;
+        }
+        if (text->slot_cp[slot] == 0)
+        {
+            return slot;
+        }
+        if (victim < 0 || (int32_t)(text->slot_stamp[slot] - text->slot_stamp[victim]) < 0)
+        {
+            victim = slot;
+        }
+    }
+
+    return victim;
+}
+
+esp_err_t ftb8md_text_show(spi_device_handle_t handle, ftb8md_text_t *text, int digit, const char *utf8)
+{
+    ftb8md_panel_t *panel = ftb8md_panel_get(handle);
+    if (panel == NULL || text == NULL || utf8 == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (digit < 0 || digit >= FTB8MD_NUM_DIGITS)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint16_t codes[FTB8MD_NUM_DIGITS];
+    uint32_t cps[FTB8MD_NUM_DIGITS];
+    const uint8_t *glyphs[FTB8MD_NUM_DIGITS];
+    int count = 0;
+
+    while (*utf8 != '\0' && digit + count < FTB8MD_NUM_DIGITS)
+    {
+        uint32_t cp;
+        utf8 += ftb8md_utf8_decode(utf8, &cp);
+
+        int rom = ftb8md_text_rom_code(cp);
+        glyphs[count] = rom < 0 ? ftb8md_glyph_find(text->table, cp) : NULL;
+        cps[count] = cp;
+        codes[count] = rom >= 0 ? (uint16_t)rom : glyphs[count] != NULL ? CODE_PENDING : FTB8MD_TEXT_REPLACEMENT;
+        count++;
+    }
+
+    if (count == 0)
+    {
+        return ESP_OK;
+    }
+
+    esp_err_t ret = ESP_OK;
+    const ftb8md_shadow_t *shadow = &panel->shadow;
+
+    ftb8md_panel_lock(panel);
+
+    // CGRAM characters still visible outside the written range must keep their glyphs
+    uint8_t busy = 0;
+    for (int d = 0; d < FTB8MD_NUM_DIGITS; d++)
+    {
+        bool outside = d < digit || d >= digit + count;
+        if (outside && (shadow->dcram_valid & (1u << d)) && shadow->dcram[d] < FTB8MD_NUM_CGRAM)
+        {
+            busy |= 1u << shadow->dcram[d];
+        }
+    }
+
+    for (int i = 0; i < count && ret == ESP_OK; i++)
+    {
+        if (codes[i] != CODE_PENDING)
+        {
+            continue;
+        }
+
+        int slot = find_loaded(text, shadow, cps[i], glyphs[i]);
+        if (slot < 0)
+        {
+            slot = pick_victim(text, busy);
+            if (slot < 0)
+            {
+                codes[i] = FTB8MD_TEXT_REPLACEMENT;
+                continue;
+            }
+
+            uint8_t cmd[1 + FTB8MD_GLYPH_COLS];
+            cmd[0] = FTB8MD_CMD_CGRAM(slot);
+            memcpy(&cmd[1], glyphs[i], FTB8MD_GLYPH_COLS);
+            ret = ftb8md_panel_send(panel, cmd, sizeof(cmd));
+            text->slot_cp[slot] = ret == ESP_OK ? cps[i] : 0;
+        }
+
+        text->slot_stamp[slot] = ++text->stamp;
+        busy |= 1u << slot;
+
+        // Later digits showing the same code point share the character
+        for (int j = i; j < count; j++)
+        {
+            if (codes[j] == CODE_PENDING && cps[j] == cps[i])
+            {
+                codes[j] = (uint16_t)slot;
+            }
+        }
+    }
+
+    // Write only the span of digits whose codes change
+    int lo = -1;
+    int hi = -1;
+    for (int i = 0; i < count; i++)
+    {
+        int d = digit + i;
+        if (!(shadow->dcram_valid & (1u << d)) || shadow->dcram[d] != codes[i])
+        {
+            lo = lo < 0 ? i : lo;
+            hi = i;
+        }
+    }
+
+    if (ret == ESP_OK && lo >= 0)
+    {
+        uint8_t cmd[1 + FTB8MD_NUM_DIGITS];
+        cmd[0] = FTB8MD_CMD_DCRAM(digit + lo);
+        for (int i = lo; i <= hi; i++)
+        {
+            cmd[1 + i - lo] = (uint8_t)codes[i];
+        }
+        ret = ftb8md_panel_send(panel, cmd, 1 + hi - lo + 1);
+    }
+
+    ftb8md_panel_unlock(panel);
+
+    return ret;
+}
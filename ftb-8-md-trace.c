@@ -0,0 +1,139 @@
+/**
+ * @file ftb-8-md-trace.c
+ * @brief Trace of the commands sent to the panels.
+ */
+
+#include "ftb-8-md-trace.h"
+#include "ftb-8-md-priv.h"
+
+#include "freertos/task.h"
+#include "esp_timer.h"
+
+#include <stdio.h>
+
+/**
+ * @brief Call site label of a task.
+ */
+typedef struct
+{
+    TaskHandle_t task; /**< Task, NULL while the entry is free */
+    const char *site;  /**< Label of the task's calls */
+} trace_site_t;
+
+/** @brief Guards s_trace_cb, s_trace_ctx and s_sites */
+static portMUX_TYPE s_trace_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static ftb8md_trace_cb_t s_trace_cb;
+static void *s_trace_ctx;
+static trace_site_t s_sites[FTB8MD_TRACE_MAX_SITES];
+
+esp_err_t ftb8md_trace_start(ftb8md_trace_cb_t cb, void *ctx)
+{
+    if (cb == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&s_trace_lock);
+    s_trace_cb = cb;
+    s_trace_ctx = ctx;
+    portEXIT_CRITICAL(&s_trace_lock);
+
+    return ESP_OK;
+}
+
+void ftb8md_trace_stop(void)
+{
+    portENTER_CRITICAL(&s_trace_lock);
+    s_trace_cb = NULL;
+    s_trace_ctx = NULL;
+    portEXIT_CRITICAL(&s_trace_lock);
+}
+
+esp_err_t ftb8md_trace_site(const char *site)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    trace_site_t *entry = NULL;
+
+    portENTER_CRITICAL(&s_trace_lock);
+    for (int i = 0; i < FTB8MD_TRACE_MAX_SITES; i++)
+    {
+        if (s_sites[i].task == task)
+        {
+            entry = &s_sites[i];
+            break;
+        }
+        if (entry == NULL && s_sites[i].task == NULL)
+        {
+            entry = &s_sites[i];
+        }
+    }
+    if (entry != NULL)
+    {
+        entry->task = site != NULL ? task : NULL;
+        entry->site = site;
+    }
+    portEXIT_CRITICAL(&s_trace_lock);
+
+    return entry != NULL || site == NULL ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+void ftb8md_trace_print(const ftb8md_trace_record_t *record, void *ctx)
+{
+    static const char hex[] = "0123456789ABCDEF";
+
+    // One write per line, so lines from different tasks do not interleave
+    char line[sizeof(FTB8MD_TRACE_CALL_PREFIX) + 32 + 2 * FTB8MD_CMD_MAX_LEN + 64];
+    bool call = record->kind == FTB8MD_TRACE_CALL;
+    int pos = snprintf(line, sizeof(line), "%s %u %lld ", call ? FTB8MD_TRACE_CALL_PREFIX : FTB8MD_TRACE_PREFIX,
+                       record->panel, (long long)record->time_us);
+    for (size_t i = 0; i < record->len && pos + 3 < (int)sizeof(line); i++)
+    {
+        line[pos++] = hex[record->cmd[i] >> 4];
+        line[pos++] = hex[record->cmd[i] & 0x0F];
+    }
+    if (call && record->site != NULL)
+    {
+        // Long labels are cut, the line still ends in a newline
+        int n = snprintf(&line[pos], sizeof(line) - pos - 1, " %s", record->site);
+        pos += n < (int)(sizeof(line) - pos - 1) ? n : (int)(sizeof(line) - pos - 2);
+    }
+    line[pos++] = '\n';
+    line[pos] = '\0';
+
+    fputs(line, ctx != NULL ? (FILE *)ctx : stdout);
+}
+
+void ftb8md_trace_emit(const ftb8md_panel_t *panel, ftb8md_trace_kind_t kind, const uint8_t *cmd, size_t len)
+{
+    TaskHandle_t task = kind == FTB8MD_TRACE_CALL ? xTaskGetCurrentTaskHandle() : NULL;
+    const char *site = NULL;
+
+    portENTER_CRITICAL(&s_trace_lock);
+    ftb8md_trace_cb_t cb = s_trace_cb;
+    void *ctx = s_trace_ctx;
+    for (int i = 0; cb != NULL && task != NULL && i < FTB8MD_TRACE_MAX_SITES; i++)
+    {
+        if (s_sites[i].task == task)
+        {
+            site = s_sites[i].site;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_trace_lock);
+
+    if (cb == NULL)
+    {
+        return;
+    }
+
+    ftb8md_trace_record_t record = {
+        .kind = kind,
+        .time_us = esp_timer_get_time(),
+        .panel = (uint8_t)ftb8md_panel_index(panel),
+        .cmd = cmd,
+        .len = len,
+        .site = site != NULL || task == NULL ? site : pcTaskGetName(task),
+    };
+    cb(&record, ctx);
+}
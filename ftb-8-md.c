@@ -4,6 +4,8 @@
  */
 
 #include "ftb-8-md.h"
+#include "ftb-8-md-priv.h"
+#include "ftb-8-md-sched.h"
 
 #include "esp_log.h"
 #include "driver/gpio.h"
@@ -12,50 +14,578 @@
 
 static const char *TAG = "FTB8MD";
 
-/** @brief Number of digits on the display */
-#define FTB8MD_NUM_DIGITS 8
+/* The FTB8MD_CMD_* RAM write macros must produce the opcodes of the datasheet */
+static_assert(FTB8MD_CMD_DCRAM(7) == 0x27 && FTB8MD_CMD_CGRAM(7) == 0x47 && FTB8MD_CMD_ADRAM(7) == 0x67 &&
+                  FTB8MD_CMD_URAM(7) == 0x87,
+              "Command encoding must match the datasheet");
 
-/** @brief Maximum dimming level */
-#define FTB8MD_MAX_DIMMING 240
+const uint8_t ftb8md_cmd_power[2][2] = {
+    {FTB8MD_CMD_DISPLAY_OFF, 0x00},
+    {FTB8MD_CMD_DISPLAY_ON, 0x00},
+};
 
-/** @brief Maximum SPI clock frequency (500 kHz) */
-#define FTB8MD_SPI_CLOCK_HZ (500 * 1000)
+const uint8_t ftb8md_cmd_standby[2][2] = {
+    {FTB8MD_CMD_MODE_NORMAL, 0x00},
+    {FTB8MD_CMD_MODE_STANDBY, 0x00},
+};
 
-/* Command prefixes */
-#define CMD_PREFIX_DCRAM 0x01 /**< DCRAM write command prefix (001) */
-#define CMD_PREFIX_CGRAM 0x02 /**< CGRAM write command prefix (010) */
-#define CMD_PREFIX_ADRAM 0x03 /**< ADRAM write command prefix (011) */
-#define CMD_PREFIX_URAM 0x04  /**< URAM write command prefix (100) */
+/** @brief Digit count setting for FTB8MD_NUM_DIGITS digits (0-7 means 1-8 digits) */
+static const uint8_t s_cmd_digit_set[2] = {FTB8MD_CMD_DIGIT_SET, FTB8MD_NUM_DIGITS - 1};
 
-/* Control commands */
-#define CMD_DIGIT_SET 0xE0    /**< Number of digits setting command */
-#define CMD_DIMMING 0xE4      /**< Dimming level setting command */
-#define CMD_DISPLAY_ON 0xE8   /**< Display on command */
-#define CMD_DISPLAY_OFF 0xEA  /**< Display off command */
-#define CMD_MODE_NORMAL 0xEC  /**< Normal mode command */
-#define CMD_MODE_STANDBY 0xED /**< Standby mode command */
+/** @brief Registered panels */
+ftb8md_panel_t ftb8md_panels[FTB8MD_MAX_PANELS];
+
+/** @brief Guards slot allocation in ftb8md_panels */
+static portMUX_TYPE s_panels_lock = portMUX_INITIALIZER_UNLOCKED;
 
 /**
- * @brief Send a command to the VFD display.
+ * @brief Invalidate shadow entries whose queued write failed.
  *
- * @param handle SPI device handle
- * @param cmd Pointer to the command data
+ * Called with the panel lock held.
+ */
+static void ftb8md_panel_drop_lost(ftb8md_panel_t *panel)
+{
+    // Forget what queued writes that never reached the panel would have set
+    portENTER_CRITICAL(&panel->lost_lock);
+    panel->shadow.dcram_valid &= ~panel->lost_dcram;
+    panel->shadow.adram_valid &= ~panel->lost_adram;
+    panel->shadow.cgram_valid &= ~panel->lost_cgram;
+    panel->shadow.ctrl_valid &= ~panel->lost_ctrl;
+    panel->lost_dcram = 0;
+    panel->lost_adram = 0;
+    panel->lost_cgram = 0;
+    panel->lost_ctrl = 0;
+    portEXIT_CRITICAL(&panel->lost_lock);
+}
+
+void ftb8md_panel_lock(ftb8md_panel_t *panel)
+{
+    // Panels of a parallel group take the group lock first, the order ftb8md_par_frame_begin() uses
+    if (FTB8MD_PAR_ENABLED && panel->par != NULL)
+    {
+        ftb8md_par_lock(panel, portMAX_DELAY);
+    }
+    xSemaphoreTakeRecursive(panel->lock, portMAX_DELAY);
+    ftb8md_panel_drop_lost(panel);
+}
+
+bool ftb8md_panel_trylock(ftb8md_panel_t *panel, TickType_t timeout)
+{
+    bool grouped = FTB8MD_PAR_ENABLED && panel->par != NULL;
+    if (grouped && !ftb8md_par_lock(panel, timeout))
+    {
+        return false;
+    }
+    if (xSemaphoreTakeRecursive(panel->lock, timeout) != pdTRUE)
+    {
+        if (grouped)
+        {
+            ftb8md_par_unlock(panel);
+        }
+        return false;
+    }
+    ftb8md_panel_drop_lost(panel);
+
+    return true;
+}
+
+void ftb8md_panel_unlock(ftb8md_panel_t *panel)
+{
+    xSemaphoreGiveRecursive(panel->lock);
+    if (FTB8MD_PAR_ENABLED && panel->par != NULL)
+    {
+        ftb8md_par_unlock(panel);
+    }
+}
+
+ftb8md_panel_t *ftb8md_panel_alloc(spi_device_handle_t handle, spi_host_device_t host, bool known_reset_state)
+{
+    ftb8md_panel_t *panel = NULL;
+
+    portENTER_CRITICAL(&s_panels_lock);
+    for (int i = 0; i < FTB8MD_MAX_PANELS; i++)
+    {
+        if (ftb8md_panels[i].spi == NULL)
+        {
+            panel = &ftb8md_panels[i];
+            panel->spi = handle;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_panels_lock);
+
+    if (panel == NULL)
+    {
+        return NULL;
+    }
+
+    panel->host = host;
+    panel->lock = xSemaphoreCreateRecursiveMutexStatic(&panel->lock_buf);
+    memset(&panel->shadow, 0, sizeof(panel->shadow));
+    portMUX_INITIALIZE(&panel->lost_lock);
+    panel->lost_dcram = 0;
+    panel->lost_adram = 0;
+    panel->lost_cgram = 0;
+    panel->lost_ctrl = 0;
+    panel->wire_valid = 0;
+    panel->ctrl_pending = 0;
+    panel->ctrl_interval_us = 0;
+    panel->ctrl_last_us = 0;
+    panel->ctrl_timer = NULL;
+    panel->scrub_timer = NULL;
+    panel->dither_timer = NULL;
+    panel->dither_blanked = 0;
+    panel->session_depth = 0;
+    panel->par = NULL;
+    panel->par_lane = 0;
+#if FTB8MD_COST_ENABLED
+    panel->cost_active = false;
+#endif
+
+    if (known_reset_state)
+    {
+        // Values after RESET, see datasheet table 3
+        ftb8md_shadow_t *shadow = &panel->shadow;
+        memset(shadow->dcram, 0x20, sizeof(shadow->dcram));
+        shadow->dcram_valid = FTB8MD_DIGIT_MASK;
+        shadow->adram_valid = FTB8MD_DIGIT_MASK;
+        shadow->cgram_valid = 0xFF;
+        shadow->dimming = 0;
+        shadow->power_on = false;
+        shadow->standby = false;
+        shadow->ctrl_valid = FTB8MD_CTRL_DIMMING | FTB8MD_CTRL_POWER | FTB8MD_CTRL_STANDBY;
+
+        panel->wire_valid = shadow->ctrl_valid;
+        panel->wire_dimming = 0;
+        panel->wire_power_on = false;
+        panel->wire_standby = false;
+    }
+
+    return panel;
+}
+
+void ftb8md_panel_free(ftb8md_panel_t *panel)
+{
+    if (panel->ctrl_timer != NULL)
+    {
+        esp_timer_stop(panel->ctrl_timer);
+        esp_timer_delete(panel->ctrl_timer);
+        panel->ctrl_timer = NULL;
+    }
+    if (panel->scrub_timer != NULL)
+    {
+        esp_timer_stop(panel->scrub_timer);
+        esp_timer_delete(panel->scrub_timer);
+        panel->scrub_timer = NULL;
+    }
+    if (panel->dither_timer != NULL)
+    {
+        esp_timer_stop(panel->dither_timer);
+        esp_timer_delete(panel->dither_timer);
+        panel->dither_timer = NULL;
+    }
+
+    vSemaphoreDelete(panel->lock);
+
+    portENTER_CRITICAL(&s_panels_lock);
+    panel->spi = NULL;
+    portEXIT_CRITICAL(&s_panels_lock);
+}
+
+/**
+ * @brief Record the effect of a transmitted command in the shadow.
+ *
+ * DCRAM, ADRAM and CGRAM addresses auto-increment, so a single command
+ * may update several consecutive entries.
+ *
+ * @param shadow Shadow to update
+ * @param cmd Encoded command
  * @param len Length of the command in bytes
+ */
+static void ftb8md_shadow_apply(ftb8md_shadow_t *shadow, const uint8_t *cmd, size_t len)
+{
+    unsigned addr = cmd[0] & 0x1F;
+
+    switch (cmd[0] >> 5)
+    {
+    case CMD_PREFIX_DCRAM:
+        for (size_t i = 1; i < len && addr < FTB8MD_NUM_DIGITS; i++, addr++)
+        {
+            shadow->dcram[addr] = cmd[i];
+            shadow->dcram_valid |= 1u << addr;
+        }
+        break;
+
+    case CMD_PREFIX_ADRAM:
+        for (size_t i = 1; i < len && addr < FTB8MD_NUM_DIGITS; i++, addr++)
+        {
+            shadow->adram[addr] = cmd[i] & 0x0F;
+            shadow->adram_valid |= 1u << addr;
+        }
+        break;
+
+    case CMD_PREFIX_CGRAM:
+        addr &= 0x07;
+        for (size_t i = 1; i + FTB8MD_GLYPH_COLS <= len && addr < FTB8MD_NUM_CGRAM; i += FTB8MD_GLYPH_COLS, addr++)
+        {
+            memcpy(shadow->cgram[addr], &cmd[i], FTB8MD_GLYPH_COLS);
+            shadow->cgram_valid |= 1u << addr;
+        }
+        break;
+
+    default:
+        if ((cmd[0] & 0xFC) == FTB8MD_CMD_DIMMING && len >= 2)
+        {
+            shadow->dimming = cmd[1];
+            shadow->ctrl_valid |= FTB8MD_CTRL_DIMMING;
+        }
+        else if ((cmd[0] & 0xFC) == FTB8MD_CMD_DISPLAY_ON)
+        {
+            shadow->power_on = (cmd[0] & 0x02) == 0;
+            shadow->ctrl_valid |= FTB8MD_CTRL_POWER;
+        }
+        else if ((cmd[0] & 0xFC) == (FTB8MD_CMD_MODE_NORMAL & 0xFC))
+        {
+            shadow->standby = (cmd[0] & 0x01) != 0;
+            shadow->ctrl_valid |= FTB8MD_CTRL_STANDBY;
+        }
+        break;
+    }
+}
+
+esp_err_t ftb8md_panel_transmit(ftb8md_panel_t *panel, const uint8_t *cmd, size_t len)
+{
+    esp_err_t ret = FTB8MD_PAR_ENABLED && panel->par != NULL ? ftb8md_par_transmit(panel, cmd, len)
+                                                             : ftb8md_bus_transmit(panel->host, panel->spi, cmd, len);
+    if (ret == ESP_OK)
+    {
+        ftb8md_panel_wire_update(panel, cmd, len);
+        ftb8md_trace_emit(panel, FTB8MD_TRACE_TX, cmd, len);
+    }
+
+    return ret;
+}
+
+void ftb8md_panel_wire_update(ftb8md_panel_t *panel, const uint8_t *cmd, size_t len)
+{
+    if ((cmd[0] >> 5) != (FTB8MD_CMD_DIMMING >> 5))
+    {
+        return;
+    }
+
+    // Remember what the control registers really hold, for ftb8md_panel_ctrl_redundant()
+    portENTER_CRITICAL(&panel->lost_lock);
+    if ((cmd[0] & 0xFC) == FTB8MD_CMD_DIMMING && len >= 2)
+    {
+        panel->wire_dimming = cmd[1];
+        panel->wire_valid |= FTB8MD_CTRL_DIMMING;
+    }
+    else if ((cmd[0] & 0xFC) == FTB8MD_CMD_DISPLAY_ON)
+    {
+        panel->wire_power_on = (cmd[0] & 0x02) == 0;
+        panel->wire_valid |= FTB8MD_CTRL_POWER;
+    }
+    else if ((cmd[0] & 0xFC) == (FTB8MD_CMD_MODE_NORMAL & 0xFC))
+    {
+        panel->wire_standby = (cmd[0] & 0x01) != 0;
+        panel->wire_valid |= FTB8MD_CTRL_STANDBY;
+    }
+    portEXIT_CRITICAL(&panel->lost_lock);
+}
+
+bool ftb8md_panel_ctrl_redundant(ftb8md_panel_t *panel, const uint8_t *cmd, size_t len)
+{
+    bool redundant = false;
+
+    portENTER_CRITICAL(&panel->lost_lock);
+    if ((cmd[0] & 0xFC) == FTB8MD_CMD_DIMMING && len >= 2)
+    {
+        redundant = (panel->wire_valid & FTB8MD_CTRL_DIMMING) && panel->wire_dimming == cmd[1];
+    }
+    else if ((cmd[0] & 0xFC) == FTB8MD_CMD_DISPLAY_ON)
+    {
+        redundant = (panel->wire_valid & FTB8MD_CTRL_POWER) && panel->wire_power_on == ((cmd[0] & 0x02) == 0);
+    }
+    else if ((cmd[0] & 0xFC) == (FTB8MD_CMD_MODE_NORMAL & 0xFC))
+    {
+        redundant = (panel->wire_valid & FTB8MD_CTRL_STANDBY) && panel->wire_standby == ((cmd[0] & 0x01) != 0);
+    }
+    portEXIT_CRITICAL(&panel->lost_lock);
+
+    return redundant;
+}
+
+void ftb8md_panel_mark_lost(ftb8md_panel_t *panel, const uint8_t *cmd, size_t len)
+{
+    unsigned addr = cmd[0] & 0x1F;
+
+    portENTER_CRITICAL(&panel->lost_lock);
+    switch (cmd[0] >> 5)
+    {
+    case CMD_PREFIX_DCRAM:
+        for (size_t i = 1; i < len && addr < FTB8MD_NUM_DIGITS; i++, addr++)
+        {
+            panel->lost_dcram |= 1u << addr;
+        }
+        break;
+
+    case CMD_PREFIX_ADRAM:
+        for (size_t i = 1; i < len && addr < FTB8MD_NUM_DIGITS; i++, addr++)
+        {
+            panel->lost_adram |= 1u << addr;
+        }
+        break;
+
+    case CMD_PREFIX_CGRAM:
+        addr &= 0x07;
+        for (size_t i = 1; i + FTB8MD_GLYPH_COLS <= len && addr < FTB8MD_NUM_CGRAM; i += FTB8MD_GLYPH_COLS, addr++)
+        {
+            panel->lost_cgram |= 1u << addr;
+        }
+        break;
+
+    default:
+        if ((cmd[0] & 0xFC) == FTB8MD_CMD_DIMMING)
+        {
+            panel->lost_ctrl |= FTB8MD_CTRL_DIMMING;
+        }
+        else if ((cmd[0] & 0xFC) == FTB8MD_CMD_DISPLAY_ON)
+        {
+            panel->lost_ctrl |= FTB8MD_CTRL_POWER;
+        }
+        else if ((cmd[0] & 0xFC) == (FTB8MD_CMD_MODE_NORMAL & 0xFC))
+        {
+            panel->lost_ctrl |= FTB8MD_CTRL_STANDBY;
+        }
+        break;
+    }
+    portEXIT_CRITICAL(&panel->lost_lock);
+}
+
+esp_err_t ftb8md_panel_send(ftb8md_panel_t *panel, const uint8_t *cmd, size_t len)
+{
+    FTB8MD_CHECK_ARG(panel != NULL && cmd != NULL && len != 0);
+
+    esp_err_t ret;
+
+    ftb8md_panel_lock(panel);
+    ftb8md_trace_emit(panel, FTB8MD_TRACE_CALL, cmd, len);
+    if (FTB8MD_PAR_ENABLED && panel->par != NULL && ftb8md_par_defer(panel, cmd, len))
+    {
+        // Sent together with the other panels of the group when the frame ends
+        ret = ESP_OK;
+    }
+    else if (ftb8md_sched_running())
+    {
+        // The shadow describes the panel once the queue has drained
+        ret = ftb8md_sched_submit(panel, cmd, len, FTB8MD_PRIO_AUTO, false);
+    }
+    else
+    {
+        ret = ftb8md_panel_transmit(panel, cmd, len);
+    }
+    if (ret == ESP_OK)
+    {
+        ftb8md_shadow_apply(&panel->shadow, cmd, len);
+#if FTB8MD_COST_ENABLED
+        if (panel->cost_active)
+        {
+            ftb8md_cost_add(&panel->cost, &panel->cost_model, len);
+        }
+#endif
+
+        ftb8md_panel_dither_unblank(panel, cmd, len);
+    }
+    ftb8md_panel_unlock(panel);
+
+    return ret;
+}
+
+esp_err_t ftb8md_panel_write_diff(ftb8md_panel_t *panel, uint8_t prefix, const uint8_t *data, uint8_t mask)
+{
+    FTB8MD_CHECK_ARG(panel != NULL && data != NULL && (prefix == CMD_PREFIX_DCRAM || prefix == CMD_PREFIX_ADRAM));
+
+    esp_err_t ret = ESP_OK;
+
+    ftb8md_panel_lock(panel);
+
+    const uint8_t *shadow = prefix == CMD_PREFIX_DCRAM ? panel->shadow.dcram : panel->shadow.adram;
+    uint8_t valid = prefix == CMD_PREFIX_DCRAM ? panel->shadow.dcram_valid : panel->shadow.adram_valid;
+
+    uint8_t changed = 0;
+    for (int d = 0; d < FTB8MD_NUM_DIGITS; d++)
+    {
+        if ((mask & (1u << d)) && (!(valid & (1u << d)) || shadow[d] != data[d]))
+        {
+            changed |= 1u << d;
+        }
+    }
+
+    int d = 0;
+    while (ret == ESP_OK && d < FTB8MD_NUM_DIGITS)
+    {
+        if (!(changed & (1u << d)))
+        {
+            d++;
+            continue;
+        }
+
+        // Extend the run while the next changed digit is at most one digit away
+        int end = d;
+        while (end + 1 < FTB8MD_NUM_DIGITS &&
+               ((changed & (1u << (end + 1))) ||
+                (end + 2 < FTB8MD_NUM_DIGITS && (mask & (1u << (end + 1))) && (changed & (1u << (end + 2))))))
+        {
+            end++;
+        }
+
+        uint8_t cmd[1 + FTB8MD_NUM_DIGITS];
+        cmd[0] = (prefix << 5) | d;
+        memcpy(&cmd[1], &data[d], end - d + 1);
+        ret = ftb8md_panel_send(panel, cmd, 1 + end - d + 1);
+        d = end + 1;
+    }
+
+    ftb8md_panel_unlock(panel);
+
+    return ret;
+}
+
+/**
+ * @brief Send the control registers that were set since the last flush.
+ *
+ * Each register is sent once with its latest value, and not at all if the
+ * panel already holds that value. Must be called with the panel lock held.
+ *
+ * @param panel Panel state
  * @return ESP_OK on success, or an error code on failure
  */
-static esp_err_t ftb8md_send_command(spi_device_handle_t handle, const uint8_t *cmd, size_t len)
+static esp_err_t ftb8md_ctrl_flush(ftb8md_panel_t *panel)
 {
-    if (handle == NULL || cmd == NULL || len == 0)
+    const ftb8md_shadow_t *shadow = &panel->shadow;
+    esp_err_t ret = ESP_OK;
+
+    for (uint8_t reg = FTB8MD_CTRL_DIMMING; reg <= FTB8MD_CTRL_STANDBY; reg <<= 1)
     {
-        return ESP_ERR_INVALID_ARG;
+        if (!(panel->ctrl_pending & reg))
+        {
+            continue;
+        }
+
+        const uint8_t dimming[2] = {FTB8MD_CMD_DIMMING, shadow->dimming};
+        const uint8_t *cmd = dimming;
+        if (reg == FTB8MD_CTRL_POWER)
+        {
+            cmd = ftb8md_cmd_power[shadow->power_on];
+        }
+        else if (reg == FTB8MD_CTRL_STANDBY)
+        {
+            cmd = ftb8md_cmd_standby[shadow->standby];
+        }
+
+        // Queued commands are checked by the scheduler when they reach the wire
+        if (ftb8md_sched_running() || !ftb8md_panel_ctrl_redundant(panel, cmd, 2))
+        {
+            esp_err_t err = ftb8md_panel_send(panel, cmd, 2);
+            if (err != ESP_OK)
+            {
+                // Keep the register pending so the next flush retries it
+                ret = err;
+                continue;
+            }
+        }
+        panel->ctrl_pending &= ~reg;
     }
 
-    spi_transaction_t trans = {
-        .length = len * 8,
-        .tx_buffer = cmd,
-    };
+    panel->ctrl_last_us = esp_timer_get_time();
+
+    return ret;
+}
+
+static void ftb8md_ctrl_timer_cb(void *arg)
+{
+    ftb8md_panel_t *panel = arg;
+
+    // Runs on the esp_timer task, which must not wait for a writer
+    if (!ftb8md_panel_trylock(panel, 0))
+    {
+        esp_timer_start_once(panel->ctrl_timer, FTB8MD_LOCK_RETRY_US);
+        return;
+    }
+
+    esp_err_t ret = ftb8md_ctrl_flush(panel);
+    if (ret != ESP_OK)
+    {
+        // Registers whose send failed stay pending; try them again after a flush interval
+        esp_timer_start_once(panel->ctrl_timer, panel->ctrl_interval_us);
+    }
+    ftb8md_panel_unlock(panel);
 
-    return spi_device_transmit(handle, &trans);
+    if (ret != ESP_OK && ret != ESP_ERR_TIMEOUT)
+    {
+        ESP_LOGW(TAG, "Failed to send control registers: %s", esp_err_to_name(ret));
+    }
+}
+
+/**
+ * @brief Set a control register; the command is sent now or once the flush interval has passed.
+ *
+ * @param handle SPI device handle
+ * @param reg FTB8MD_CTRL_* register
+ * @param value New register value
+ * @return ESP_OK on success, or an error code on failure
+ */
+static esp_err_t ftb8md_ctrl_set(spi_device_handle_t handle, uint8_t reg, uint8_t value)
+{
+    ftb8md_panel_t *panel = ftb8md_panel_get(handle);
+    FTB8MD_CHECK_ARG(panel != NULL);
+
+    esp_err_t ret = ESP_OK;
+    ftb8md_shadow_t *shadow = &panel->shadow;
+
+    ftb8md_panel_lock(panel);
+
+    if (reg == FTB8MD_CTRL_DIMMING)
+    {
+        shadow->dimming = value;
+    }
+    else if (reg == FTB8MD_CTRL_POWER)
+    {
+        shadow->power_on = value != 0;
+    }
+    else
+    {
+        shadow->standby = value != 0;
+    }
+    shadow->ctrl_valid |= reg;
+    panel->ctrl_pending |= reg;
+
+    int64_t wait = panel->ctrl_last_us + panel->ctrl_interval_us - esp_timer_get_time();
+    if (panel->ctrl_interval_us == 0 || panel->ctrl_timer == NULL || wait <= 0)
+    {
+        ret = ftb8md_ctrl_flush(panel);
+    }
+    else if (!esp_timer_is_active(panel->ctrl_timer))
+    {
+        esp_timer_start_once(panel->ctrl_timer, wait);
+    }
+
+    ftb8md_panel_unlock(panel);
+
+    return ret;
+}
+
+/**
+ * @brief Send a command to the VFD display.
+ *
+ * @param handle SPI device handle
+ * @param cmd Pointer to the command data
+ * @param len Length of the command in bytes
+ * @return ESP_OK on success, or an error code on failure
+ */
+static esp_err_t ftb8md_send_command(spi_device_handle_t handle, const uint8_t *cmd, size_t len)
+{
+    return ftb8md_panel_send(ftb8md_panel_get(handle), cmd, len);
 }
 
 spi_device_handle_t ftb8md_device_register(spi_host_device_t host_id, int cs_pin, int reset_pin)
@@ -101,11 +631,15 @@ spi_device_handle_t ftb8md_device_register(spi_host_device_t host_id, int cs_pin
         return NULL;
     }
 
+    if (ftb8md_panel_alloc(handle, host_id, reset_pin >= 0) == NULL)
+    {
+        ESP_LOGE(TAG, "Too many panels registered (max %d)", FTB8MD_MAX_PANELS);
+        spi_bus_remove_device(handle);
+        return NULL;
+    }
+
     // Initialize display: set 8 digits
-    DisplayCommand cmd = {0};
-    cmd.ctrl.prefix = CMD_DIGIT_SET;
-    cmd.ctrl.arg = FTB8MD_NUM_DIGITS - 1; // 0-7 means 1-8 digits
-    ret = ftb8md_send_command(handle, cmd.raw, 2);
+    ret = ftb8md_send_command(handle, s_cmd_digit_set, sizeof(s_cmd_digit_set));
     if (ret != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to set digit count: %s", esp_err_to_name(ret));
@@ -115,8 +649,7 @@ spi_device_handle_t ftb8md_device_register(spi_host_device_t host_id, int cs_pin
     ftb8md_set_dimming(handle, FTB8MD_MAX_DIMMING);
 
     // Turn on display with full brightness
-    cmd.ctrl.prefix = CMD_DISPLAY_ON;
-    ret = ftb8md_send_command(handle, cmd.raw, 2);
+    ret = ftb8md_send_command(handle, ftb8md_cmd_power[true], 2);
     if (ret != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to turn on display: %s", esp_err_to_name(ret));
@@ -126,21 +659,33 @@ spi_device_handle_t ftb8md_device_register(spi_host_device_t host_id, int cs_pin
     return handle;
 }
 
-esp_err_t ftb8md_show_string(spi_device_handle_t handle, int digit, const char *str)
+esp_err_t ftb8md_device_unregister(spi_device_handle_t handle)
 {
-    if (handle == NULL || str == NULL)
+    ftb8md_panel_t *panel = ftb8md_panel_get(handle);
+    if (panel == NULL || panel->par != NULL)
     {
+        // Panels of a parallel group are released by ftb8md_par_delete()
         return ESP_ERR_INVALID_ARG;
     }
 
-    if (digit < 0 || digit >= FTB8MD_NUM_DIGITS)
-    {
-        return ESP_ERR_INVALID_ARG;
-    }
+#if FTB8MD_SCHED_ENABLED
+    // Queued commands still refer to the panel
+    ftb8md_sched_flush(portMAX_DELAY);
+#endif
+
+    ftb8md_panel_free(panel);
+
+    return spi_bus_remove_device(handle);
+}
+
+esp_err_t ftb8md_show_string(spi_device_handle_t handle, int digit, const char *str)
+{
+    FTB8MD_CHECK_ARG(handle != NULL && str != NULL);
+
+    FTB8MD_CHECK_ARG(digit >= 0 && digit < FTB8MD_NUM_DIGITS);
 
-    DisplayCommand cmd = {0};
-    cmd.dcram_write.byte1.prefix = CMD_PREFIX_DCRAM;
-    cmd.dcram_write.byte1.digit = digit;
+    uint8_t cmd[1 + FTB8MD_NUM_DIGITS];
+    cmd[0] = FTB8MD_CMD_DCRAM(digit);
 
     size_t max_chars = FTB8MD_NUM_DIGITS - digit;
     size_t str_len = strlen(str);
@@ -149,112 +694,118 @@ esp_err_t ftb8md_show_string(spi_device_handle_t handle, int digit, const char *
     for (size_t i = 0; i < chars_to_write; i++)
     {
         // Direct ASCII mapping (display typically uses ASCII-compatible encoding)
-        cmd.dcram_write.chr[i] = (uint8_t)str[i];
+        cmd[1 + i] = (uint8_t)str[i];
     }
 
     // Command byte + character data
-    return ftb8md_send_command(handle, cmd.raw, 1 + chars_to_write);
+    return ftb8md_send_command(handle, cmd, 1 + chars_to_write);
 }
 
 esp_err_t ftb8md_set_dimming(spi_device_handle_t handle, uint8_t level)
 {
-    if (handle == NULL)
-    {
-        return ESP_ERR_INVALID_ARG;
-    }
-
-    DisplayCommand cmd = {0};
-    cmd.ctrl.prefix = CMD_DIMMING;
-    cmd.ctrl.arg = level > FTB8MD_MAX_DIMMING ? FTB8MD_MAX_DIMMING : level;
+    FTB8MD_CHECK_ARG(handle != NULL);
 
-    return ftb8md_send_command(handle, cmd.raw, 2);
+    return ftb8md_ctrl_set(handle, FTB8MD_CTRL_DIMMING, level > FTB8MD_MAX_DIMMING ? FTB8MD_MAX_DIMMING : level);
 }
 
 esp_err_t ftb8md_enter_standby(spi_device_handle_t handle, bool standby)
 {
-    if (handle == NULL)
-    {
-        return ESP_ERR_INVALID_ARG;
-    }
+    FTB8MD_CHECK_ARG(handle != NULL);
 
-    DisplayCommand cmd = {0};
-    cmd.ctrl.prefix = standby ? CMD_MODE_STANDBY : CMD_MODE_NORMAL;
-
-    return ftb8md_send_command(handle, cmd.raw, 2);
+    return ftb8md_ctrl_set(handle, FTB8MD_CTRL_STANDBY, standby);
 }
 
 esp_err_t ftb8md_set_display_power(spi_device_handle_t handle, bool on)
 {
-    if (handle == NULL)
-    {
-        return ESP_ERR_INVALID_ARG;
-    }
-
-    DisplayCommand cmd = {0};
-    cmd.ctrl.prefix = on ? CMD_DISPLAY_ON : CMD_DISPLAY_OFF;
+    FTB8MD_CHECK_ARG(handle != NULL);
 
-    return ftb8md_send_command(handle, cmd.raw, 2);
+    return ftb8md_ctrl_set(handle, FTB8MD_CTRL_POWER, on);
 }
 
-esp_err_t ftb8md_set_dot(spi_device_handle_t handle, int digit, bool dot_on)
+esp_err_t ftb8md_set_ctrl_interval(spi_device_handle_t handle, uint32_t interval_ms)
 {
-    if (handle == NULL)
+    ftb8md_panel_t *panel = ftb8md_panel_get(handle);
+    FTB8MD_CHECK_ARG(panel != NULL);
+
+    esp_err_t ret = ESP_OK;
+
+    ftb8md_panel_lock(panel);
+
+    if (interval_ms != 0 && panel->ctrl_timer == NULL)
     {
-        return ESP_ERR_INVALID_ARG;
+        esp_timer_create_args_t args = {
+            .callback = ftb8md_ctrl_timer_cb,
+            .arg = panel,
+            .name = "ftb8md_ctrl",
+        };
+        ret = esp_timer_create(&args, &panel->ctrl_timer);
     }
 
-    if (digit < 0 || digit >= FTB8MD_NUM_DIGITS)
+    if (ret == ESP_OK)
     {
-        return ESP_ERR_INVALID_ARG;
+        panel->ctrl_interval_us = interval_ms * 1000;
+        if (interval_ms == 0)
+        {
+            ret = ftb8md_ctrl_flush(panel);
+        }
     }
 
-    DisplayCommand cmd = {0};
-    cmd.adram_write.byte1.reserved = CMD_PREFIX_ADRAM;
-    cmd.adram_write.byte1.digit = digit;
-    cmd.adram_write.byte2.pin = dot_on ? 0x01 : 0x00; // E0 controls decimal point
+    ftb8md_panel_unlock(panel);
 
-    return ftb8md_send_command(handle, cmd.raw, 2);
+    return ret;
 }
 
-esp_err_t ftb8md_set_segment(spi_device_handle_t handle, int digit, uint8_t segments)
+esp_err_t ftb8md_flush_ctrl(spi_device_handle_t handle)
 {
-    if (handle == NULL)
-    {
-        return ESP_ERR_INVALID_ARG;
-    }
+    ftb8md_panel_t *panel = ftb8md_panel_get(handle);
+    FTB8MD_CHECK_ARG(panel != NULL);
 
-    if (digit < 0 || digit >= FTB8MD_NUM_DIGITS)
+    ftb8md_panel_lock(panel);
+    if (panel->ctrl_timer != NULL)
     {
-        return ESP_ERR_INVALID_ARG;
+        esp_timer_stop(panel->ctrl_timer);
     }
+    esp_err_t ret = ftb8md_ctrl_flush(panel);
+    ftb8md_panel_unlock(panel);
+
+    return ret;
+}
+
+esp_err_t ftb8md_set_dot(spi_device_handle_t handle, int digit, bool dot_on)
+{
+    FTB8MD_CHECK_ARG(handle != NULL);
+
+    FTB8MD_CHECK_ARG(digit >= 0 && digit < FTB8MD_NUM_DIGITS);
+
+    const uint8_t cmd[2] = {FTB8MD_CMD_ADRAM(digit), dot_on ? FTB8MD_ADRAM_DOT : 0x00};
+
+    return ftb8md_send_command(handle, cmd, sizeof(cmd));
+}
+
+esp_err_t ftb8md_set_segment(spi_device_handle_t handle, int digit, uint8_t segments)
+{
+    FTB8MD_CHECK_ARG(handle != NULL);
+
+    FTB8MD_CHECK_ARG(digit >= 0 && digit < FTB8MD_NUM_DIGITS);
 
     // Write directly to DCRAM with raw segment data
-    DisplayCommand cmd = {0};
-    cmd.dcram_write.byte1.prefix = CMD_PREFIX_DCRAM;
-    cmd.dcram_write.byte1.digit = digit;
-    cmd.dcram_write.chr[0] = segments;
+    const uint8_t cmd[2] = {FTB8MD_CMD_DCRAM(digit), segments};
 
-    return ftb8md_send_command(handle, cmd.raw, 2);
+    return ftb8md_send_command(handle, cmd, sizeof(cmd));
 }
 
 esp_err_t ftb8md_clear_display(spi_device_handle_t handle)
 {
-    if (handle == NULL)
-    {
-        return ESP_ERR_INVALID_ARG;
-    }
+    FTB8MD_CHECK_ARG(handle != NULL);
 
     esp_err_t ret;
 
-    // Clear all digits by writing spaces
-    DisplayCommand cmd = {0};
-    cmd.dcram_write.byte1.prefix = CMD_PREFIX_DCRAM;
-    cmd.dcram_write.byte1.digit = 0;
+    // Clear all digits by writing spaces (0x20)
+    uint8_t blank[1 + FTB8MD_NUM_DIGITS];
+    blank[0] = FTB8MD_CMD_DCRAM(0);
+    memset(&blank[1], 0x20, FTB8MD_NUM_DIGITS);
 
-    // Fill with space characters (0x20)
-    memset(cmd.dcram_write.chr, 0x20, FTB8MD_NUM_DIGITS);
-
-    ret = ftb8md_send_command(handle, cmd.raw, 1 + FTB8MD_NUM_DIGITS);
+    ret = ftb8md_send_command(handle, blank, sizeof(blank));
     if (ret != ESP_OK)
     {
         return ret;
@@ -275,47 +826,65 @@ esp_err_t ftb8md_clear_display(spi_device_handle_t handle)
 
 esp_err_t ftb8md_write_custom_char(spi_device_handle_t handle, int char_index, const uint8_t grid_data[5])
 {
-    if (handle == NULL || grid_data == NULL)
-    {
-        return ESP_ERR_INVALID_ARG;
-    }
-
-    if (char_index < 0 || char_index > 7)
-    {
-        return ESP_ERR_INVALID_ARG;
-    }
+    FTB8MD_CHECK_ARG(handle != NULL && grid_data != NULL);
 
-    DisplayCommand cmd = {0};
-    cmd.cgram_write.byte1.prefix = CMD_PREFIX_CGRAM;
-    cmd.cgram_write.byte1.addr = char_index;
+    FTB8MD_CHECK_ARG(char_index >= 0 && char_index < FTB8MD_NUM_CGRAM);
 
-    memcpy(cmd.cgram_write.data, grid_data, 5);
+    uint8_t cmd[1 + FTB8MD_GLYPH_COLS];
+    cmd[0] = FTB8MD_CMD_CGRAM(char_index);
+    memcpy(&cmd[1], grid_data, FTB8MD_GLYPH_COLS);
 
-    return ftb8md_send_command(handle, cmd.raw, 6);
+    return ftb8md_send_command(handle, cmd, sizeof(cmd));
 }
 
 esp_err_t ftb8md_set_addressed_char(spi_device_handle_t handle, int digit, int char_index)
 {
-    if (handle == NULL)
-    {
-        return ESP_ERR_INVALID_ARG;
-    }
+    FTB8MD_CHECK_ARG(handle != NULL);
 
-    if (digit < 0 || digit >= FTB8MD_NUM_DIGITS)
-    {
-        return ESP_ERR_INVALID_ARG;
-    }
+    FTB8MD_CHECK_ARG(digit >= 0 && digit < FTB8MD_NUM_DIGITS);
 
-    if (char_index < 0 || char_index > 7)
-    {
-        return ESP_ERR_INVALID_ARG;
-    }
+    FTB8MD_CHECK_ARG(char_index >= 0 && char_index < FTB8MD_NUM_CGRAM);
 
-    DisplayCommand cmd = {0};
-    cmd.dcram_write.byte1.prefix = CMD_PREFIX_DCRAM;
-    cmd.dcram_write.byte1.digit = digit;
     // CGRAM characters are addressed at 0x00-0x07
-    cmd.dcram_write.chr[0] = (uint8_t)char_index;
+    const uint8_t cmd[2] = {FTB8MD_CMD_DCRAM(digit), (uint8_t)char_index};
+
+    return ftb8md_send_command(handle, cmd, sizeof(cmd));
+}
+
+esp_err_t ftb8md_write_dcram(spi_device_handle_t handle, int digit, const uint8_t *codes, size_t count)
+{
+    FTB8MD_CHECK_ARG(handle != NULL && codes != NULL);
+
+    FTB8MD_CHECK_ARG(digit >= 0 && digit < FTB8MD_NUM_DIGITS && count != 0 &&
+                     count <= (size_t)(FTB8MD_NUM_DIGITS - digit));
+
+    uint8_t cmd[1 + FTB8MD_NUM_DIGITS];
+    cmd[0] = FTB8MD_CMD_DCRAM(digit);
+    memcpy(&cmd[1], codes, count);
+
+    return ftb8md_send_command(handle, cmd, 1 + count);
+}
+
+esp_err_t ftb8md_write_raw(spi_device_handle_t handle, const uint8_t *cmd, size_t len)
+{
+    FTB8MD_CHECK_ARG(handle != NULL && cmd != NULL && len != 0 && len <= FTB8MD_CMD_MAX_LEN);
+
+    unsigned addr = cmd[0] & 0x1F;
+    switch (cmd[0] >> 5)
+    {
+    case CMD_PREFIX_DCRAM:
+    case CMD_PREFIX_ADRAM:
+        FTB8MD_CHECK_ARG(len >= 2 && addr + (len - 1) <= FTB8MD_NUM_DIGITS);
+        break;
+
+    case CMD_PREFIX_CGRAM:
+        FTB8MD_CHECK_ARG(len >= 2 && (len - 1) % FTB8MD_GLYPH_COLS == 0 &&
+                         (addr & 0x07) + (len - 1) / FTB8MD_GLYPH_COLS <= FTB8MD_NUM_CGRAM);
+        break;
+
+    default:
+        break;
+    }
 
-    return ftb8md_send_command(handle, cmd.raw, 2);
+    return ftb8md_send_command(handle, cmd, len);
 }
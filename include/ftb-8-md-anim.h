@@ -0,0 +1,188 @@
+/**
+ * @file ftb-8-md-anim.h
+ * @brief Timeline animation player for flash-resident animation files.
+ *
+ * Animations are compiled offline by tools/ftb8md_animc.py into a compact
+ * binary timeline and played in place, either from a memory-mapped data
+ * partition or from an array linked into the application. The player runs
+ * from an esp_timer, so no task is tied up, and it allocates nothing while
+ * playing.
+ *
+ * File format (all values little endian):
+ *
+ * | Offset | Size | Field                                          |
+ * |--------|------|------------------------------------------------|
+ * | 0      | 4    | Magic "FTBA"                                   |
+ * | 4      | 1    | Format version (FTB8MD_ANIM_VERSION)           |
+ * | 5      | 1    | Flags (FTB8MD_ANIM_FLAG_*)                     |
+ * | 6      | 2    | Number of frames (informational)               |
+ * | 8      | 4    | Length of the record stream in bytes           |
+ * | 12     | ...  | Record stream                                  |
+ *
+ * Each record starts with an opcode byte:
+ *
+ * | Opcode                 | Payload                                          |
+ * |------------------------|--------------------------------------------------|
+ * | FTB8MD_ANIM_OP_END     | none; end of the timeline                        |
+ * | FTB8MD_ANIM_OP_WAIT    | u16 milliseconds; ends a frame and holds it      |
+ * | FTB8MD_ANIM_OP_DCRAM   | u8 first digit, u8 count, count character codes  |
+ * | FTB8MD_ANIM_OP_ADRAM   | u8 first digit, u8 count, count ADRAM values     |
+ * | FTB8MD_ANIM_OP_CGRAM   | u8 first character, u8 count, count * 5 columns  |
+ * | FTB8MD_ANIM_OP_DIMMING | u8 level (0-240)                                 |
+ *
+ * Records between two WAITs form a frame and are applied together: CGRAM
+ * first, then dimming, then only the digits whose DCRAM or ADRAM value
+ * differs from what the panel shows.
+ */
+
+#pragma once
+
+#include "ftb-8-md.h"
+#include "esp_timer.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Animation file format version */
+#define FTB8MD_ANIM_VERSION 1
+
+/** @brief Size of the file header */
+#define FTB8MD_ANIM_HEADER_LEN 12
+
+/** @brief Flag: restart from the first frame at the end of the timeline */
+#define FTB8MD_ANIM_FLAG_LOOP (1 << 0)
+
+/* Record opcodes */
+#define FTB8MD_ANIM_OP_END 0x00     /**< End of the timeline */
+#define FTB8MD_ANIM_OP_WAIT 0x01    /**< End of frame, hold for a time */
+#define FTB8MD_ANIM_OP_DCRAM 0x02   /**< Character codes of consecutive digits */
+#define FTB8MD_ANIM_OP_ADRAM 0x03   /**< ADRAM values of consecutive digits */
+#define FTB8MD_ANIM_OP_CGRAM 0x04   /**< Glyphs of consecutive CGRAM characters */
+#define FTB8MD_ANIM_OP_DIMMING 0x05 /**< Dimming level */
+
+/**
+ * @brief Animation player.
+ *
+ * All fields are private to the player.
+ */
+typedef struct
+{
+    spi_device_handle_t handle; /**< Panel the animation is played on */
+    esp_timer_handle_t timer;   /**< Frame timer */
+    const uint8_t *data;        /**< Animation file */
+    size_t len;                 /**< Length of the animation file */
+    size_t pos;                 /**< Offset of the next record */
+    int64_t due_us;             /**< Time the next frame is due */
+    bool playing;               /**< Timeline is running */
+    bool stopping;              /**< ftb8md_anim_player_deinit() has started; the timer is not re-armed */
+} ftb8md_anim_player_t;
+
+/**
+ * @brief Animation file mapped from a data partition.
+ */
+typedef struct
+{
+    const uint8_t *data; /**< Animation file */
+    size_t len;          /**< Length of the animation file */
+    uint32_t mmap;       /**< esp_partition_mmap_handle_t of the mapping */
+} ftb8md_anim_mapping_t;
+
+/**
+ * @brief Check an animation file.
+ *
+ * ftb8md_anim_play() checks the file once, so the player can then read it
+ * without bounds checks.
+ *
+ * @param data Animation file.
+ * @param len Length of the buffer holding the file.
+ * @return
+ *      - ESP_OK: Valid file
+ *      - ESP_ERR_INVALID_ARG: NULL data, bad magic, or a looping timeline without any hold time
+ *      - ESP_ERR_INVALID_VERSION: Unsupported format version
+ *      - ESP_ERR_INVALID_SIZE: Truncated file or record out of range
+ */
+esp_err_t ftb8md_anim_validate(const uint8_t *data, size_t len);
+
+/**
+ * @brief Initialise an animation player.
+ *
+ * @param player Player to initialise.
+ * @param handle The SPI device handle obtained from ftb8md_device_register().
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL player or unregistered handle
+ *      - ESP_ERR_NO_MEM: Timer could not be created
+ */
+esp_err_t ftb8md_anim_player_init(ftb8md_anim_player_t *player, spi_device_handle_t handle);
+
+/**
+ * @brief Stop playback and release the player's timer.
+ *
+ * @param player Player.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL player
+ *      - ESP_ERR_INVALID_STATE: The timer could not be deleted; call again
+ */
+esp_err_t ftb8md_anim_player_deinit(ftb8md_anim_player_t *player);
+
+/**
+ * @brief Start playing an animation from its first frame.
+ *
+ * A running animation is replaced. The file is read in place and must stay
+ * mapped until playback ends.
+ *
+ * @param player Player.
+ * @param data Animation file.
+ * @param len Length of the buffer holding the file.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG, ESP_ERR_INVALID_VERSION, ESP_ERR_INVALID_SIZE: See ftb8md_anim_validate()
+ */
+esp_err_t ftb8md_anim_play(ftb8md_anim_player_t *player, const uint8_t *data, size_t len);
+
+/**
+ * @brief Stop playback; the panel keeps showing the current frame.
+ *
+ * @param player Player.
+ */
+void ftb8md_anim_stop(ftb8md_anim_player_t *player);
+
+/**
+ * @brief Check whether an animation is playing.
+ *
+ * A timeline without FTB8MD_ANIM_FLAG_LOOP stops by itself after its last frame.
+ *
+ * @param player Player.
+ * @return true while playing
+ */
+bool ftb8md_anim_is_playing(const ftb8md_anim_player_t *player);
+
+/**
+ * @brief Memory-map an animation file from a data partition.
+ *
+ * @param label Partition label.
+ * @param[out] mapping Mapped file.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_NOT_FOUND: No partition with that label
+ *      - ESP_ERR_INVALID_ARG, ESP_ERR_INVALID_VERSION, ESP_ERR_INVALID_SIZE: The partition holds no valid animation
+ *      - Other: Error from esp_partition_mmap()
+ */
+esp_err_t ftb8md_anim_map_partition(const char *label, ftb8md_anim_mapping_t *mapping);
+
+/**
+ * @brief Release a mapping made with ftb8md_anim_map_partition().
+ *
+ * @param mapping Mapped file.
+ */
+void ftb8md_anim_unmap(ftb8md_anim_mapping_t *mapping);
+
+#ifdef __cplusplus
+}
+#endif
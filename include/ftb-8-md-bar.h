@@ -0,0 +1,108 @@
+/**
+ * @file ftb-8-md-bar.h
+ * @brief Bar graph and level meter widget.
+ *
+ * A bar spans consecutive digits with a resolution of one pixel column
+ * (5 steps per digit, 40 across the whole panel). Digits left of the
+ * boundary show a full glyph, digits right of it a space, and only the
+ * boundary digit shows a partial glyph. Partial glyphs live in CGRAM
+ * characters reserved for the bar and are uploaded the first time they are
+ * needed, so once a meter has moved across its range a step costs one DCRAM
+ * write of 2 bytes (3 when it crosses into the next digit).
+ *
+ * Rendering uses no heap memory: all state lives in ftb8md_bar_t.
+ */
+
+#pragma once
+
+#include "ftb-8-md.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief CGRAM characters a bar needs */
+#define FTB8MD_BAR_GLYPHS FTB8MD_GLYPH_COLS
+
+/** @brief Default column pattern: all 7 rows lit */
+#define FTB8MD_BAR_PATTERN_SOLID 0x7F
+
+/**
+ * @brief How the value is drawn.
+ */
+typedef enum
+{
+    FTB8MD_BAR_FILL,   /**< Columns up to the value are lit (bar graph) */
+    FTB8MD_BAR_MARKER, /**< Only the column at the value is lit (level or position indicator) */
+} ftb8md_bar_style_t;
+
+/**
+ * @brief Bar widget.
+ *
+ * Fields may be read; only `pattern` may be changed after ftb8md_bar_init(),
+ * and takes effect with the next ftb8md_bar_set().
+ */
+typedef struct
+{
+    spi_device_handle_t handle;        /**< Panel the bar is drawn on */
+    uint8_t digit;                     /**< First digit of the bar */
+    uint8_t count;                     /**< Digits the bar spans */
+    uint8_t slots[FTB8MD_BAR_GLYPHS];  /**< CGRAM character holding the glyph for 1-5 columns */
+    uint8_t pattern;                   /**< Column byte of lit columns (bit 0 = top row) */
+    ftb8md_bar_style_t style;          /**< Drawing style */
+    uint16_t value;                    /**< Columns currently shown (0 to count * 5) */
+} ftb8md_bar_t;
+
+/**
+ * @brief Initialise a bar widget.
+ *
+ * Nothing is sent until the first ftb8md_bar_set().
+ *
+ * @param bar Widget to initialise.
+ * @param handle The SPI device handle obtained from ftb8md_device_register().
+ * @param digit First digit of the bar (0-7).
+ * @param count Number of digits the bar spans (1-8).
+ * @param slot_mask CGRAM characters the bar may use; the lowest FTB8MD_BAR_GLYPHS set bits are taken.
+ * @param style Drawing style.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL bar, digit range out of the panel or fewer than FTB8MD_BAR_GLYPHS slots
+ */
+esp_err_t ftb8md_bar_init(ftb8md_bar_t *bar, spi_device_handle_t handle, int digit, int count, uint8_t slot_mask,
+                          ftb8md_bar_style_t style);
+
+/**
+ * @brief Show a value in pixel columns.
+ *
+ * Glyphs the value needs are uploaded if CGRAM does not hold them yet, then
+ * only the digits whose character changes are written.
+ *
+ * @param bar Bar widget.
+ * @param columns Lit columns (fill) or position of the marker counted from 1 (marker); 0 shows an empty bar.
+ *                Clamped to count * 5.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL bar or unregistered handle
+ *      - ESP_FAIL: SPI communication error
+ */
+esp_err_t ftb8md_bar_set(ftb8md_bar_t *bar, int columns);
+
+/**
+ * @brief Show a value scaled from an application range.
+ *
+ * @param bar Bar widget.
+ * @param value Value to show; clamped to [min, max].
+ * @param min Value shown as an empty bar.
+ * @param max Value shown as a full bar (must differ from min).
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL bar, unregistered handle or min equal to max
+ *      - ESP_FAIL: SPI communication error
+ */
+esp_err_t ftb8md_bar_set_scaled(ftb8md_bar_t *bar, int32_t value, int32_t min, int32_t max);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,199 @@
+/**
+ * @file ftb-8-md-bind.h
+ * @brief Live data binding: values shown in digit regions at a human rate.
+ *
+ * A binding ties a region of digits to a value and a formatter. Producers
+ * only store the latest value, a single atomic store that never touches the
+ * bus or a lock, however often they sample:
+ *
+ * @code
+ * static ftb8md_binding_t temp;
+ * ftb8md_bind_config_t config = FTB8MD_BIND_CONFIG_DEFAULT();
+ * config.digit = 4;
+ * config.width = 4;
+ * config.type = FTB8MD_BIND_FLOAT;
+ * config.fmt = "%.1f";
+ * config.max_rate_hz = 5;
+ * ftb8md_bind(&temp, vfd, &config);
+ *
+ * // sensor task, at any rate
+ * ftb8md_bind_set_float(&temp, read_temperature());
+ * @endcode
+ *
+ * An esp_timer renders every binding at most max_rate_hz times per second:
+ * it formats the value only when it changed since the last render, and
+ * writes only when the formatted text differs, so SPI traffic follows what
+ * the panel shows rather than the sensor rate.
+ */
+
+#pragma once
+
+#include "ftb-8-md.h"
+#include "ftb-8-md-layout.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Type of a bound value.
+ */
+typedef enum
+{
+    FTB8MD_BIND_INT,   /**< int32_t */
+    FTB8MD_BIND_FLOAT, /**< float */
+} ftb8md_bind_type_t;
+
+/**
+ * @brief A bound value.
+ */
+typedef union
+{
+    int32_t i; /**< Value of FTB8MD_BIND_INT bindings */
+    float f;   /**< Value of FTB8MD_BIND_FLOAT bindings */
+} ftb8md_bind_value_t;
+
+/**
+ * @brief Formatter turning a value into text.
+ *
+ * Called from the esp_timer task; must not block.
+ *
+ * @param value Value to format.
+ * @param buf Text buffer, NUL-terminated by the formatter.
+ * @param size Size of buf.
+ * @param arg ftb8md_bind_config_t::format_arg.
+ */
+typedef void (*ftb8md_bind_format_t)(ftb8md_bind_value_t value, char *buf, size_t size, void *arg);
+
+/**
+ * @brief Binding configuration.
+ */
+typedef struct
+{
+    int digit;                   /**< First digit of the region */
+    int width;                   /**< Digits in the region */
+    ftb8md_bind_type_t type;     /**< Type of the value */
+    const char *fmt;             /**< printf format of the value, used when format is NULL */
+    ftb8md_bind_format_t format; /**< Formatter, or NULL to use fmt */
+    void *format_arg;            /**< Argument of the formatter */
+    ftb8md_layout_t layout;      /**< Placement of the text in the region */
+    uint16_t max_rate_hz;        /**< Maximum renders per second, 0 for every tick (FTB8MD_BIND_TICK_US) */
+} ftb8md_bind_config_t;
+
+/** @brief Integer over the whole panel, right-aligned, rendered at most 10 times per second */
+#define FTB8MD_BIND_CONFIG_DEFAULT()               \
+    {                                              \
+        .digit = 0,                                \
+        .width = FTB8MD_NUM_DIGITS,                \
+        .type = FTB8MD_BIND_INT,                   \
+        .fmt = "%" PRId32,                         \
+        .format = NULL,                            \
+        .format_arg = NULL,                        \
+        .layout = {                                \
+            .align = FTB8MD_ALIGN_RIGHT,           \
+            .ellipsis = FTB8MD_LAYOUT_NO_ELLIPSIS, \
+            .fill = ' ',                           \
+        },                                         \
+        .max_rate_hz = 10,                         \
+    }
+
+/**
+ * @brief Binding of a value to a region of digits.
+ *
+ * Producers write it with ftb8md_bind_set_int() or ftb8md_bind_set_float();
+ * all other fields are private to the renderer.
+ */
+typedef struct ftb8md_binding
+{
+    spi_device_handle_t handle;       /**< Panel the region is on */
+    ftb8md_bind_config_t config;      /**< Configuration */
+    uint32_t value;                   /**< Bits of the latest value, stored atomically by producers */
+    uint32_t shown;                   /**< Bits of the value last rendered */
+    bool rendered;                    /**< shown and codes describe the panel */
+    bool bound;                       /**< In the renderer's list */
+    bool stale;                       /**< Render with the next tick whatever changed */
+    uint8_t codes[FTB8MD_NUM_DIGITS]; /**< Codes last written (region digits only) */
+    int64_t period_us;                /**< Minimum time between renders */
+    int64_t due_us;                   /**< Earliest time of the next render */
+    uint32_t renders;                 /**< Values formatted */
+    uint32_t writes;                  /**< Renders whose text changed and was written */
+    struct ftb8md_binding *next;      /**< Next binding (managed by the renderer) */
+} ftb8md_binding_t;
+
+/**
+ * @brief Store the latest value of an integer binding.
+ *
+ * Wait-free and safe from any task or ISR; nothing is sent.
+ *
+ * @param binding Binding.
+ * @param value New value.
+ */
+static inline void ftb8md_bind_set_int(ftb8md_binding_t *binding, int32_t value)
+{
+    __atomic_store_n(&binding->value, (uint32_t)value, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Store the latest value of a float binding.
+ *
+ * Wait-free and safe from any task or ISR; nothing is sent.
+ *
+ * @param binding Binding.
+ * @param value New value.
+ */
+static inline void ftb8md_bind_set_float(ftb8md_binding_t *binding, float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    __atomic_store_n(&binding->value, bits, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Bind a value to a region of digits and start rendering it.
+ *
+ * The value starts at 0 and is shown with the next tick.
+ *
+ * @param binding Binding to set up; must stay valid until ftb8md_unbind().
+ * @param handle The SPI device handle obtained from ftb8md_device_register().
+ * @param config Configuration, or NULL for FTB8MD_BIND_CONFIG_DEFAULT().
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL binding, unregistered handle, region outside the panel, or neither formatter
+ *                             nor format
+ *      - ESP_ERR_INVALID_STATE: The binding is already bound
+ *      - ESP_ERR_NO_MEM: Render timer could not be created
+ */
+esp_err_t ftb8md_bind(ftb8md_binding_t *binding, spi_device_handle_t handle, const ftb8md_bind_config_t *config);
+
+/**
+ * @brief Stop rendering a binding; the panel keeps showing the last value.
+ *
+ * Waits for a render tick in progress, so the binding can be reused or
+ * freed afterwards. Must not be called from a formatter.
+ *
+ * @param binding Binding.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL binding
+ *      - ESP_ERR_NOT_FOUND: The binding is not bound
+ */
+esp_err_t ftb8md_unbind(ftb8md_binding_t *binding);
+
+/**
+ * @brief Render a binding with the next tick, even if its value and text are unchanged.
+ *
+ * For example after something else wrote to its region.
+ *
+ * @param binding Binding.
+ */
+void ftb8md_bind_invalidate(ftb8md_binding_t *binding);
+
+#ifdef __cplusplus
+}
+#endif
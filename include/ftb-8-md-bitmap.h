@@ -0,0 +1,147 @@
+/**
+ * @file ftb-8-md-bitmap.h
+ * @brief 40x7 bitmap graphics mode for the Futaba 8-MD-06INK VFD.
+ *
+ * The panel has exactly one CGRAM character per digit, so digit N can show
+ * CGRAM character N and the 8 characters together form a 40x7 pixel
+ * framebuffer. The framebuffer is stored column-major in the same layout as
+ * ftb8md_write_custom_char() expects (one byte per column, bit 0 = top row),
+ * so flushing it is a straight copy with no repacking.
+ *
+ * @note Bitmap mode owns all 8 CGRAM characters and all 8 digits while in use.
+ */
+
+#pragma once
+
+#include "ftb-8-md.h"
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Bitmap width in pixels */
+#define FTB8MD_BITMAP_WIDTH (FTB8MD_NUM_CGRAM * FTB8MD_GLYPH_COLS)
+
+/** @brief Bitmap height in pixels */
+#define FTB8MD_BITMAP_HEIGHT FTB8MD_GLYPH_ROWS
+
+/**
+ * @brief Pixel operation used by the drawing primitives.
+ */
+typedef enum
+{
+    FTB8MD_PIXEL_CLEAR = 0, /**< Turn pixels off */
+    FTB8MD_PIXEL_SET,       /**< Turn pixels on */
+    FTB8MD_PIXEL_INVERT,    /**< Toggle pixels */
+} ftb8md_pixel_op_t;
+
+/**
+ * @brief Packed 40x7 pixel framebuffer.
+ *
+ * Column x lives in col[x]; bit y of that byte is the pixel in row y.
+ * Bit 7 is unused and always zero.
+ */
+typedef struct
+{
+    uint8_t col[FTB8MD_BITMAP_WIDTH]; /**< Column data, 5 consecutive columns per digit */
+} ftb8md_bitmap_t;
+
+/**
+ * @brief Clear all pixels of a bitmap.
+ *
+ * @param bmp Bitmap to clear.
+ */
+void ftb8md_bitmap_clear(ftb8md_bitmap_t *bmp);
+
+/**
+ * @brief Change a single pixel.
+ *
+ * Coordinates outside the bitmap are ignored.
+ *
+ * @param bmp Bitmap to draw into.
+ * @param x Column (0-39, 0 is the leftmost column of digit 0).
+ * @param y Row (0-6, 0 is the top row).
+ * @param op Pixel operation.
+ */
+void ftb8md_bitmap_set_pixel(ftb8md_bitmap_t *bmp, int x, int y, ftb8md_pixel_op_t op);
+
+/**
+ * @brief Read a single pixel.
+ *
+ * @param bmp Bitmap to read.
+ * @param x Column (0-39).
+ * @param y Row (0-6).
+ * @return true if the pixel is on, false if it is off or outside the bitmap.
+ */
+bool ftb8md_bitmap_get_pixel(const ftb8md_bitmap_t *bmp, int x, int y);
+
+/**
+ * @brief Draw a line between two points (inclusive).
+ *
+ * Parts of the line outside the bitmap are clipped.
+ *
+ * @param bmp Bitmap to draw into.
+ * @param x0 Start column.
+ * @param y0 Start row.
+ * @param x1 End column.
+ * @param y1 End row.
+ * @param op Pixel operation.
+ */
+void ftb8md_bitmap_draw_line(ftb8md_bitmap_t *bmp, int x0, int y0, int x1, int y1, ftb8md_pixel_op_t op);
+
+/**
+ * @brief Draw an outlined or filled rectangle.
+ *
+ * Parts of the rectangle outside the bitmap are clipped.
+ *
+ * @param bmp Bitmap to draw into.
+ * @param x Left column.
+ * @param y Top row.
+ * @param w Width in pixels.
+ * @param h Height in pixels.
+ * @param fill true to fill the rectangle, false to draw only its outline.
+ * @param op Pixel operation.
+ */
+void ftb8md_bitmap_draw_rect(ftb8md_bitmap_t *bmp, int x, int y, int w, int h, bool fill, ftb8md_pixel_op_t op);
+
+/**
+ * @brief Copy a column-major image into the bitmap.
+ *
+ * The source uses the same layout as the framebuffer and as CGRAM glyphs
+ * (one byte per column, bit 0 = top row), so a 5-byte glyph can be blitted
+ * directly. Only the lowest h rows of each source byte are used.
+ *
+ * @param bmp Bitmap to draw into.
+ * @param x Destination column of the leftmost source column (may be negative).
+ * @param y Destination row of source row 0 (may be negative).
+ * @param src Source column data.
+ * @param w Number of source columns.
+ * @param h Number of source rows (1-7).
+ * @param op FTB8MD_PIXEL_SET copies the source (lit and unlit pixels),
+ *           FTB8MD_PIXEL_CLEAR clears pixels lit in the source,
+ *           FTB8MD_PIXEL_INVERT toggles pixels lit in the source.
+ */
+void ftb8md_bitmap_blit(ftb8md_bitmap_t *bmp, int x, int y, const uint8_t *src, int w, int h, ftb8md_pixel_op_t op);
+
+/**
+ * @brief Show a bitmap on the display.
+ *
+ * Maps digit N to CGRAM character N (only if the digits do not already show
+ * them) and uploads only the CGRAM characters whose columns differ from what
+ * the panel holds. Runs of adjacent changed characters are sent as a single
+ * CGRAM transaction using the address auto-increment of the controller.
+ *
+ * @param handle The SPI device handle obtained from ftb8md_device_register().
+ * @param bmp Bitmap to show.
+ * @return
+ *      - ESP_OK: Success (including when nothing had to be sent)
+ *      - ESP_ERR_INVALID_ARG: Invalid handle or NULL bitmap
+ *      - ESP_FAIL: SPI communication error
+ */
+esp_err_t ftb8md_bitmap_flush(spi_device_handle_t handle, const ftb8md_bitmap_t *bmp);
+
+#ifdef __cplusplus
+}
+#endif
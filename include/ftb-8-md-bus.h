@@ -0,0 +1,127 @@
+/**
+ * @file ftb-8-md-bus.h
+ * @brief Bandwidth budgeting on a shared SPI bus.
+ *
+ * The panel is clocked at 500 kHz, so every VFD byte holds the bus for 16 us.
+ * On a host shared with fast devices (flash, SD card, displays at 40 MHz)
+ * a single 9-byte DCRAM write blocks them for about 150 us plus overhead.
+ *
+ * A bus budget caps the share of the bus the VFD driver takes on one host:
+ * the number of bytes per time window, the length of a single transaction
+ * (longer writes are split at address boundaries, which the panel's
+ * auto-increment makes seamless) and a minimum idle gap between two VFD
+ * transactions, in which other devices can get the bus. The budget applies
+ * to all panels on the host and to both direct and scheduled transmission.
+ *
+ * Transactions that would exceed the budget are delayed, never dropped,
+ * with one exception: the esp_timer task is shared by the whole system and
+ * never waits. A write from an esp_timer callback that the budget would
+ * delay fails with ESP_ERR_TIMEOUT and sends nothing; the driver's own
+ * timers (dithering, scrubbing, animation, pager, binding, control flush)
+ * try again on their next tick.
+ */
+
+#pragma once
+
+#include "ftb-8-md.h"
+
+#include "freertos/FreeRTOS.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Bus budget of one SPI host.
+ *
+ * A zero field leaves that limit off.
+ */
+typedef struct
+{
+    uint32_t window_us;            /**< Accounting window */
+    uint32_t max_bytes_per_window; /**< Bytes the driver may send per window (smoothed, not per fixed window) */
+    uint8_t max_transaction_len;   /**< Longest transaction in bytes (DCRAM/ADRAM >= 2, CGRAM >= 6) */
+    uint32_t min_gap_us;           /**< Idle time between two VFD transactions */
+} ftb8md_bus_budget_t;
+
+/**
+ * @brief Bus usage of the VFD driver on one SPI host.
+ */
+typedef struct
+{
+    uint32_t transactions; /**< Transactions sent */
+    uint32_t bytes;        /**< Bytes sent */
+    uint32_t splits;       /**< Extra transactions created by max_transaction_len */
+    uint32_t refused;      /**< Transactions from esp_timer callbacks refused instead of delayed */
+    uint64_t wire_us;      /**< Time the bus was clocking VFD data */
+    uint64_t throttle_us;  /**< Time transactions were held back by the budget */
+    uint64_t elapsed_us;   /**< Time since the statistics were reset */
+    uint16_t duty_permille; /**< Achieved share of the bus, wire_us / elapsed_us in 1/1000 */
+} ftb8md_bus_stats_t;
+
+/**
+ * @brief Set or remove the bus budget of an SPI host.
+ *
+ * @param host SPI host the panels are registered on.
+ * @param budget Budget (copied), or NULL to remove all limits.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: Invalid host, or max_bytes_per_window set without window_us
+ */
+esp_err_t ftb8md_bus_set_budget(spi_host_device_t host, const ftb8md_bus_budget_t *budget);
+
+/**
+ * @brief Get the bus usage of the VFD driver on an SPI host.
+ *
+ * Statistics are collected with and without a budget.
+ *
+ * @param host SPI host.
+ * @param[out] stats Usage since the last reset.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: Invalid host or NULL stats
+ */
+esp_err_t ftb8md_bus_get_stats(spi_host_device_t host, ftb8md_bus_stats_t *stats);
+
+/**
+ * @brief Reset the bus usage statistics of an SPI host.
+ *
+ * @param host SPI host.
+ */
+void ftb8md_bus_reset_stats(spi_host_device_t host);
+
+/**
+ * @brief Hold a panel and its SPI bus for a batch of writes.
+ *
+ * Other tasks cannot write to the panel, and other devices on the host
+ * cannot use the bus, until ftb8md_bus_release(). The batch is therefore
+ * sent back to back and is never interleaved with other traffic. Keep
+ * batches short: the budget set with ftb8md_bus_set_budget() still paces
+ * the batch, and the bus stays held while it waits. With the scheduler
+ * running, only the panel is held, since the worker task does the sending;
+ * the same goes for panels of a parallel group (ftb-8-md-par.h).
+ *
+ * Calls may nest in the same task.
+ *
+ * @param handle The SPI device handle obtained from ftb8md_device_register().
+ * @param timeout Maximum time to wait for the panel in ticks.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: Invalid handle
+ *      - ESP_ERR_TIMEOUT: Another task held the panel for longer than the timeout
+ *      - Other: Error from spi_device_acquire_bus()
+ */
+esp_err_t ftb8md_bus_acquire(spi_device_handle_t handle, TickType_t timeout);
+
+/**
+ * @brief Release a panel held with ftb8md_bus_acquire().
+ *
+ * @param handle The SPI device handle obtained from ftb8md_device_register().
+ */
+void ftb8md_bus_release(spi_device_handle_t handle);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,116 @@
+/**
+ * @file ftb-8-md-cost.h
+ * @brief Bus cost of command sequences: bytes, transactions, wire time and frame rate.
+ *
+ * Every VFD byte holds the bus for 16 us at 500 kHz, and every transaction
+ * adds CS setup and driver latency on top. A cost adds both up for a
+ * sequence of commands, so the refresh rate a screen design allows can be
+ * checked against the bus before it ships:
+ *
+ * @code
+ * ftb8md_cost_begin(vfd, NULL);
+ * draw_status_screen(vfd);             // one frame of the UI, sent as usual
+ * ftb8md_cost_t frame;
+ * ftb8md_cost_end(vfd, &frame);
+ * if (ftb8md_cost_frame_rate(&frame, 500) < 30) // 30 fps on half the bus?
+ * {
+ *     ESP_LOGW(TAG, "Status screen too expensive: %" PRIu32 " us per frame", frame.wire_us);
+ * }
+ * @endcode
+ *
+ * tools/ftb8md_cost.py computes the same figures from a trace recorded with
+ * ftb8md_trace_print() (see ftb-8-md-trace.h).
+ */
+
+#pragma once
+
+#include "ftb-8-md.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Default time per transaction besides the clocked bytes: CS setup and hold, driver latency */
+#define FTB8MD_COST_TXN_OVERHEAD_US 20
+
+/**
+ * @brief Timing of the bus.
+ */
+typedef struct
+{
+    uint32_t clock_hz;    /**< SPI clock */
+    uint32_t overhead_us; /**< Time per transaction besides the clocked bytes */
+} ftb8md_cost_model_t;
+
+/** @brief Timing of a panel registered with ftb8md_device_register() */
+#define FTB8MD_COST_MODEL_DEFAULT()                 \
+    {                                               \
+        .clock_hz = 500 * 1000,                     \
+        .overhead_us = FTB8MD_COST_TXN_OVERHEAD_US, \
+    }
+
+/**
+ * @brief Cost of a sequence of commands.
+ */
+typedef struct
+{
+    uint32_t transactions; /**< Commands, one transaction each */
+    uint32_t bytes;        /**< Command bytes */
+    uint32_t wire_us;      /**< Estimated bus time, overhead included */
+} ftb8md_cost_t;
+
+/**
+ * @brief Add one command to a cost.
+ *
+ * @param cost Cost to add to.
+ * @param model Bus timing, or NULL for FTB8MD_COST_MODEL_DEFAULT().
+ * @param len Length of the command in bytes.
+ */
+void ftb8md_cost_add(ftb8md_cost_t *cost, const ftb8md_cost_model_t *model, size_t len);
+
+/**
+ * @brief Frames per second a sequence can be repeated at.
+ *
+ * @param frame Cost of one frame.
+ * @param share_permille Share of the bus the frames may take, in 1/1000 (1000 for the whole bus).
+ * @return Whole frames per second, or UINT32_MAX for a frame without commands
+ */
+uint32_t ftb8md_cost_frame_rate(const ftb8md_cost_t *frame, uint16_t share_permille);
+
+/**
+ * @brief Start counting the commands the driver sends to a panel.
+ *
+ * Counts what the driver emits after its own optimisations (shadow diffing,
+ * redundant control commands skipped), from all tasks, until
+ * ftb8md_cost_end(). With the scheduler running, commands are counted when
+ * queued, before newer writes supersede them; in a parallel frame, before
+ * the frame merges them. Scrubber and ditherer traffic is not counted; its
+ * rate follows from their own settings.
+ *
+ * @param handle The SPI device handle obtained from ftb8md_device_register().
+ * @param model Bus timing, or NULL for FTB8MD_COST_MODEL_DEFAULT().
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: Invalid handle or zero clock
+ *      - ESP_ERR_INVALID_STATE: Already counting
+ */
+esp_err_t ftb8md_cost_begin(spi_device_handle_t handle, const ftb8md_cost_model_t *model);
+
+/**
+ * @brief Stop counting and get the cost of the commands sent since ftb8md_cost_begin().
+ *
+ * @param handle The SPI device handle obtained from ftb8md_device_register().
+ * @param[out] cost Cost of the commands sent.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: Invalid handle or NULL cost
+ *      - ESP_ERR_INVALID_STATE: Not counting
+ */
+esp_err_t ftb8md_cost_end(spi_device_handle_t handle, ftb8md_cost_t *cost);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,116 @@
+/**
+ * @file ftb-8-md-dither.h
+ * @brief Per-digit brightness by temporal dithering.
+ *
+ * The panel's dimming register is global. Dithering gives digits their own
+ * intensity by blanking them for part of every cycle: a cycle is split into
+ * `levels` frames, and a digit at level L shows its character in the first
+ * L frames and a blank in the rest. Because all digits switch on together
+ * at the start of a cycle and off in order of level, a cycle costs one DCRAM
+ * write to switch the dimmed digits on plus one per distinct level, and
+ * frames in which nothing changes send nothing.
+ *
+ * Only DCRAM is dithered; decimal points and other ADRAM segments stay lit.
+ * Digits at full level and digits showing a space cost no bus time. The driver keeps writing the real
+ * characters to the shadow, so text, layers and other diffing APIs keep
+ * working while dithering runs.
+ */
+
+#pragma once
+
+#include "ftb-8-md.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Most frames per cycle */
+#define FTB8MD_DITHER_MAX_LEVELS 16
+
+/**
+ * @brief Dithering configuration.
+ */
+typedef struct
+{
+    uint32_t frame_us; /**< Length of one frame; the cycle lasts levels * frame_us */
+    uint8_t levels;    /**< Frames per cycle, i.e. the full intensity level (2-FTB8MD_DITHER_MAX_LEVELS) */
+} ftb8md_dither_config_t;
+
+/** @brief Default dithering configuration: 4 levels at a 100 Hz cycle */
+#define FTB8MD_DITHER_CONFIG_DEFAULT() \
+    {                                  \
+        .frame_us = 2500,              \
+        .levels = 4,                   \
+    }
+
+/**
+ * @brief Bus load caused by the current levels.
+ */
+typedef struct
+{
+    uint32_t transactions_per_cycle; /**< DCRAM writes per cycle */
+    uint32_t bytes_per_cycle;        /**< Bytes per cycle */
+    uint32_t bytes_per_sec;          /**< Resulting data rate */
+    uint16_t bus_permille;           /**< Share of the 500 kHz bus in 1/1000 */
+} ftb8md_dither_load_t;
+
+/**
+ * @brief Start (or reconfigure) dithering on a panel.
+ *
+ * All digits start at full level.
+ *
+ * @param handle The SPI device handle obtained from ftb8md_device_register().
+ * @param config Configuration, or NULL for FTB8MD_DITHER_CONFIG_DEFAULT().
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: Invalid handle, zero frame length or levels out of range
+ *      - ESP_ERR_NO_MEM: Timer could not be created
+ */
+esp_err_t ftb8md_dither_start(spi_device_handle_t handle, const ftb8md_dither_config_t *config);
+
+/**
+ * @brief Stop dithering and show all digits at full level.
+ *
+ * @param handle The SPI device handle obtained from ftb8md_device_register().
+ * @return
+ *      - ESP_OK: Success (also when dithering was not running)
+ *      - ESP_ERR_INVALID_ARG: Invalid handle
+ */
+esp_err_t ftb8md_dither_stop(spi_device_handle_t handle);
+
+/**
+ * @brief Set the intensity of consecutive digits.
+ *
+ * Takes effect with the next frame.
+ *
+ * @param handle The SPI device handle obtained from ftb8md_device_register().
+ * @param digit First digit (0-7).
+ * @param count Number of digits.
+ * @param level Intensity from 0 (blank) to the configured levels (full).
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: Invalid handle or digit range, or level above the configured levels
+ *      - ESP_ERR_INVALID_STATE: Dithering not started
+ */
+esp_err_t ftb8md_dither_set_level(spi_device_handle_t handle, int digit, int count, uint8_t level);
+
+/**
+ * @brief Get the bus load the current levels cause.
+ *
+ * Computed from the update schedule for the characters shown now, so it can
+ * be checked before the levels have been running for a whole cycle.
+ *
+ * @param handle The SPI device handle obtained from ftb8md_device_register().
+ * @param[out] load Bus load.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: Invalid handle or NULL load
+ *      - ESP_ERR_INVALID_STATE: Dithering not started
+ */
+esp_err_t ftb8md_dither_get_load(spi_device_handle_t handle, ftb8md_dither_load_t *load);
+
+#ifdef __cplusplus
+}
+#endif
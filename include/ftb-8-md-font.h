@@ -0,0 +1,67 @@
+/**
+ * @file ftb-8-md-font.h
+ * @brief Built-in 5x7 font for rendering text into CGRAM or bitmap columns.
+ *
+ * Glyphs use the CGRAM column layout: 5 bytes, one per column from left to
+ * right, bit 0 = top row. They can be passed to ftb8md_write_custom_char()
+ * or ftb8md_bitmap_blit() unchanged.
+ */
+
+#pragma once
+
+#include "ftb-8-md.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief First character covered by the built-in ASCII font */
+#define FTB8MD_FONT_ASCII_FIRST 0x20
+
+/** @brief Last character covered by the built-in ASCII font */
+#define FTB8MD_FONT_ASCII_LAST 0x7E
+
+/**
+ * @brief Look up the built-in 5x7 glyph of a printable ASCII character.
+ *
+ * @param c Character (0x20-0x7E).
+ * @return Pointer to the 5 column bytes of the glyph, or NULL if the character is not printable ASCII.
+ */
+const uint8_t *ftb8md_font_ascii_glyph(char c);
+
+/**
+ * @brief Glyph table indexed by Unicode code point.
+ *
+ * Code points and glyph data live in two parallel arrays, so a lookup binary
+ * searches the densely packed code point array and touches the glyph data
+ * only once a match is found. Both arrays are meant to be const (flash-resident).
+ */
+typedef struct
+{
+    const uint32_t *codepoints;                 /**< Code points, sorted ascending */
+    const uint8_t (*glyphs)[FTB8MD_GLYPH_COLS]; /**< Glyph columns, same order as codepoints */
+    size_t count;                               /**< Number of glyphs */
+} ftb8md_glyph_table_t;
+
+/**
+ * @brief Built-in glyphs for common symbols and accented Latin letters.
+ *
+ * Covers e.g. degree sign, micro sign, currency signs, arrows, ellipsis and
+ * German/French/Spanish/Nordic letters that the panel ROM lacks.
+ */
+extern const ftb8md_glyph_table_t ftb8md_glyphs_extended;
+
+/**
+ * @brief Find the glyph of a code point in a glyph table.
+ *
+ * @param table Glyph table (sorted by code point).
+ * @param codepoint Unicode code point.
+ * @return Pointer to the 5 column bytes of the glyph, or NULL if the table has no such glyph.
+ */
+const uint8_t *ftb8md_glyph_find(const ftb8md_glyph_table_t *table, uint32_t codepoint);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,197 @@
+/**
+ * @file ftb-8-md-layer.h
+ * @brief Layer compositor for the Futaba 8-MD-06INK VFD.
+ *
+ * A compositor stacks any number of layers over one display. Each layer holds
+ * a character code and ADRAM value per digit plus a mask of the digits it
+ * covers; digits it does not cover are transparent and show whatever lies
+ * below. Layers with a higher priority are drawn on top, and a layer can be
+ * given a timeout after which it is removed automatically: a one-shot timer
+ * of the compositor fires at the earliest timeout and uncovers what lies
+ * below.
+ *
+ * The composited result is compared against the panel shadow, so pushing,
+ * changing or expiring a layer transmits only the digits whose visible
+ * contents change. Layers are owned by the caller and linked into the
+ * compositor; no heap memory is used.
+ */
+
+#pragma once
+
+#include "ftb-8-md.h"
+#include "esp_timer.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Character code shown on digits no layer covers */
+#define FTB8MD_LAYER_BACKGROUND ' '
+
+/**
+ * @brief Display layer.
+ *
+ * Initialise with ftb8md_layer_init(). The contents may be changed at any
+ * time; call ftb8md_compositor_refresh() to show the change.
+ */
+typedef struct ftb8md_layer
+{
+    uint8_t code[FTB8MD_NUM_DIGITS];  /**< Character code per digit */
+    uint8_t adram[FTB8MD_NUM_DIGITS]; /**< ADRAM value per digit */
+    uint8_t opaque;                   /**< Bit N set if the layer covers digit N */
+    int priority;                     /**< Stacking order, higher is drawn on top */
+    int64_t expires_us;               /**< esp_timer time at which the layer is removed (0 = never) */
+    struct ftb8md_layer *next;        /**< Next lower layer (managed by the compositor) */
+    struct ftb8md_compositor *owner;  /**< Compositor the layer is in, NULL if none (managed by the compositor) */
+} ftb8md_layer_t;
+
+/**
+ * @brief Layer compositor of one display.
+ */
+typedef struct ftb8md_compositor
+{
+    spi_device_handle_t handle; /**< Display the layers are composited onto */
+    ftb8md_layer_t *top;        /**< Highest priority layer */
+    esp_timer_handle_t timer;   /**< Expiry timer, created with the first timeout */
+    bool closing;               /**< ftb8md_compositor_deinit() has started; the timer is not re-armed */
+} ftb8md_compositor_t;
+
+/**
+ * @brief Initialise a compositor.
+ *
+ * @param comp Compositor to initialise.
+ * @param handle The SPI device handle obtained from ftb8md_device_register().
+ */
+void ftb8md_compositor_init(ftb8md_compositor_t *comp, spi_device_handle_t handle);
+
+/**
+ * @brief Stop the expiry timer of a compositor and release it.
+ *
+ * The layers stay on the display as they are. Call before the compositor
+ * goes out of scope if any layer was pushed with a timeout.
+ *
+ * @param comp Compositor.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL compositor
+ *      - ESP_ERR_INVALID_STATE: The timer could not be deleted; call again
+ */
+esp_err_t ftb8md_compositor_deinit(ftb8md_compositor_t *comp);
+
+/**
+ * @brief Initialise an empty (fully transparent) layer.
+ *
+ * @param layer Layer to initialise.
+ * @param priority Stacking order, higher is drawn on top.
+ */
+void ftb8md_layer_init(ftb8md_layer_t *layer, int priority);
+
+/**
+ * @brief Make a layer fully transparent.
+ *
+ * @param layer Layer.
+ */
+void ftb8md_layer_clear(ftb8md_layer_t *layer);
+
+/**
+ * @brief Place a string on a layer, making the digits it covers opaque.
+ *
+ * Spaces are opaque as well; use ftb8md_layer_set_transparent() to uncover digits.
+ *
+ * @param layer Layer.
+ * @param digit The starting digit position (0-7).
+ * @param str Null-terminated string of character codes. Characters beyond the display width are ignored.
+ */
+void ftb8md_layer_set_string(ftb8md_layer_t *layer, int digit, const char *str);
+
+/**
+ * @brief Place a single character code on a layer.
+ *
+ * @param layer Layer.
+ * @param digit The digit position (0-7).
+ * @param code Character code (CGROM, or 0-7 for CGRAM characters).
+ */
+void ftb8md_layer_set_char(ftb8md_layer_t *layer, int digit, uint8_t code);
+
+/**
+ * @brief Set the ADRAM value a layer shows on a digit.
+ *
+ * The value is only visible where the layer is opaque.
+ *
+ * @param layer Layer.
+ * @param digit The digit position (0-7).
+ * @param value ADRAM value.
+ */
+void ftb8md_layer_set_adram(ftb8md_layer_t *layer, int digit, uint8_t value);
+
+/**
+ * @brief Make digits of a layer transparent.
+ *
+ * @param layer Layer.
+ * @param digit The first digit position (0-7).
+ * @param count Number of digits.
+ */
+void ftb8md_layer_set_transparent(ftb8md_layer_t *layer, int digit, int count);
+
+/**
+ * @brief Add a layer to the compositor and show it.
+ *
+ * A layer that is already in the compositor is re-stacked and its timeout is
+ * restarted. Among layers of equal priority the most recently pushed is on top.
+ *
+ * @param comp Compositor.
+ * @param layer Layer (must stay valid until removed or expired).
+ * @param timeout_ms Time after which the layer is removed automatically, 0 to keep it until removed.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL compositor or layer, or invalid handle
+ *      - ESP_ERR_INVALID_STATE: The layer is in another compositor
+ *      - ESP_ERR_NO_MEM: The expiry timer could not be created
+ *      - ESP_FAIL: SPI communication error
+ */
+esp_err_t ftb8md_compositor_push(ftb8md_compositor_t *comp, ftb8md_layer_t *layer, uint32_t timeout_ms);
+
+/**
+ * @brief Remove a layer from the compositor and uncover what lies below.
+ *
+ * @param comp Compositor.
+ * @param layer Layer to remove (removing a layer that is not in any compositor is a no-op).
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL compositor or layer, or invalid handle
+ *      - ESP_ERR_INVALID_STATE: The layer is in another compositor
+ *      - ESP_FAIL: SPI communication error
+ */
+esp_err_t ftb8md_compositor_remove(ftb8md_compositor_t *comp, ftb8md_layer_t *layer);
+
+/**
+ * @brief Expire timed-out layers and show the current composition.
+ *
+ * Call after changing the contents of a layer. Layers whose timeout has
+ * passed are removed by the expiry timer; refreshing removes them as well,
+ * should the timer still be waiting for the panel. Only digits whose
+ * composited code or ADRAM value differs from what the display shows are
+ * transmitted.
+ *
+ * @param comp Compositor.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL compositor or invalid handle
+ *      - ESP_FAIL: SPI communication error
+ */
+esp_err_t ftb8md_compositor_refresh(ftb8md_compositor_t *comp);
+
+/**
+ * @brief Time until the next layer expires.
+ *
+ * @param comp Compositor.
+ * @return Microseconds until the earliest timeout (0 if already due), or -1 if no layer has a timeout.
+ */
+int64_t ftb8md_compositor_next_expiry(const ftb8md_compositor_t *comp);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,236 @@
+/**
+ * @file ftb-8-md-layout.h
+ * @brief Text layout: alignment, truncation and paging of long messages.
+ *
+ * ftb8md_show_aligned() places a string in a field of digits, left, right or
+ * centred, fills the rest and marks truncated text with an ellipsis
+ * character; only the digits whose code changes are written.
+ *
+ * Messages longer than the panel are split once into pages with
+ * ftb8md_pages_build(), which breaks them at spaces and encodes every page
+ * up front. A pager then shows the pages in turn, each for its dwell time,
+ * so cycling through them costs no formatting, only a diffed DCRAM write:
+ *
+ * @code
+ * static ftb8md_page_t pages[8];
+ * ftb8md_pages_config_t config = FTB8MD_PAGES_CONFIG_DEFAULT();
+ * config.layout.align = FTB8MD_ALIGN_CENTER;
+ * size_t count = ftb8md_pages_build("NEXT TRAIN TO CENTRAL IN 4 MIN", &config, pages, 8);
+ *
+ * ftb8md_pager_t pager;
+ * ftb8md_pager_init(&pager, vfd);
+ * ftb8md_pager_start(&pager, pages, count, true);
+ * @endcode
+ *
+ * Strings are written code by code like ftb8md_show_string(): ASCII maps to
+ * the ROM characters, codes 0-7 show the CGRAM characters.
+ */
+
+#pragma once
+
+#include "ftb-8-md.h"
+#include "esp_timer.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief ftb8md_layout_t::ellipsis value that cuts truncated text without a marker */
+#define FTB8MD_LAYOUT_NO_ELLIPSIS (-1)
+
+/**
+ * @brief Horizontal alignment of text in its field.
+ */
+typedef enum
+{
+    FTB8MD_ALIGN_LEFT,   /**< Text starts at the first digit of the field */
+    FTB8MD_ALIGN_RIGHT,  /**< Text ends at the last digit of the field */
+    FTB8MD_ALIGN_CENTER, /**< Text is centred; an odd spare digit goes to the right */
+} ftb8md_align_t;
+
+/**
+ * @brief How text is placed in a field of digits.
+ */
+typedef struct
+{
+    ftb8md_align_t align; /**< Alignment */
+    int16_t ellipsis;     /**< Code shown in the last digit of truncated text, or FTB8MD_LAYOUT_NO_ELLIPSIS */
+    uint8_t fill;         /**< Code of the digits the text leaves free */
+} ftb8md_layout_t;
+
+/** @brief Left-aligned, padded with spaces, truncated without a marker */
+#define FTB8MD_LAYOUT_DEFAULT()                \
+    {                                          \
+        .align = FTB8MD_ALIGN_LEFT,            \
+        .ellipsis = FTB8MD_LAYOUT_NO_ELLIPSIS, \
+        .fill = ' ',                           \
+    }
+
+/**
+ * @brief One pre-encoded page of a message.
+ */
+typedef struct
+{
+    uint8_t codes[FTB8MD_NUM_DIGITS]; /**< Character code of every digit */
+    uint32_t dwell_ms;                /**< Time the page is shown */
+} ftb8md_page_t;
+
+/**
+ * @brief How a message is split into pages.
+ */
+typedef struct
+{
+    ftb8md_layout_t layout;     /**< Placement of the text of each page */
+    uint32_t dwell_ms;          /**< Time each page is shown */
+    uint32_t dwell_per_char_ms; /**< Extra time per character on the page, so longer pages stay longer */
+} ftb8md_pages_config_t;
+
+/** @brief Left-aligned pages, shown for 1.5 s each */
+#define FTB8MD_PAGES_CONFIG_DEFAULT()      \
+    {                                      \
+        .layout = FTB8MD_LAYOUT_DEFAULT(), \
+        .dwell_ms = 1500,                  \
+        .dwell_per_char_ms = 0,            \
+    }
+
+/**
+ * @brief Page player.
+ *
+ * All fields are private to the pager.
+ */
+typedef struct
+{
+    spi_device_handle_t handle; /**< Panel the pages are shown on */
+    esp_timer_handle_t timer;   /**< Page timer */
+    const ftb8md_page_t *pages; /**< Pages being shown */
+    size_t count;               /**< Number of pages */
+    size_t index;               /**< Page shown */
+    bool loop;                  /**< Start over after the last page */
+    bool playing;               /**< Pages are cycling */
+    bool stopping;              /**< ftb8md_pager_deinit() has started; the timer is not re-armed */
+} ftb8md_pager_t;
+
+/**
+ * @brief Lay out text in a field of digits.
+ *
+ * @param layout Placement, or NULL for FTB8MD_LAYOUT_DEFAULT().
+ * @param str Text.
+ * @param len Length of the text in bytes.
+ * @param[out] codes Character codes of the field (width entries).
+ * @param width Digits in the field.
+ * @return Number of bytes of the text shown (less than len when it was truncated).
+ */
+size_t ftb8md_layout_encode(const ftb8md_layout_t *layout, const char *str, size_t len, uint8_t *codes, int width);
+
+/**
+ * @brief Show text aligned in a field of digits.
+ *
+ * Digits of the field outside the text are set to the fill code. Only
+ * digits whose code changes are written.
+ *
+ * @param handle The SPI device handle obtained from ftb8md_device_register().
+ * @param digit First digit of the field (0-7).
+ * @param width Digits in the field (1 to FTB8MD_NUM_DIGITS - digit).
+ * @param str Null-terminated text.
+ * @param layout Placement, or NULL for FTB8MD_LAYOUT_DEFAULT().
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: Invalid handle, NULL string or field outside the panel
+ *      - ESP_FAIL: SPI communication error
+ */
+esp_err_t ftb8md_show_aligned(spi_device_handle_t handle, int digit, int width, const char *str,
+                              const ftb8md_layout_t *layout);
+
+/**
+ * @brief Split a message into pages of FTB8MD_NUM_DIGITS digits.
+ *
+ * Pages break at spaces; a word longer than a page is split, and a newline
+ * always starts a new page. When the message needs more than max_pages
+ * pages, the last page ends with the ellipsis of the layout.
+ *
+ * @param str Null-terminated message.
+ * @param config Page layout and dwell times, or NULL for FTB8MD_PAGES_CONFIG_DEFAULT().
+ * @param[out] pages Pages.
+ * @param max_pages Capacity of pages.
+ * @return Number of pages built (0 for an empty message or NULL arguments).
+ */
+size_t ftb8md_pages_build(const char *str, const ftb8md_pages_config_t *config, ftb8md_page_t *pages,
+                          size_t max_pages);
+
+/**
+ * @brief Show one page.
+ *
+ * Only the digits that differ from the panel are written.
+ *
+ * @param handle The SPI device handle obtained from ftb8md_device_register().
+ * @param page Page.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: Invalid handle or NULL page
+ *      - ESP_FAIL: SPI communication error
+ */
+esp_err_t ftb8md_page_show(spi_device_handle_t handle, const ftb8md_page_t *page);
+
+/**
+ * @brief Initialise a pager.
+ *
+ * @param pager Pager to initialise.
+ * @param handle The SPI device handle obtained from ftb8md_device_register().
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL pager or unregistered handle
+ *      - ESP_ERR_NO_MEM: Timer could not be created
+ */
+esp_err_t ftb8md_pager_init(ftb8md_pager_t *pager, spi_device_handle_t handle);
+
+/**
+ * @brief Stop the pager and release its timer.
+ *
+ * @param pager Pager.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL pager
+ *      - ESP_ERR_INVALID_STATE: The timer could not be deleted; call again
+ */
+esp_err_t ftb8md_pager_deinit(ftb8md_pager_t *pager);
+
+/**
+ * @brief Start showing pages from the first one.
+ *
+ * Pages already cycling are replaced. The pages are not copied and must stay
+ * valid until the pager stops.
+ *
+ * @param pager Pager.
+ * @param pages Pages, e.g. from ftb8md_pages_build().
+ * @param count Number of pages.
+ * @param loop true to start over after the last page, false to stop on it.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: Uninitialised pager, NULL pages, no pages, or a loop without any dwell time
+ */
+esp_err_t ftb8md_pager_start(ftb8md_pager_t *pager, const ftb8md_page_t *pages, size_t count, bool loop);
+
+/**
+ * @brief Stop cycling; the panel keeps showing the current page.
+ *
+ * @param pager Pager.
+ */
+void ftb8md_pager_stop(ftb8md_pager_t *pager);
+
+/**
+ * @brief Check whether the pager is cycling.
+ *
+ * A pager started without loop stops by itself on its last page.
+ *
+ * @param pager Pager.
+ * @return true while cycling
+ */
+bool ftb8md_pager_is_playing(const ftb8md_pager_t *pager);
+
+#ifdef __cplusplus
+}
+#endif
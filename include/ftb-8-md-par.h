@@ -0,0 +1,130 @@
+/**
+ * @file ftb-8-md-par.h
+ * @brief Parallel transport: several panels clocked together from one shared clock.
+ *
+ * SPI sends to one panel at a time, so a frame across N panels takes N times
+ * the wire time of one. This transport drives a shared CLK line and one DIN
+ * line per panel from a dedicated GPIO bundle and shifts out the commands of
+ * all panels bit by bit in the same clock cycles; each panel has its own CS.
+ *
+ * Every panel of a group gets a handle that works with all ftb-8-md APIs.
+ * Outside a frame, writes are sent to their panel alone. Between
+ * ftb8md_par_frame_begin() and ftb8md_par_frame_end() they are collected
+ * and sent for all panels at once when the frame ends, so a frame across
+ * all panels costs about the wire time of the busiest one.
+ *
+ * Requires a target with dedicated GPIO (ESP32-S2, S3, C2, C3, C5, C6, H2, P4).
+ */
+
+#pragma once
+
+#include "ftb-8-md.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Maximum panels per group: dedicated GPIO output channels minus the clock */
+#define FTB8MD_PAR_MAX_PANELS 7
+
+/**
+ * @brief Parallel group configuration.
+ */
+typedef struct
+{
+    int clk_pin;                             /**< Shared clock line */
+    int reset_pin;                           /**< Shared reset line, or -1 if not connected */
+    uint8_t num_panels;                      /**< Number of panels (1 to FTB8MD_PAR_MAX_PANELS) */
+    int din_pins[FTB8MD_PAR_MAX_PANELS];     /**< Data line per panel */
+    int cs_pins[FTB8MD_PAR_MAX_PANELS];      /**< Chip select per panel */
+} ftb8md_par_config_t;
+
+/**
+ * @brief Parallel group statistics.
+ */
+typedef struct
+{
+    uint32_t frames;      /**< Frames sent */
+    uint32_t bytes;       /**< Command bytes sent, summed over all panels */
+    uint32_t clock_bytes; /**< Byte times clocked; bytes / clock_bytes is the gain over SPI */
+} ftb8md_par_stats_t;
+
+/** @brief Handle of a parallel group */
+typedef struct ftb8md_par *ftb8md_par_handle_t;
+
+/**
+ * @brief Set up the pins of a parallel group and initialize its panels.
+ *
+ * Each panel takes one of the FTB8MD_MAX_PANELS driver slots.
+ *
+ * @param config Group configuration.
+ * @param[out] ret_par Group handle.
+ * @param[out] panels Device handle per panel (config->num_panels entries), for use with all ftb-8-md APIs.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL argument or invalid number of panels
+ *      - ESP_ERR_NOT_SUPPORTED: Target has no dedicated GPIO
+ *      - ESP_ERR_NO_MEM: Out of memory, panel slots or dedicated GPIO channels
+ *      - Other: Error from gpio_config()
+ */
+esp_err_t ftb8md_par_create(const ftb8md_par_config_t *config, ftb8md_par_handle_t *ret_par,
+                            spi_device_handle_t panels[]);
+
+/**
+ * @brief Release the pins and panel handles of a group.
+ *
+ * @param par Group handle.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL handle
+ *      - ESP_ERR_INVALID_STATE: A frame is open
+ */
+esp_err_t ftb8md_par_delete(ftb8md_par_handle_t par);
+
+/**
+ * @brief Start collecting writes to the panels of the group.
+ *
+ * Until ftb8md_par_frame_end(), writes by the calling task only update the
+ * shadow copies; writes by other tasks wait for the frame to end. Frames
+ * may nest; the outermost end sends. With the scheduler running, the
+ * outermost begin first waits until the queue has been sent, so writes
+ * queued earlier never overtake the frame.
+ *
+ * @param par Group handle.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL handle
+ */
+esp_err_t ftb8md_par_frame_begin(ftb8md_par_handle_t par);
+
+/**
+ * @brief Send everything written since ftb8md_par_frame_begin() to all panels at once.
+ *
+ * Per panel, changed CGRAM characters, digits, dots and control registers are
+ * each sent as one command, and the panels receive their commands in the same
+ * clock cycles.
+ *
+ * @param par Group handle.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL handle
+ *      - ESP_ERR_INVALID_STATE: No frame open by the calling task
+ */
+esp_err_t ftb8md_par_frame_end(ftb8md_par_handle_t par);
+
+/**
+ * @brief Get group statistics.
+ *
+ * @param par Group handle.
+ * @param[out] stats Statistics since the group was created.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL handle or stats
+ */
+esp_err_t ftb8md_par_get_stats(ftb8md_par_handle_t par, ftb8md_par_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,165 @@
+/**
+ * @file ftb-8-md-pipe.h
+ * @brief Core-affine render pipeline fed by per-core lock-free queues.
+ *
+ * The regular driver calls take the panel lock, which producers running on
+ * both cores of an ESP32 or ESP32-S3 contend for. The render pipeline
+ * instead has one single-producer single-consumer ring per core. A post
+ * copies the new digit contents into the ring of the core it runs on, with
+ * interrupts masked on that core only, and publishes them with one atomic
+ * store. It never blocks, never takes a lock shared with the other core, and
+ * never touches the bus, so it is also safe from an ISR.
+ *
+ * A render task, pinned to the core of your choice, drains the rings once
+ * per frame. It merges everything posted for a panel into one frame and
+ * writes the frame with a single diffed DCRAM and ADRAM update:
+ *
+ * @code
+ * ftb8md_pipe_config_t config = FTB8MD_PIPE_CONFIG_DEFAULT();
+ * config.task_core = 1; // keep the bus work off the protocol core
+ * ftb8md_pipe_start(&config);
+ *
+ * // any task, on either core
+ * ftb8md_pipe_show_string(vfd, 0, "RSSI -67");
+ * @endcode
+ *
+ * Every post is stamped with esp_timer_get_time(), and each digit takes the
+ * value posted last, whichever core posted it. A task that migrates between
+ * cores never has an older value win over a newer one.
+ *
+ * A post that finds the queue of its core full is merged into the digits
+ * pending for the panel on that core instead, so nothing is dropped: the
+ * panel shows the newest value of every digit, and only intermediate values
+ * are lost.
+ */
+
+#pragma once
+
+#include "ftb-8-md.h"
+
+#include "freertos/FreeRTOS.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Render task configuration.
+ */
+typedef struct
+{
+    UBaseType_t task_priority; /**< FreeRTOS priority of the render task */
+    uint32_t task_stack_size;  /**< Stack size of the render task in bytes */
+    BaseType_t task_core;      /**< Core to pin the render task to, or tskNO_AFFINITY */
+    uint32_t frame_ms;         /**< Time between two drains of the queues (at least one tick) */
+} ftb8md_pipe_config_t;
+
+/** @brief Default render pipeline configuration: unpinned, 100 frames per second */
+#define FTB8MD_PIPE_CONFIG_DEFAULT() \
+    {                                \
+        .task_priority = 5,          \
+        .task_stack_size = 3072,     \
+        .task_core = tskNO_AFFINITY, \
+        .frame_ms = 10,              \
+    }
+
+/**
+ * @brief Render pipeline statistics.
+ */
+typedef struct
+{
+    uint32_t posted[portNUM_PROCESSORS]; /**< Updates posted per producing core */
+    uint32_t full[portNUM_PROCESSORS];   /**< Posts per core that found its queue full and were merged */
+    uint32_t frames;                     /**< Frames that wrote to at least one panel */
+    uint32_t queue_high_water;           /**< Most updates found in one queue by a drain */
+} ftb8md_pipe_stats_t;
+
+/**
+ * @brief Start the render task.
+ *
+ * Start it when no other task is using the pipeline.
+ *
+ * @param config Task configuration, or NULL for FTB8MD_PIPE_CONFIG_DEFAULT().
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_STATE: Pipeline already running
+ *      - ESP_ERR_NO_MEM: Render task could not be created
+ */
+esp_err_t ftb8md_pipe_start(const ftb8md_pipe_config_t *config);
+
+/**
+ * @brief Render what is queued and stop the render task.
+ *
+ * Posts made while it stops may be lost; stop producers first.
+ *
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_STATE: Pipeline not running
+ */
+esp_err_t ftb8md_pipe_stop(void);
+
+/**
+ * @brief Queue character codes for consecutive digits.
+ *
+ * The codes are written verbatim, as with ftb8md_write_dcram(). Wait-free;
+ * safe from any task or ISR.
+ *
+ * @param handle The SPI device handle obtained from ftb8md_device_register().
+ * @param digit The first digit position (0-7) to write.
+ * @param codes Pointer to the character codes to write.
+ * @param count Number of codes to write (1 to 8 - digit).
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: Invalid handle, NULL codes, or digit/count out of range
+ *      - ESP_ERR_INVALID_STATE: Pipeline not running
+ */
+esp_err_t ftb8md_pipe_write_dcram(spi_device_handle_t handle, int digit, const uint8_t *codes, size_t count);
+
+/**
+ * @brief Queue segment patterns (ADRAM) for consecutive digits.
+ *
+ * Wait-free; safe from any task or ISR.
+ *
+ * @param handle The SPI device handle obtained from ftb8md_device_register().
+ * @param digit The first digit position (0-7) to write.
+ * @param segments Pointer to the segment bitmasks to write, one per digit.
+ * @param count Number of digits to write (1 to 8 - digit).
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: Invalid handle, NULL segments, or digit/count out of range
+ *      - ESP_ERR_INVALID_STATE: Pipeline not running
+ */
+esp_err_t ftb8md_pipe_write_adram(spi_device_handle_t handle, int digit, const uint8_t *segments, size_t count);
+
+/**
+ * @brief Queue a string starting at a digit, as ftb8md_show_string() would show it.
+ *
+ * Characters beyond the last digit are dropped. Wait-free; safe from any
+ * task or ISR.
+ *
+ * @param handle The SPI device handle obtained from ftb8md_device_register().
+ * @param digit The starting digit position (0-7).
+ * @param str Null-terminated string.
+ * @return
+ *      - ESP_OK: Success (also for an empty string, which queues nothing)
+ *      - ESP_ERR_INVALID_ARG: Invalid handle, NULL string, or digit out of range
+ *      - ESP_ERR_INVALID_STATE: Pipeline not running
+ */
+esp_err_t ftb8md_pipe_show_string(spi_device_handle_t handle, int digit, const char *str);
+
+/**
+ * @brief Get render pipeline statistics.
+ *
+ * @param[out] stats Statistics since the pipeline was started.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL stats
+ */
+esp_err_t ftb8md_pipe_get_stats(ftb8md_pipe_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,240 @@
+/**
+ * @file ftb-8-md-sched.h
+ * @brief Asynchronous command scheduler with priority classes.
+ *
+ * By default every driver call transmits its command before returning. Once
+ * the scheduler is started, commands are queued instead and sent by a worker
+ * task, so callers no longer wait for the 500 kHz bus. Queued commands are
+ * sent highest priority class first; within a class they keep their order.
+ *
+ * Long CGRAM uploads are queued one character (6 bytes) at a time, so an
+ * urgent DCRAM/ADRAM update waits at most for the transaction in flight
+ * rather than for a whole icon set or bitmap frame.
+ *
+ * The shadow copy reflects queued commands immediately, so diffing APIs
+ * (bitmap, text, layers) keep working unchanged. A queued write that is
+ * completely overwritten by a newer write before it reaches the bus is
+ * dropped.
+ *
+ * Writes may carry a deadline. Within a class, commands are sent earliest
+ * deadline first (commands without one last, in order), and a command past
+ * its deadline is either dropped or sent late, as the caller chose.
+ *
+ * Producers that do not wait for the bus can still learn when their writes
+ * are out: a fence calls back once everything queued before it has been
+ * sent, and a write options scope can call back once everything written in
+ * it has been sent, e.g. to enter light sleep or switch off the panel supply.
+ */
+
+#pragma once
+
+#include "ftb-8-md.h"
+
+#include "freertos/FreeRTOS.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Priority class of a queued command.
+ */
+typedef enum
+{
+    FTB8MD_PRIO_AUTO = -1,      /**< Choose by command: CGRAM uploads background, everything else normal */
+    FTB8MD_PRIO_BACKGROUND = 0, /**< Bulk uploads (glyphs, bitmap frames) */
+    FTB8MD_PRIO_NORMAL,         /**< Regular display updates */
+    FTB8MD_PRIO_URGENT,         /**< Alarms and other updates that must not wait */
+    FTB8MD_PRIO_COUNT,          /**< Number of priority classes */
+} ftb8md_priority_t;
+
+/**
+ * @brief Completion callback of a fence or write options scope.
+ *
+ * Called from the scheduler worker task, or from the calling task when
+ * nothing had to be waited for. Keep it short, and do not call driver
+ * functions that write to the panels: the worker is the only task that
+ * frees queue slots, so a write from it could wait for itself, or for a
+ * producer that waits for the worker. Notify a task to do follow-up writes.
+ *
+ * @param result ESP_OK when all covered commands were sent (or replaced by
+ *               newer writes), ESP_ERR_TIMEOUT when one was dropped for its
+ *               deadline, or the error of a failed transmission
+ * @param arg Argument given with the callback
+ */
+typedef void (*ftb8md_done_cb_t)(esp_err_t result, void *arg);
+
+/**
+ * @brief Options applied to driver calls made inside an ftb8md_opts_begin() scope.
+ */
+typedef struct
+{
+    ftb8md_priority_t priority; /**< Priority class of the queued commands */
+    uint32_t deadline_us;       /**< Time from the write to the end of its transmission, 0 for no deadline */
+    bool drop_late;             /**< Drop commands that miss their deadline instead of sending them late */
+    ftb8md_done_cb_t done_cb;   /**< Called once everything written in the scope has been sent, or NULL */
+    void *done_arg;             /**< Argument of done_cb */
+} ftb8md_write_opts_t;
+
+/** @brief Default write options */
+#define FTB8MD_WRITE_OPTS_DEFAULT()   \
+    {                                 \
+        .priority = FTB8MD_PRIO_AUTO, \
+        .deadline_us = 0,             \
+        .drop_late = false,           \
+        .done_cb = NULL,              \
+        .done_arg = NULL,             \
+    }
+
+/**
+ * @brief Scheduler worker task configuration.
+ */
+typedef struct
+{
+    UBaseType_t task_priority; /**< FreeRTOS priority of the worker task */
+    uint32_t task_stack_size;  /**< Stack size of the worker task in bytes */
+    BaseType_t task_core;      /**< Core to pin the worker to, or tskNO_AFFINITY */
+} ftb8md_sched_config_t;
+
+/** @brief Default scheduler configuration */
+#define FTB8MD_SCHED_CONFIG_DEFAULT() \
+    {                                 \
+        .task_priority = 5,           \
+        .task_stack_size = 3072,      \
+        .task_core = tskNO_AFFINITY,  \
+    }
+
+/**
+ * @brief Scheduler statistics.
+ *
+ * Latency is measured from queuing a command to the end of its transmission.
+ */
+typedef struct
+{
+    uint32_t sent[FTB8MD_PRIO_COUNT];           /**< Commands transmitted per class */
+    uint32_t max_latency_us[FTB8MD_PRIO_COUNT]; /**< Worst-case latency per class */
+    uint32_t avg_latency_us[FTB8MD_PRIO_COUNT]; /**< Average latency per class */
+    uint32_t superseded;                        /**< Queued commands dropped as replaced by a newer write or redundant */
+    uint32_t failed;                            /**< Commands the SPI driver rejected */
+    uint32_t dropped_late;                      /**< Commands dropped because their deadline had passed */
+    uint32_t late;                              /**< Commands sent after their deadline */
+    uint32_t queue_high_water;                  /**< Most commands queued at the same time */
+} ftb8md_sched_stats_t;
+
+/**
+ * @brief Start the scheduler worker; from now on driver calls queue their commands.
+ *
+ * Start it when no other task is using the driver.
+ *
+ * @param config Worker configuration, or NULL for FTB8MD_SCHED_CONFIG_DEFAULT().
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_STATE: Scheduler already running
+ *      - ESP_ERR_NO_MEM: Worker task could not be created
+ */
+esp_err_t ftb8md_sched_start(const ftb8md_sched_config_t *config);
+
+/**
+ * @brief Send all queued commands and stop the worker; driver calls transmit directly again.
+ *
+ * Other tasks may keep writing while the scheduler stops: calls made after
+ * the stop has begun wait for the queue to drain and transmit directly.
+ *
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_STATE: Scheduler not running
+ */
+esp_err_t ftb8md_sched_stop(void);
+
+/**
+ * @brief Wait until all queued commands have been transmitted.
+ *
+ * @param timeout Maximum time to wait in ticks.
+ * @return
+ *      - ESP_OK: Queue empty (also when the scheduler is not running)
+ *      - ESP_ERR_TIMEOUT: Commands still queued after the timeout
+ */
+esp_err_t ftb8md_sched_flush(TickType_t timeout);
+
+/**
+ * @brief Call back once every command queued so far has been sent.
+ *
+ * Does not block and does not hold back commands queued later. Commands
+ * queued later may be sent before the callback runs.
+ *
+ * @code
+ * ftb8md_show_string(vfd, 0, "GOODBYE ");
+ * ftb8md_enter_standby(vfd, true);
+ * ftb8md_sched_fence(power_down_cb, NULL); // cut the supply once standby is on the wire
+ * @endcode
+ *
+ * @param cb Callback; called right away when nothing is queued or the scheduler is not running.
+ * @param arg Argument passed to the callback.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL callback
+ *      - ESP_ERR_NO_MEM: Too many fences pending (FTB8MD_SCHED_MAX_FENCES)
+ */
+esp_err_t ftb8md_sched_fence(ftb8md_done_cb_t cb, void *arg);
+
+/**
+ * @brief Apply write options to driver calls made by the current task.
+ *
+ * Scopes do not nest: a second call replaces the options of the first.
+ * Deadlines only apply while the scheduler is running; direct calls are sent
+ * before they return. done_cb is placed as a fence when the scope ends
+ * (see ftb8md_sched_fence()).
+ *
+ * @code
+ * ftb8md_write_opts_t opts = FTB8MD_WRITE_OPTS_DEFAULT();
+ * opts.priority = FTB8MD_PRIO_URGENT;
+ * ftb8md_opts_begin(&opts);
+ * ftb8md_show_string(vfd, 0, "ALARM!!!");
+ * ftb8md_opts_end();
+ *
+ * // Hundredths are worthless after 10 ms; the next update follows anyway
+ * ftb8md_write_opts_t tick = FTB8MD_WRITE_OPTS_DEFAULT();
+ * tick.deadline_us = 10000;
+ * tick.drop_late = true;
+ * ftb8md_opts_begin(&tick);
+ * ftb8md_show_string(vfd, 6, hundredths);
+ * ftb8md_opts_end();
+ * @endcode
+ *
+ * @param opts Options (copied).
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL options
+ *      - ESP_ERR_NO_MEM: Too many tasks with open scopes (FTB8MD_SCHED_MAX_SCOPES)
+ */
+esp_err_t ftb8md_opts_begin(const ftb8md_write_opts_t *opts);
+
+/**
+ * @brief End the write options scope of the current task.
+ *
+ * If the scope has a done_cb, it runs once everything queued so far has been
+ * sent; if no fence is free, right away with ESP_ERR_NO_MEM.
+ */
+void ftb8md_opts_end(void);
+
+/**
+ * @brief Get scheduler statistics.
+ *
+ * @param[out] stats Statistics since start or the last reset.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL stats
+ */
+esp_err_t ftb8md_sched_get_stats(ftb8md_sched_stats_t *stats);
+
+/**
+ * @brief Reset scheduler statistics.
+ */
+void ftb8md_sched_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,170 @@
+/**
+ * @file ftb-8-md-screen.h
+ * @brief Pre-encoded screens for instant screen switching.
+ *
+ * A screen holds everything the panel shows, already encoded: the character
+ * code and annunciator bits of every digit and the custom characters it
+ * uses. Screens are built once, with the setters below or by capturing
+ * what a panel shows, and switching to one formats nothing:
+ *
+ * @code
+ * static ftb8md_screen_t banner;
+ * ftb8md_screen_clear(&banner);
+ * ftb8md_screen_set_custom_char(&banner, 0, bell);
+ * ftb8md_screen_set_string(&banner, 1, "ALARM");
+ * ftb8md_screen_set_addressed_char(&banner, 0, 0);
+ *
+ * ftb8md_screen_show(vfd, &banner);
+ * @endcode
+ *
+ * ftb8md_screen_show() compares the screen with the shadow copy and sends
+ * only what differs, custom characters first, in one burst that no other
+ * write can interleave with.
+ */
+
+#pragma once
+
+#include "ftb-8-md.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Encoded contents of a whole panel.
+ */
+typedef struct
+{
+    uint8_t dcram[FTB8MD_NUM_DIGITS];                   /**< Character code per digit */
+    uint8_t adram[FTB8MD_NUM_DIGITS];                   /**< Annunciator bits (E3-E0) per digit */
+    uint8_t cgram[FTB8MD_NUM_CGRAM][FTB8MD_GLYPH_COLS]; /**< Custom character columns */
+    uint8_t cgram_used;                                 /**< Bit N set when the screen defines cgram[N] */
+} ftb8md_screen_t;
+
+/**
+ * @brief Reset a screen to blank digits without annunciators or custom characters.
+ *
+ * Custom characters the screen does not define are left as they are on the
+ * panel when it is shown.
+ *
+ * @param screen Screen.
+ */
+void ftb8md_screen_clear(ftb8md_screen_t *screen);
+
+/**
+ * @brief Put a string on a screen, as ftb8md_show_string() would show it.
+ *
+ * Characters beyond the last digit are dropped.
+ *
+ * @param screen Screen.
+ * @param digit The starting digit position (0-7).
+ * @param str Null-terminated string.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL screen or string, or digit out of range
+ */
+esp_err_t ftb8md_screen_set_string(ftb8md_screen_t *screen, int digit, const char *str);
+
+/**
+ * @brief Put raw character codes on consecutive digits of a screen.
+ *
+ * @param screen Screen.
+ * @param digit The first digit position (0-7).
+ * @param codes Character codes.
+ * @param count Number of codes (1 to 8 - digit).
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL screen or codes, or digit/count out of range
+ */
+esp_err_t ftb8md_screen_set_codes(ftb8md_screen_t *screen, int digit, const uint8_t *codes, size_t count);
+
+/**
+ * @brief Set or clear the decimal point of a digit on a screen.
+ *
+ * The other annunciator bits of the digit are kept.
+ *
+ * @param screen Screen.
+ * @param digit The digit position (0-7).
+ * @param dot_on true to show the decimal point.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL screen or digit out of range
+ */
+esp_err_t ftb8md_screen_set_dot(ftb8md_screen_t *screen, int digit, bool dot_on);
+
+/**
+ * @brief Set all annunciator bits (ADRAM) of a digit on a screen.
+ *
+ * @param screen Screen.
+ * @param digit The digit position (0-7).
+ * @param bits ADRAM bits (E3-E0).
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL screen or digit out of range
+ */
+esp_err_t ftb8md_screen_set_adram(ftb8md_screen_t *screen, int digit, uint8_t bits);
+
+/**
+ * @brief Define a custom character of a screen.
+ *
+ * @param screen Screen.
+ * @param char_index The CGRAM index (0-7).
+ * @param grid_data 5 column bytes, as for ftb8md_write_custom_char().
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL screen or grid_data, or char_index out of range
+ */
+esp_err_t ftb8md_screen_set_custom_char(ftb8md_screen_t *screen, int char_index, const uint8_t grid_data[5]);
+
+/**
+ * @brief Show a custom character at a digit of a screen.
+ *
+ * @param screen Screen.
+ * @param digit The digit position (0-7).
+ * @param char_index The CGRAM index (0-7).
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL screen, digit or char_index out of range
+ */
+esp_err_t ftb8md_screen_set_addressed_char(ftb8md_screen_t *screen, int digit, int char_index);
+
+/**
+ * @brief Capture what a panel shows into a screen.
+ *
+ * Lets existing drawing code build a screen: draw it once, capture it, and
+ * show the capture from then on. Custom characters whose contents are not
+ * known are left out of the screen.
+ *
+ * @param screen Screen to fill.
+ * @param handle The SPI device handle obtained from ftb8md_device_register().
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL screen or invalid handle
+ *      - ESP_ERR_INVALID_STATE: Some DCRAM or ADRAM contents of the panel are not known (e.g. no reset pin
+ *                               and nothing written yet)
+ */
+esp_err_t ftb8md_screen_capture(ftb8md_screen_t *screen, spi_device_handle_t handle);
+
+/**
+ * @brief Switch a panel to a screen.
+ *
+ * Only what differs from the panel is sent: changed custom characters
+ * first, then changed character codes, then changed annunciator bits. The
+ * panel and its bus are held for the whole burst (see ftb8md_bus_acquire()).
+ *
+ * @param handle The SPI device handle obtained from ftb8md_device_register().
+ * @param screen Screen.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: Invalid handle or NULL screen
+ *      - ESP_FAIL: SPI communication error
+ */
+esp_err_t ftb8md_screen_show(spi_device_handle_t handle, const ftb8md_screen_t *screen);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,89 @@
+/**
+ * @file ftb-8-md-scrub.h
+ * @brief Background refresh of the panel RAM from the shadow copy.
+ *
+ * The panel cannot be read back, so DCRAM, ADRAM or CGRAM contents corrupted
+ * by EMI or a brown-out stay on screen until the application redraws them.
+ * The scrubber slowly resends the driver's shadow copy in small slices, so
+ * the panel heals on its own within one pass.
+ *
+ * Slices are only sent while the panel is idle: a slice is skipped when
+ * another task holds the panel, or while the scheduler has commands queued.
+ * With the scheduler running, slices are queued at background priority.
+ * Entries the driver does not know (e.g. before the first write when the
+ * panel has no reset pin) are not sent.
+ */
+
+#pragma once
+
+#include "ftb-8-md.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Scrubber configuration.
+ */
+typedef struct
+{
+    uint32_t bytes_per_sec; /**< Bandwidth ceiling of the scrubber */
+    uint8_t slice_digits;   /**< DCRAM/ADRAM digits resent per slice (1-8) */
+} ftb8md_scrub_config_t;
+
+/** @brief Default scrubber configuration: a full pass (74 bytes) about every 0.4 s, 0.3 % of the bus */
+#define FTB8MD_SCRUB_CONFIG_DEFAULT() \
+    {                                 \
+        .bytes_per_sec = 200,         \
+        .slice_digits = 4,            \
+    }
+
+/**
+ * @brief Scrubber statistics of one panel.
+ */
+typedef struct
+{
+    uint32_t slices;  /**< Slices sent */
+    uint32_t bytes;   /**< Bytes sent */
+    uint32_t passes;  /**< Completed passes over the whole panel */
+    uint32_t skipped; /**< Slices postponed because the panel was busy or over the bus budget */
+} ftb8md_scrub_stats_t;
+
+/**
+ * @brief Start (or reconfigure) the scrubber of a panel.
+ *
+ * @param handle The SPI device handle obtained from ftb8md_device_register().
+ * @param config Configuration, or NULL for FTB8MD_SCRUB_CONFIG_DEFAULT().
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: Invalid handle, zero bandwidth or slice_digits out of range
+ *      - ESP_ERR_NO_MEM: Timer could not be created
+ */
+esp_err_t ftb8md_scrub_start(spi_device_handle_t handle, const ftb8md_scrub_config_t *config);
+
+/**
+ * @brief Stop the scrubber of a panel.
+ *
+ * @param handle The SPI device handle obtained from ftb8md_device_register().
+ * @return
+ *      - ESP_OK: Success (also when the scrubber was not running)
+ *      - ESP_ERR_INVALID_ARG: Invalid handle
+ */
+esp_err_t ftb8md_scrub_stop(spi_device_handle_t handle);
+
+/**
+ * @brief Get the scrubber statistics of a panel.
+ *
+ * @param handle The SPI device handle obtained from ftb8md_device_register().
+ * @param[out] stats Statistics since the scrubber was started.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: Invalid handle or NULL stats
+ */
+esp_err_t ftb8md_scrub_get_stats(spi_device_handle_t handle, ftb8md_scrub_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
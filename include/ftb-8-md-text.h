@@ -0,0 +1,93 @@
+/**
+ * @file ftb-8-md-text.h
+ * @brief UTF-8 text rendering with on-the-fly CGRAM glyph substitution.
+ *
+ * Code points present in the panel ROM are written as ROM character codes.
+ * Any other code point is looked up in a glyph table and loaded into one of
+ * the CGRAM characters the text context is allowed to use; glyphs already
+ * loaded are reused, and when all slots are taken the least recently used
+ * glyph that is not visible elsewhere on the display is replaced.
+ *
+ * Rendering uses no heap memory: all state lives in ftb8md_text_t.
+ */
+
+#pragma once
+
+#include "ftb-8-md.h"
+#include "ftb-8-md-font.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Character code shown for code points without a ROM character or glyph */
+#define FTB8MD_TEXT_REPLACEMENT '?'
+
+/**
+ * @brief Text rendering context (CGRAM glyph cache).
+ *
+ * One context should own a given set of CGRAM characters; use separate,
+ * non-overlapping slot masks when CGRAM is shared with other users.
+ */
+typedef struct
+{
+    const ftb8md_glyph_table_t *table;      /**< Glyphs for code points not in ROM */
+    uint8_t slot_mask;                      /**< CGRAM characters this context may use */
+    uint32_t slot_cp[FTB8MD_NUM_CGRAM];     /**< Code point loaded in each CGRAM character (0 = none) */
+    uint32_t slot_stamp[FTB8MD_NUM_CGRAM];  /**< Last use of each CGRAM character, for LRU replacement */
+    uint32_t stamp;                         /**< Use counter */
+} ftb8md_text_t;
+
+/**
+ * @brief Initialise a text rendering context.
+ *
+ * @param text Context to initialise.
+ * @param table Glyph table for code points not in ROM, or NULL for ftb8md_glyphs_extended.
+ * @param slot_mask Bit N set allows the context to use CGRAM character N (0xFF for all).
+ */
+void ftb8md_text_init(ftb8md_text_t *text, const ftb8md_glyph_table_t *table, uint8_t slot_mask);
+
+/**
+ * @brief Decode one code point from a UTF-8 string.
+ *
+ * Malformed, overlong or truncated sequences decode as U+FFFD and consume
+ * one byte, so decoding always makes progress.
+ *
+ * @param str UTF-8 string (must not point at the terminating NUL).
+ * @param[out] codepoint Decoded code point.
+ * @return Number of bytes consumed (1-4).
+ */
+size_t ftb8md_utf8_decode(const char *str, uint32_t *codepoint);
+
+/**
+ * @brief Map a code point to the character code of the panel ROM.
+ *
+ * @param codepoint Unicode code point.
+ * @return ROM character code, or -1 if the ROM has no such character.
+ */
+int ftb8md_text_rom_code(uint32_t codepoint);
+
+/**
+ * @brief Display a UTF-8 string starting at the specified digit position.
+ *
+ * Code points without a ROM character are loaded into CGRAM from the glyph
+ * table. Only CGRAM characters whose contents change and only the digits
+ * whose codes change are transmitted.
+ *
+ * @param handle The SPI device handle obtained from ftb8md_device_register().
+ * @param text Text rendering context.
+ * @param digit The starting digit position (0-7).
+ * @param utf8 Null-terminated UTF-8 string. Characters beyond the display width are truncated.
+ * @return
+ *      - ESP_OK: Success. Code points without a glyph, or that do not fit in the
+ *                available CGRAM characters, are shown as FTB8MD_TEXT_REPLACEMENT.
+ *      - ESP_ERR_INVALID_ARG: Invalid handle, NULL context or string, or digit out of range
+ *      - ESP_FAIL: SPI communication error
+ */
+esp_err_t ftb8md_text_show(spi_device_handle_t handle, ftb8md_text_t *text, int digit, const char *utf8);
+
+#ifdef __cplusplus
+}
+#endif
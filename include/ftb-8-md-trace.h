@@ -0,0 +1,119 @@
+/**
+ * @file ftb-8-md-trace.h
+ * @brief Trace of the commands sent to the panels.
+ *
+ * A trace callback sees every command once it has been sent to a panel,
+ * over SPI or a parallel group, whichever API or background feature (scheduler,
+ * scrubber, ditherer) produced it. ftb8md_trace_print() writes each command
+ * as one line of text, which tools/ftb8md_sim.py decodes and renders as a
+ * live panel on the host:
+ *
+ *     idf.py monitor | tools/ftb8md_sim.py
+ *
+ * The trace also holds the commands as the API calls issued them, before the
+ * scheduler or a parallel frame handles them, each with the call site that
+ * issued it: the label set with ftb8md_trace_site(), or the task name.
+ * tools/ftb8md_opt.py works out from those which call sites waste bus time.
+ */
+
+#pragma once
+
+#include "ftb-8-md.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Marker starting the lines of sent commands written by ftb8md_trace_print() */
+#define FTB8MD_TRACE_PREFIX "FTB8MD-TX"
+
+/** @brief Marker starting the lines of API calls written by ftb8md_trace_print() */
+#define FTB8MD_TRACE_CALL_PREFIX "FTB8MD-CALL"
+
+/* Line number as a string literal, for FTB8MD_TRACE_HERE() */
+#define FTB8MD_TRACE_STR_(x) #x
+#define FTB8MD_TRACE_STR(x) FTB8MD_TRACE_STR_(x)
+
+/** @brief Label the following driver calls of the calling task with the current source line */
+#define FTB8MD_TRACE_HERE() ftb8md_trace_site(__FILE__ ":" FTB8MD_TRACE_STR(__LINE__))
+
+/**
+ * @brief Kind of a trace record.
+ */
+typedef enum
+{
+    FTB8MD_TRACE_TX,   /**< Command sent to the panel */
+    FTB8MD_TRACE_CALL, /**< Command issued by an API call, not sent yet */
+} ftb8md_trace_kind_t;
+
+/**
+ * @brief One trace record.
+ */
+typedef struct
+{
+    ftb8md_trace_kind_t kind; /**< Sent command or API call */
+    int64_t time_us;          /**< esp_timer time the command was sent or issued */
+    uint8_t panel;            /**< Driver slot of the panel (0 to FTB8MD_MAX_PANELS - 1) */
+    const uint8_t *cmd;       /**< Command bytes, valid during the callback only */
+    size_t len;               /**< Length of the command in bytes */
+    const char *site;         /**< Call site of FTB8MD_TRACE_CALL records, NULL for FTB8MD_TRACE_TX */
+} ftb8md_trace_record_t;
+
+/**
+ * @brief Trace callback.
+ *
+ * Called in the task that sent the command (the caller, the scheduler worker
+ * or the esp_timer task) with the panel lock held; keep it short and do not
+ * write to the panels from it.
+ */
+typedef void (*ftb8md_trace_cb_t)(const ftb8md_trace_record_t *record, void *ctx);
+
+/**
+ * @brief Start tracing.
+ *
+ * @param cb Callback called for every command sent, e.g. ftb8md_trace_print.
+ * @param ctx Context passed to the callback.
+ * @return
+ *      - ESP_OK: Success (replaces a callback set before)
+ *      - ESP_ERR_INVALID_ARG: NULL callback
+ */
+esp_err_t ftb8md_trace_start(ftb8md_trace_cb_t cb, void *ctx);
+
+/**
+ * @brief Stop tracing.
+ *
+ * A callback already running in another task may still finish.
+ */
+void ftb8md_trace_stop(void);
+
+/**
+ * @brief Label the driver calls the calling task makes from now on.
+ *
+ * Calls of a task without a label are attributed to the task name.
+ *
+ * @param site Label, e.g. "clock_screen" (see also FTB8MD_TRACE_HERE()); must stay valid. NULL removes it.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_NO_MEM: Too many tasks with labels (FTB8MD_TRACE_MAX_SITES)
+ */
+esp_err_t ftb8md_trace_site(const char *site);
+
+/**
+ * @brief Trace callback writing each record as a line of text.
+ *
+ * The line holds FTB8MD_TRACE_PREFIX or FTB8MD_TRACE_CALL_PREFIX, the panel
+ * slot, the time in microseconds, the command bytes in hex and, for calls,
+ * the call site, e.g. "FTB8MD-TX 0 1520344 2048454C4C4F202020" or
+ * "FTB8MD-CALL 0 1520310 2048454C4C4F202020 main.c:42".
+ *
+ * @param record Trace record.
+ * @param ctx FILE to write to, or NULL for stdout.
+ */
+void ftb8md_trace_print(const ftb8md_trace_record_t *record, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
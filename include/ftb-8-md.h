@@ -16,18 +16,64 @@
 
 #pragma once
 
+#include "sdkconfig.h"
 #include "esp_err.h"
 #include "driver/spi_master.h"
 
 #include <stdint.h>
 #include <assert.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Number of digits the driver addresses (CONFIG_FTB8MD_NUM_DIGITS, 8 on the 8-MD-06INK) */
+#ifdef CONFIG_FTB8MD_NUM_DIGITS
+#define FTB8MD_NUM_DIGITS CONFIG_FTB8MD_NUM_DIGITS
+#else
+#define FTB8MD_NUM_DIGITS 8
+#endif
+
+/** @brief Number of user-definable characters in CGRAM */
+#define FTB8MD_NUM_CGRAM 8
+
+/** @brief Columns per character cell (one CGRAM data byte per column) */
+#define FTB8MD_GLYPH_COLS 5
+
+/** @brief Rows per character cell (bit 0 of a column byte is the top row) */
+#define FTB8MD_GLYPH_ROWS 7
+
+/**
+ * @name Command encoding
+ *
+ * Command bytes built with explicit shifts and masks, so their layout does
+ * not depend on the compiler's bitfield order. All of them are constant
+ * expressions when their argument is.
+ * @{
+ */
+#define FTB8MD_CMD_DCRAM(digit) ((uint8_t)(0x20u | ((unsigned)(digit) & 0x1Fu))) /**< DCRAM write from a digit */
+#define FTB8MD_CMD_CGRAM(slot) ((uint8_t)(0x40u | ((unsigned)(slot) & 0x07u)))   /**< CGRAM write from a slot */
+#define FTB8MD_CMD_ADRAM(digit) ((uint8_t)(0x60u | ((unsigned)(digit) & 0x1Fu))) /**< ADRAM write from a digit */
+#define FTB8MD_CMD_URAM(addr) ((uint8_t)(0x80u | ((unsigned)(addr) & 0x07u)))    /**< URAM write from an address */
+#define FTB8MD_CMD_DIGIT_SET 0xE0    /**< Number of digits setting (argument: digits - 1) */
+#define FTB8MD_CMD_DIMMING 0xE4      /**< Dimming level setting (argument: 0-240) */
+#define FTB8MD_CMD_DISPLAY_ON 0xE8   /**< Display on */
+#define FTB8MD_CMD_DISPLAY_OFF 0xEA  /**< Display off */
+#define FTB8MD_CMD_MODE_NORMAL 0xEC  /**< Normal mode */
+#define FTB8MD_CMD_MODE_STANDBY 0xED /**< Standby mode */
+#define FTB8MD_ADRAM_DOT 0x01        /**< ADRAM bit of the decimal point (E0) */
+/** @} */
+
 /**
  * @brief Union representing all possible display command formats.
  *
  * This union provides a structured way to construct various commands
  * for the VFD display controller. Each member corresponds to a specific
  * command type with its own data format.
+ *
+ * @note The bitfield layout is compiler-defined. The driver itself encodes
+ *       commands with the FTB8MD_CMD_* macros; the union is kept for
+ *       existing code.
  */
 typedef union
 {
@@ -136,6 +182,19 @@ static_assert(sizeof(DisplayCommand) == 9, "DisplayCommand size must be 9 bytes"
  */
 spi_device_handle_t ftb8md_device_register(spi_host_device_t host_id, int cs_pin, int reset_pin);
 
+/**
+ * @brief Remove the VFD display device from the SPI bus.
+ *
+ * Releases the driver state associated with the handle and removes the
+ * device from its SPI host. The handle must not be used afterwards.
+ *
+ * @param handle The SPI device handle obtained from ftb8md_device_register().
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: Invalid or unknown handle, or a panel of a parallel group (see ftb8md_par_delete())
+ */
+esp_err_t ftb8md_device_unregister(spi_device_handle_t handle);
+
 /**
  * @brief Display a string on the VFD starting at the specified digit position.
  *
@@ -161,6 +220,9 @@ esp_err_t ftb8md_show_string(spi_device_handle_t handle, int digit, const char *
  * This function adjusts the brightness of the VFD display by controlling
  * the duty cycle of the display grid.
  *
+ * Nothing is sent if the panel already has this level. See
+ * ftb8md_set_ctrl_interval() to limit how often the level is sent.
+ *
  * @param handle The SPI device handle obtained from ftb8md_device_register().
  * @param level Brightness level (0-240, where 0 is dimmest and 240 is brightest).
  *              Values above 240 will be capped to 240.
@@ -176,6 +238,7 @@ esp_err_t ftb8md_set_dimming(spi_device_handle_t handle, uint8_t level);
  *
  * In standby mode, the display is turned off and power consumption is reduced.
  * The display contents are preserved and will be restored when exiting standby.
+ * Nothing is sent if the panel is already in the requested mode.
  *
  * @param handle The SPI device handle obtained from ftb8md_device_register().
  * @param standby Set to true to enter standby mode, false to exit and resume normal operation.
@@ -192,6 +255,7 @@ esp_err_t ftb8md_enter_standby(spi_device_handle_t handle, bool standby);
  * This function controls the display power state. When off, all segments are
  * turned off but the display contents in memory are preserved. This is different
  * from standby mode which also reduces overall power consumption.
+ * Nothing is sent if the display is already in the requested state.
  *
  * @param handle The SPI device handle obtained from ftb8md_device_register().
  * @param on Set to true to turn on the display, false to turn it off.
@@ -205,6 +269,37 @@ esp_err_t ftb8md_enter_standby(spi_device_handle_t handle, bool standby);
  */
 esp_err_t ftb8md_set_display_power(spi_device_handle_t handle, bool on);
 
+/**
+ * @brief Limit how often control commands are sent.
+ *
+ * ftb8md_set_dimming(), ftb8md_enter_standby() and ftb8md_set_display_power()
+ * only record the requested value. The first change after a quiet period is
+ * sent immediately; changes arriving within the interval are collapsed and
+ * only the latest value of each register is sent when the interval has
+ * passed. Control traffic is thus bounded by the interval no matter how
+ * often the functions are called.
+ *
+ * @param handle The SPI device handle obtained from ftb8md_device_register().
+ * @param interval_ms Minimum time between control commands, 0 to send every change immediately (default).
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: Invalid handle
+ *      - ESP_ERR_NO_MEM: Timer could not be created
+ *      - ESP_FAIL: SPI communication error while sending pending changes
+ */
+esp_err_t ftb8md_set_ctrl_interval(spi_device_handle_t handle, uint32_t interval_ms);
+
+/**
+ * @brief Send pending control register changes now instead of waiting for the interval.
+ *
+ * @param handle The SPI device handle obtained from ftb8md_device_register().
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: Invalid handle
+ *      - ESP_FAIL: SPI communication error
+ */
+esp_err_t ftb8md_flush_ctrl(spi_device_handle_t handle);
+
 /**
  * @brief Set or clear the decimal point for a specific digit.
  *
@@ -291,3 +386,44 @@ esp_err_t ftb8md_write_custom_char(spi_device_handle_t handle, int char_index, c
  * @see ftb8md_write_custom_char()
  */
 esp_err_t ftb8md_set_addressed_char(spi_device_handle_t handle, int digit, int char_index);
+
+/**
+ * @brief Write raw character codes to consecutive digits.
+ *
+ * Unlike ftb8md_show_string(), the codes are written verbatim, so CGRAM
+ * characters (0x00-0x07) can be mixed with CGROM characters in a single
+ * transaction.
+ *
+ * @param handle The SPI device handle obtained from ftb8md_device_register().
+ * @param digit The first digit position (0-7) to write.
+ * @param codes Pointer to the character codes to write.
+ * @param count Number of codes to write (1 to 8 - digit).
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: Invalid handle, NULL codes, or digit/count out of range
+ *      - ESP_FAIL: SPI communication error
+ */
+esp_err_t ftb8md_write_dcram(spi_device_handle_t handle, int digit, const uint8_t *codes, size_t count);
+
+/**
+ * @brief Send a pre-encoded command.
+ *
+ * Intended for commands encoded ahead of time (e.g. constant screens and
+ * glyphs built at compile time by ftb-8-md.hpp). The command is checked for
+ * addresses beyond the panel and tracked in the shadow copy like any other
+ * write; control commands sent this way bypass the control coalescing
+ * interval.
+ *
+ * @param handle The SPI device handle obtained from ftb8md_device_register().
+ * @param cmd Encoded command.
+ * @param len Length of the command (1 to 41 bytes, a CGRAM write of all 8 characters).
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: Invalid handle, NULL command, or length/addresses out of range
+ *      - ESP_FAIL: SPI communication error
+ */
+esp_err_t ftb8md_write_raw(spi_device_handle_t handle, const uint8_t *cmd, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,380 @@
+/**
+ * @file ftb-8-md.hpp
+ * @brief C++17 interface: compile-time command encoding and RAII handles.
+ *
+ * Commands for constant screens and glyphs are encoded by constexpr
+ * functions, so a `static constexpr` command is a byte array in flash and
+ * sending it costs no encoding at run time. Range errors (digit or CGRAM
+ * slot out of range, text longer than the panel, malformed glyph art) are
+ * compile errors.
+ *
+ * @code
+ * static constexpr auto k_ready = ftb8md::text<0>("READY   ");
+ * static constexpr auto k_bell = ftb8md::cgram<0>(ftb8md::glyph_rows(
+ *     "..#..", ".###.", ".###.", ".###.", "#####", ".....", "..#.."));
+ *
+ * ftb8md::Device vfd(SPI2_HOST, PIN_CS, PIN_RST);
+ * ftb8md::Session session(vfd);
+ * session.send(k_bell, k_ready, ftb8md::dimming<120>());
+ * @endcode
+ *
+ * The header does not use exceptions; failures are returned as esp_err_t.
+ */
+
+#pragma once
+
+#include "ftb-8-md.h"
+#include "ftb-8-md-bus.h"
+#include "ftb-8-md-cost.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace ftb8md
+{
+
+/** @brief Column data of one CGRAM character (bit0 = top row) */
+using Glyph = std::array<uint8_t, FTB8MD_GLYPH_COLS>;
+
+/**
+ * @brief Encoded command of N bytes.
+ */
+template <std::size_t N>
+struct Command
+{
+    static_assert(N >= 1 && N <= 1 + FTB8MD_NUM_CGRAM * FTB8MD_GLYPH_COLS, "Command length out of range");
+
+    std::array<uint8_t, N> bytes; /**< Command byte followed by its data */
+
+    constexpr const uint8_t *data() const { return bytes.data(); }
+    constexpr std::size_t size() const { return N; }
+
+    /**
+     * @brief Copy the command into a DisplayCommand (commands of up to 9 bytes).
+     */
+    DisplayCommand to_display_command() const
+    {
+        static_assert(N <= sizeof(DisplayCommand), "Command does not fit in a DisplayCommand");
+        DisplayCommand cmd = {};
+        for (std::size_t i = 0; i < N; i++)
+        {
+            cmd.raw[i] = bytes[i];
+        }
+        return cmd;
+    }
+};
+
+namespace detail
+{
+
+/**
+ * @brief Not constexpr: reaching it while encoding a constant is a compile error.
+ */
+inline void invalid_glyph_row() {}
+
+template <std::size_t N, typename... T>
+constexpr Command<N> make(T... bytes)
+{
+    return Command<N>{{{static_cast<uint8_t>(bytes)...}}};
+}
+
+} // namespace detail
+
+/**
+ * @brief DCRAM write of a string, one ROM character code per byte.
+ *
+ * @tparam Digit First digit
+ */
+template <int Digit, std::size_t Len>
+constexpr Command<Len> text(const char (&str)[Len])
+{
+    static_assert(Digit >= 0 && Digit < FTB8MD_NUM_DIGITS, "Digit out of range");
+    static_assert(Len >= 2, "Empty text");
+    static_assert(Digit + (Len - 1) <= FTB8MD_NUM_DIGITS, "Text does not fit on the panel");
+
+    Command<Len> cmd{};
+    cmd.bytes[0] = FTB8MD_CMD_DCRAM(Digit);
+    for (std::size_t i = 0; i + 1 < Len; i++)
+    {
+        cmd.bytes[1 + i] = static_cast<uint8_t>(str[i]);
+    }
+    return cmd;
+}
+
+/**
+ * @brief DCRAM write of character codes (ROM codes, or 0-7 for CGRAM characters).
+ *
+ * @tparam Digit First digit
+ */
+template <int Digit, typename... Codes>
+constexpr Command<1 + sizeof...(Codes)> codes(Codes... chr)
+{
+    static_assert(Digit >= 0 && Digit < FTB8MD_NUM_DIGITS, "Digit out of range");
+    static_assert(sizeof...(Codes) >= 1, "No character codes");
+    static_assert(Digit + sizeof...(Codes) <= FTB8MD_NUM_DIGITS, "Codes do not fit on the panel");
+
+    return detail::make<1 + sizeof...(Codes)>(FTB8MD_CMD_DCRAM(Digit), chr...);
+}
+
+/**
+ * @brief ADRAM write of decimal points.
+ *
+ * @tparam Digit First digit
+ */
+template <int Digit, typename... Dots>
+constexpr Command<1 + sizeof...(Dots)> dots(Dots... on)
+{
+    static_assert(Digit >= 0 && Digit < FTB8MD_NUM_DIGITS, "Digit out of range");
+    static_assert(sizeof...(Dots) >= 1, "No dots");
+    static_assert(Digit + sizeof...(Dots) <= FTB8MD_NUM_DIGITS, "Dots do not fit on the panel");
+
+    return detail::make<1 + sizeof...(Dots)>(FTB8MD_CMD_ADRAM(Digit), (on ? FTB8MD_ADRAM_DOT : 0x00)...);
+}
+
+/**
+ * @brief Glyph from its five columns (bit0 = top row).
+ */
+constexpr Glyph glyph(uint8_t c0, uint8_t c1, uint8_t c2, uint8_t c3, uint8_t c4)
+{
+    return Glyph{{c0, c1, c2, c3, c4}};
+}
+
+/**
+ * @brief Glyph from seven rows of ASCII art, top row first.
+ *
+ * Each row holds five characters, '#' for a lit dot and '.' for a dark one,
+ * the same notation as the font compiler's text format.
+ */
+constexpr Glyph glyph_rows(const char *r0, const char *r1, const char *r2, const char *r3,
+                           const char *r4, const char *r5, const char *r6)
+{
+    const char *rows[FTB8MD_GLYPH_ROWS] = {r0, r1, r2, r3, r4, r5, r6};
+    Glyph g{};
+    for (int row = 0; row < FTB8MD_GLYPH_ROWS; row++)
+    {
+        for (int col = 0; col < FTB8MD_GLYPH_COLS; col++)
+        {
+            char c = rows[row][col];
+            if (c == '#')
+            {
+                g[col] |= static_cast<uint8_t>(1u << row);
+            }
+            else if (c != '.')
+            {
+                detail::invalid_glyph_row();
+                return g;
+            }
+        }
+        if (rows[row][FTB8MD_GLYPH_COLS] != '\0')
+        {
+            detail::invalid_glyph_row();
+            return g;
+        }
+    }
+    return g;
+}
+
+/**
+ * @brief CGRAM write of consecutive characters.
+ *
+ * @tparam Slot First CGRAM slot
+ */
+template <int Slot, typename... Glyphs>
+constexpr Command<1 + FTB8MD_GLYPH_COLS * sizeof...(Glyphs)> cgram(const Glyphs &...glyphs)
+{
+    static_assert(Slot >= 0 && Slot < FTB8MD_NUM_CGRAM, "CGRAM slot out of range");
+    static_assert(sizeof...(Glyphs) >= 1, "No glyphs");
+    static_assert(Slot + sizeof...(Glyphs) <= FTB8MD_NUM_CGRAM, "Glyphs do not fit in CGRAM");
+
+    const Glyph list[] = {glyphs...};
+    Command<1 + FTB8MD_GLYPH_COLS * sizeof...(Glyphs)> cmd{};
+    cmd.bytes[0] = FTB8MD_CMD_CGRAM(Slot);
+    for (std::size_t i = 0; i < sizeof...(Glyphs); i++)
+    {
+        for (std::size_t col = 0; col < FTB8MD_GLYPH_COLS; col++)
+        {
+            cmd.bytes[1 + i * FTB8MD_GLYPH_COLS + col] = list[i][col];
+        }
+    }
+    return cmd;
+}
+
+/**
+ * @brief Dimming level command.
+ *
+ * @tparam Level Brightness level (0-240)
+ */
+template <unsigned Level>
+constexpr Command<2> dimming()
+{
+    static_assert(Level <= 240, "Dimming level out of range");
+    return detail::make<2>(FTB8MD_CMD_DIMMING, Level);
+}
+
+/** @brief Display on command */
+constexpr Command<2> display_on() { return detail::make<2>(FTB8MD_CMD_DISPLAY_ON, 0); }
+
+/** @brief Display off command */
+constexpr Command<2> display_off() { return detail::make<2>(FTB8MD_CMD_DISPLAY_OFF, 0); }
+
+/** @brief Normal mode command */
+constexpr Command<2> normal_mode() { return detail::make<2>(FTB8MD_CMD_MODE_NORMAL, 0); }
+
+/** @brief Standby mode command */
+constexpr Command<2> standby_mode() { return detail::make<2>(FTB8MD_CMD_MODE_STANDBY, 0); }
+
+/**
+ * @brief Bus time of commands sent one after another, see ftb8md_cost_add().
+ *
+ * Keeps constant screens within a latency budget at compile time:
+ * `static_assert(ftb8md::wire_time_us(k_bell, k_ready) <= 500);`
+ */
+template <std::size_t... N>
+constexpr uint32_t wire_time_us(const Command<N> &...)
+{
+    constexpr uint32_t clock_hz = 500 * 1000;
+    return (0u + ... +
+            (FTB8MD_COST_TXN_OVERHEAD_US + static_cast<uint32_t>((N * 8 * 1000000 + clock_hz - 1) / clock_hz)));
+}
+
+/**
+ * @brief Registered panel; unregistered when the object is destroyed.
+ *
+ * Move-only, so each panel has exactly one owner.
+ */
+class Device
+{
+public:
+    Device() = default;
+
+    /**
+     * @brief Register a panel, see ftb8md_device_register().
+     *
+     * Check valid() afterwards.
+     */
+    Device(spi_host_device_t host_id, int cs_pin, int reset_pin)
+        : handle_(ftb8md_device_register(host_id, cs_pin, reset_pin))
+    {
+    }
+
+    /**
+     * @brief Take ownership of a handle from ftb8md_device_register().
+     */
+    explicit Device(spi_device_handle_t handle) : handle_(handle) {}
+
+    Device(const Device &) = delete;
+    Device &operator=(const Device &) = delete;
+
+    Device(Device &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+
+    Device &operator=(Device &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+
+    ~Device() { reset(); }
+
+    /** @brief The panel was registered */
+    bool valid() const { return handle_ != nullptr; }
+    explicit operator bool() const { return valid(); }
+
+    /** @brief Handle for the C API */
+    spi_device_handle_t handle() const { return handle_; }
+
+    /**
+     * @brief Give up ownership without unregistering.
+     */
+    spi_device_handle_t release() { return std::exchange(handle_, nullptr); }
+
+    /**
+     * @brief Unregister the panel, if any.
+     */
+    esp_err_t reset()
+    {
+        if (handle_ == nullptr)
+        {
+            return ESP_OK;
+        }
+        return ftb8md_device_unregister(std::exchange(handle_, nullptr));
+    }
+
+    /**
+     * @brief Send pre-encoded commands in order, stopping at the first error.
+     */
+    template <std::size_t... N>
+    esp_err_t send(const Command<N> &...cmds) const
+    {
+        esp_err_t ret = ESP_OK;
+        ((ret = ret == ESP_OK ? ftb8md_write_raw(handle_, cmds.data(), cmds.size()) : ret), ...);
+        return ret;
+    }
+
+    esp_err_t show_string(int digit, const char *str) const { return ftb8md_show_string(handle_, digit, str); }
+    esp_err_t set_dimming(uint8_t level) const { return ftb8md_set_dimming(handle_, level); }
+    esp_err_t set_display_power(bool on) const { return ftb8md_set_display_power(handle_, on); }
+    esp_err_t enter_standby(bool standby) const { return ftb8md_enter_standby(handle_, standby); }
+    esp_err_t set_dot(int digit, bool dot_on) const { return ftb8md_set_dot(handle_, digit, dot_on); }
+    esp_err_t clear() const { return ftb8md_clear_display(handle_); }
+
+private:
+    spi_device_handle_t handle_ = nullptr;
+};
+
+/**
+ * @brief Holds a panel and its bus for a batch of writes, see ftb8md_bus_acquire().
+ *
+ * Released when the object goes out of scope.
+ */
+class Session
+{
+public:
+    explicit Session(const Device &device, TickType_t timeout = portMAX_DELAY)
+        : handle_(device.handle()), err_(ftb8md_bus_acquire(handle_, timeout))
+    {
+    }
+
+    Session(const Session &) = delete;
+    Session &operator=(const Session &) = delete;
+
+    ~Session()
+    {
+        if (err_ == ESP_OK)
+        {
+            ftb8md_bus_release(handle_);
+        }
+    }
+
+    /** @brief The panel is held */
+    explicit operator bool() const { return err_ == ESP_OK; }
+
+    /** @brief Result of ftb8md_bus_acquire() */
+    esp_err_t error() const { return err_; }
+
+    /**
+     * @brief Send pre-encoded commands in order, stopping at the first error.
+     */
+    template <std::size_t... N>
+    esp_err_t send(const Command<N> &...cmds) const
+    {
+        if (err_ != ESP_OK)
+        {
+            return err_;
+        }
+        esp_err_t ret = ESP_OK;
+        ((ret = ret == ESP_OK ? ftb8md_write_raw(handle_, cmds.data(), cmds.size()) : ret), ...);
+        return ret;
+    }
+
+private:
+    spi_device_handle_t handle_;
+    esp_err_t err_;
+};
+
+} // namespace ftb8md
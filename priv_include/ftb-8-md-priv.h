@@ -0,0 +1,548 @@
+/**
+ * @file ftb-8-md-priv.h
+ * @brief Internal driver state shared between the ftb-8-md source files.
+ *
+ * Not part of the public API.
+ */
+
+#pragma once
+
+#include "ftb-8-md.h"
+#include "ftb-8-md-cost.h"
+#include "ftb-8-md-scrub.h"
+#include "ftb-8-md-trace.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+
+#include <stdbool.h>
+
+/*
+ * Build configuration, set in menuconfig (see Kconfig). Subsystems that are
+ * switched off are not compiled; the core reaches them only through the
+ * hooks declared at the end of this file, which become empty inline stubs.
+ * The sizes can also be overridden with -D.
+ */
+#ifdef CONFIG_FTB8MD_ENABLE_SCHED
+#define FTB8MD_SCHED_ENABLED 1
+#else
+#define FTB8MD_SCHED_ENABLED 0
+#endif
+
+#ifdef CONFIG_FTB8MD_ENABLE_PAR
+#define FTB8MD_PAR_ENABLED 1
+#else
+#define FTB8MD_PAR_ENABLED 0
+#endif
+
+#ifdef CONFIG_FTB8MD_ENABLE_TRACE
+#define FTB8MD_TRACE_ENABLED 1
+#else
+#define FTB8MD_TRACE_ENABLED 0
+#endif
+
+#ifdef CONFIG_FTB8MD_ENABLE_COST
+#define FTB8MD_COST_ENABLED 1
+#else
+#define FTB8MD_COST_ENABLED 0
+#endif
+
+/** @brief Argument checks: 2 returns ESP_ERR_INVALID_ARG, 1 asserts, 0 trusts the caller */
+#if defined(CONFIG_FTB8MD_CHECK_NONE)
+#define FTB8MD_CHECK_LEVEL 0
+#elif defined(CONFIG_FTB8MD_CHECK_ASSERT)
+#define FTB8MD_CHECK_LEVEL 1
+#else
+#define FTB8MD_CHECK_LEVEL 2
+#endif
+
+/** @brief Reject an invalid argument of a function returning esp_err_t, as configured by FTB8MD_CHECK_LEVEL */
+#if FTB8MD_CHECK_LEVEL >= 2
+#define FTB8MD_CHECK_ARG(cond)          \
+    do                                  \
+    {                                   \
+        if (!(cond))                    \
+        {                               \
+            return ESP_ERR_INVALID_ARG; \
+        }                               \
+    } while (0)
+#elif FTB8MD_CHECK_LEVEL == 1
+#define FTB8MD_CHECK_ARG(cond) assert(cond)
+#else
+#define FTB8MD_CHECK_ARG(cond) ((void)sizeof(cond))
+#endif
+
+/** @brief Maximum number of panels that can be registered at the same time */
+#ifndef FTB8MD_MAX_PANELS
+#ifdef CONFIG_FTB8MD_MAX_PANELS
+#define FTB8MD_MAX_PANELS CONFIG_FTB8MD_MAX_PANELS
+#else
+#define FTB8MD_MAX_PANELS 4
+#endif
+#endif
+
+/** @brief Number of commands the scheduler can hold */
+#ifndef FTB8MD_SCHED_QUEUE_LEN
+#ifdef CONFIG_FTB8MD_SCHED_QUEUE_LEN
+#define FTB8MD_SCHED_QUEUE_LEN CONFIG_FTB8MD_SCHED_QUEUE_LEN
+#else
+#define FTB8MD_SCHED_QUEUE_LEN 32
+#endif
+#endif
+
+/** @brief Number of tasks that can have a write options scope open at the same time */
+#ifndef FTB8MD_SCHED_MAX_SCOPES
+#ifdef CONFIG_FTB8MD_SCHED_MAX_SCOPES
+#define FTB8MD_SCHED_MAX_SCOPES CONFIG_FTB8MD_SCHED_MAX_SCOPES
+#else
+#define FTB8MD_SCHED_MAX_SCOPES 8
+#endif
+#endif
+
+/** @brief Number of scheduler fences that can be pending at the same time */
+#ifndef FTB8MD_SCHED_MAX_FENCES
+#ifdef CONFIG_FTB8MD_SCHED_MAX_FENCES
+#define FTB8MD_SCHED_MAX_FENCES CONFIG_FTB8MD_SCHED_MAX_FENCES
+#else
+#define FTB8MD_SCHED_MAX_FENCES 8
+#endif
+#endif
+
+/** @brief Number of parallel groups that can exist at the same time */
+#ifndef FTB8MD_PAR_MAX_GROUPS
+#ifdef CONFIG_FTB8MD_PAR_MAX_GROUPS
+#define FTB8MD_PAR_MAX_GROUPS CONFIG_FTB8MD_PAR_MAX_GROUPS
+#else
+#define FTB8MD_PAR_MAX_GROUPS 2
+#endif
+#endif
+
+/** @brief Number of tasks that can have a trace call site label at the same time */
+#ifndef FTB8MD_TRACE_MAX_SITES
+#ifdef CONFIG_FTB8MD_TRACE_MAX_SITES
+#define FTB8MD_TRACE_MAX_SITES CONFIG_FTB8MD_TRACE_MAX_SITES
+#else
+#define FTB8MD_TRACE_MAX_SITES 8
+#endif
+#endif
+
+/** @brief Updates each core can have queued for the render pipeline; a power of two */
+#ifndef FTB8MD_PIPE_QUEUE_LEN
+#ifdef CONFIG_FTB8MD_PIPE_QUEUE_LEN
+#define FTB8MD_PIPE_QUEUE_LEN CONFIG_FTB8MD_PIPE_QUEUE_LEN
+#else
+#define FTB8MD_PIPE_QUEUE_LEN 16
+#endif
+#endif
+
+/** @brief Period of the render tick of live data bindings */
+#ifndef FTB8MD_BIND_TICK_US
+#define FTB8MD_BIND_TICK_US 10000
+#endif
+
+/** @brief Bit mask with one bit per digit */
+#define FTB8MD_DIGIT_MASK ((uint8_t)((1u << FTB8MD_NUM_DIGITS) - 1))
+
+/** @brief Maximum dimming level */
+#define FTB8MD_MAX_DIMMING 240
+
+/** @brief Maximum SPI clock frequency (500 kHz) */
+#define FTB8MD_SPI_CLOCK_HZ (500 * 1000)
+
+/** @brief Longest command the driver builds: CGRAM write of all 8 characters */
+#define FTB8MD_CMD_MAX_LEN (1 + FTB8MD_NUM_CGRAM * FTB8MD_GLYPH_COLS)
+
+/** @brief Longest single piece: DCRAM/ADRAM write of all digits, or one CGRAM character (panels under 5 digits) */
+#define FTB8MD_CMD_PIECE_MAX_LEN (1 + (FTB8MD_NUM_DIGITS > FTB8MD_GLYPH_COLS ? FTB8MD_NUM_DIGITS : FTB8MD_GLYPH_COLS))
+
+/* Command prefixes (cmd[0] >> 5); encode with the FTB8MD_CMD_* macros */
+#define CMD_PREFIX_DCRAM 0x01 /**< DCRAM write command prefix (001) */
+#define CMD_PREFIX_CGRAM 0x02 /**< CGRAM write command prefix (010) */
+#define CMD_PREFIX_ADRAM 0x03 /**< ADRAM write command prefix (011) */
+#define CMD_PREFIX_URAM 0x04  /**< URAM write command prefix (100) */
+
+/* Fixed control commands in rodata, indexed by the register value */
+extern const uint8_t ftb8md_cmd_power[2][2];   /**< Display off, display on */
+extern const uint8_t ftb8md_cmd_standby[2][2]; /**< Normal mode, standby mode */
+
+/* Bits of ftb8md_shadow_t::ctrl_valid */
+#define FTB8MD_CTRL_DIMMING (1 << 0) /**< Dimming level is known */
+#define FTB8MD_CTRL_POWER (1 << 1)   /**< Display on/off state is known */
+#define FTB8MD_CTRL_STANDBY (1 << 2) /**< Standby state is known */
+
+/**
+ * @brief Copy of what the panel currently holds.
+ *
+ * The panel is write-only, so the driver tracks every successful write.
+ * A bit in one of the *_valid masks is cleared while the corresponding
+ * entry is unknown (e.g. after power-up without a reset pin).
+ */
+typedef struct
+{
+    uint8_t dcram[FTB8MD_NUM_DIGITS];                     /**< Character code per digit */
+    uint8_t adram[FTB8MD_NUM_DIGITS];                     /**< Segment pins (E3-E0) per digit */
+    uint8_t cgram[FTB8MD_NUM_CGRAM][FTB8MD_GLYPH_COLS];   /**< CGRAM column data */
+    uint8_t dcram_valid;                                  /**< Bit N set when dcram[N] is known */
+    uint8_t adram_valid;                                  /**< Bit N set when adram[N] is known */
+    uint8_t cgram_valid;                                  /**< Bit N set when cgram[N] is known */
+    uint8_t ctrl_valid;                                   /**< FTB8MD_CTRL_* bits of known registers */
+    uint8_t dimming;                                      /**< Dimming level (0-240) */
+    bool power_on;                                        /**< Display light on */
+    bool standby;                                         /**< Standby mode active */
+} ftb8md_shadow_t;
+
+/**
+ * @brief Per-panel driver state.
+ */
+typedef struct
+{
+    spi_device_handle_t spi;                 /**< SPI device, NULL while the slot is free */
+    spi_host_device_t host;                  /**< SPI host the device is on */
+    SemaphoreHandle_t lock;                  /**< Recursive mutex guarding the panel */
+    StaticSemaphore_t lock_buf;              /**< Storage for lock */
+    ftb8md_shadow_t shadow;                  /**< Last known panel contents (including queued commands) */
+    portMUX_TYPE lost_lock;                  /**< Guards the lost_* and wire_* fields */
+    uint8_t lost_dcram;                      /**< DCRAM entries whose queued write failed */
+    uint8_t lost_adram;                      /**< ADRAM entries whose queued write failed */
+    uint8_t lost_cgram;                      /**< CGRAM characters whose queued write failed */
+    uint8_t lost_ctrl;                       /**< FTB8MD_CTRL_* registers whose queued write failed */
+    uint8_t wire_valid;                      /**< FTB8MD_CTRL_* registers whose transmitted value is known */
+    uint8_t wire_dimming;                    /**< Last dimming level put on the wire */
+    bool wire_power_on;                      /**< Last display on/off state put on the wire */
+    bool wire_standby;                       /**< Last standby state put on the wire */
+    uint8_t ctrl_pending;                    /**< FTB8MD_CTRL_* registers set but not sent yet */
+    uint32_t ctrl_interval_us;               /**< Minimum time between two control flushes */
+    int64_t ctrl_last_us;                    /**< Time of the last control flush */
+    esp_timer_handle_t ctrl_timer;           /**< Sends pending control registers once the interval has passed */
+    esp_timer_handle_t scrub_timer;          /**< Periodic scrubber tick, NULL while the scrubber is off */
+    uint32_t scrub_bytes_per_sec;            /**< Scrubber bandwidth ceiling */
+    uint32_t scrub_period_us;                /**< Scrubber tick period */
+    uint8_t scrub_slice_digits;              /**< DCRAM/ADRAM digits per scrub slice */
+    uint8_t scrub_region;                    /**< Region (RAM or control registers) of the next scrub slice */
+    uint8_t scrub_index;                     /**< Digit, character or register of the next scrub slice */
+    int64_t scrub_credit;                    /**< Bytes the scrubber may send, in 1/1000000 byte */
+    ftb8md_scrub_stats_t scrub_stats;        /**< Scrubber statistics */
+    esp_timer_handle_t dither_timer;         /**< Dithering frame timer, NULL while dithering is off */
+    uint8_t dither_levels;                   /**< Frames per dithering cycle */
+    uint8_t dither_frame;                    /**< Current frame of the cycle */
+    uint8_t dither_blanked;                  /**< Digits the ditherer has blanked on the panel */
+    uint8_t dither_level[FTB8MD_NUM_DIGITS]; /**< Intensity per digit */
+    uint32_t dither_frame_us;                /**< Length of one frame */
+    uint8_t session_depth;                   /**< Nesting depth of ftb8md_bus_acquire() */
+    bool session_bus_held;                   /**< The session also holds the SPI bus */
+    struct ftb8md_par *par;                  /**< Parallel group the panel is clocked by, NULL for SPI */
+    uint8_t par_lane;                        /**< Data line of the panel in its group */
+#if FTB8MD_COST_ENABLED
+    bool cost_active;                        /**< Commands sent are added to cost */
+    ftb8md_cost_model_t cost_model;          /**< Bus timing of the cost count */
+    ftb8md_cost_t cost;                      /**< Cost since ftb8md_cost_begin() */
+#endif
+} ftb8md_panel_t;
+
+/** @brief Panel slots, indexed as reported in traces */
+extern ftb8md_panel_t ftb8md_panels[FTB8MD_MAX_PANELS];
+
+/**
+ * @brief Look up the driver state of a registered panel.
+ *
+ * With a single panel slot and argument checks off (FTB8MD_CHECK_LEVEL 0)
+ * the handle is trusted and the lookup is a constant.
+ *
+ * @param handle SPI device handle returned by ftb8md_device_register()
+ * @return Panel state, or NULL if the handle is not registered
+ */
+static inline ftb8md_panel_t *ftb8md_panel_get(spi_device_handle_t handle)
+{
+#if FTB8MD_MAX_PANELS == 1 && FTB8MD_CHECK_LEVEL == 0
+    (void)handle;
+    return &ftb8md_panels[0];
+#else
+    if (handle == NULL)
+    {
+        return NULL;
+    }
+
+    for (int i = 0; i < FTB8MD_MAX_PANELS; i++)
+    {
+        if (ftb8md_panels[i].spi == handle)
+        {
+            return &ftb8md_panels[i];
+        }
+    }
+
+    return NULL;
+#endif
+}
+
+/**
+ * @brief Index of a panel's slot, as reported in traces.
+ */
+static inline int ftb8md_panel_index(const ftb8md_panel_t *panel)
+{
+    return (int)(panel - ftb8md_panels);
+}
+
+/**
+ * @brief Forget the digits a DCRAM write shows again where the ditherer had blanked them.
+ *
+ * @param panel Panel state (locked)
+ * @param cmd Encoded command
+ * @param len Length of the command in bytes
+ */
+static inline void ftb8md_panel_dither_unblank(ftb8md_panel_t *panel, const uint8_t *cmd, size_t len)
+{
+    if ((cmd[0] >> 5) != CMD_PREFIX_DCRAM)
+    {
+        return;
+    }
+
+    unsigned first = cmd[0] & 0x1F;
+    for (size_t i = 1; i < len && first + i - 1 < FTB8MD_NUM_DIGITS; i++)
+    {
+        panel->dither_blanked &= ~(1u << (first + i - 1));
+    }
+}
+
+/**
+ * @brief Claim a free panel slot.
+ *
+ * @param handle Device handle (SPI device, or lane handle of a parallel group)
+ * @param host SPI host the device was added to
+ * @param known_reset_state true if the panel was just reset, so its RAM contents are known
+ * @return Panel state, or NULL if all slots are in use
+ */
+ftb8md_panel_t *ftb8md_panel_alloc(spi_device_handle_t handle, spi_host_device_t host, bool known_reset_state);
+
+/**
+ * @brief Stop the timers of a panel and release its slot.
+ */
+void ftb8md_panel_free(ftb8md_panel_t *panel);
+
+/**
+ * @brief Take the panel lock.
+ *
+ * The lock is recursive, so ftb8md_panel_send() may be called while it is held.
+ * Hold it across a read of the shadow and the writes that depend on it.
+ * Taking the lock also invalidates shadow entries whose queued write failed.
+ * For a panel of a parallel group the group lock is taken first, so a task
+ * with an open frame on the group is never waited for with the panel held.
+ */
+void ftb8md_panel_lock(ftb8md_panel_t *panel);
+
+/**
+ * @brief Take the panel lock, giving up if another task holds it for longer than the timeout.
+ *
+ * @param panel Panel state
+ * @param timeout Maximum time to wait in ticks (0 to not wait)
+ * @return true if the lock was taken
+ */
+bool ftb8md_panel_trylock(ftb8md_panel_t *panel, TickType_t timeout);
+
+/**
+ * @brief Delay before a one-shot timer callback that found its panel locked tries again, in microseconds.
+ *
+ * Callbacks run on the esp_timer task and must not wait for the panel lock.
+ */
+#define FTB8MD_LOCK_RETRY_US 1000
+
+/**
+ * @brief Release the panel lock.
+ */
+void ftb8md_panel_unlock(ftb8md_panel_t *panel);
+
+/**
+ * @brief Transmit a command and record its effect in the shadow.
+ *
+ * While the scheduler is running the command is queued instead, and the
+ * shadow is updated when it is queued.
+ *
+ * @param panel Panel state
+ * @param cmd Encoded command (up to FTB8MD_CMD_MAX_LEN bytes)
+ * @param len Length of the command in bytes
+ * @return ESP_OK on success, or an error code on failure
+ */
+esp_err_t ftb8md_panel_send(ftb8md_panel_t *panel, const uint8_t *cmd, size_t len);
+
+/**
+ * @brief Write per-digit DCRAM or ADRAM data, sending only digits that differ from the shadow.
+ *
+ * Changed digits are sent as runs of consecutive addresses; runs separated by
+ * a single unchanged digit are merged, since resending that digit costs less
+ * than starting another transaction.
+ *
+ * @param panel Panel state
+ * @param prefix CMD_PREFIX_DCRAM or CMD_PREFIX_ADRAM
+ * @param data One value per digit (FTB8MD_NUM_DIGITS entries)
+ * @param mask Bit N set to write digit N
+ * @return ESP_OK on success, or an error code on failure
+ */
+esp_err_t ftb8md_panel_write_diff(ftb8md_panel_t *panel, uint8_t prefix, const uint8_t *data, uint8_t mask);
+
+/**
+ * @brief Put a command on the wire without touching the shadow.
+ *
+ * @param panel Panel state
+ * @param cmd Encoded command
+ * @param len Length of the command in bytes
+ * @return ESP_OK on success, or an error code on failure
+ */
+esp_err_t ftb8md_panel_transmit(ftb8md_panel_t *panel, const uint8_t *cmd, size_t len);
+
+/**
+ * @brief Check whether a control command would set a register to the value the panel already has.
+ *
+ * @param panel Panel state
+ * @param cmd Encoded command
+ * @param len Length of the command in bytes
+ * @return true for control commands matching the last transmitted value
+ */
+bool ftb8md_panel_ctrl_redundant(ftb8md_panel_t *panel, const uint8_t *cmd, size_t len);
+
+/**
+ * @brief Report that a command already recorded in the shadow did not reach the panel.
+ *
+ * Safe to call without the panel lock; the affected entries are marked
+ * unknown the next time the lock is taken.
+ *
+ * @param panel Panel state
+ * @param cmd Encoded command
+ * @param len Length of the command in bytes
+ */
+void ftb8md_panel_mark_lost(ftb8md_panel_t *panel, const uint8_t *cmd, size_t len);
+
+/**
+ * @brief Transmit a command within the bus budget of its SPI host.
+ *
+ * Waits while the budget is used up and splits the command if it is longer
+ * than the budget allows.
+ *
+ * @param host SPI host of the device
+ * @param spi SPI device
+ * @param cmd Encoded command
+ * @param len Length of the command in bytes
+ * @return ESP_OK on success, or an error code on failure
+ */
+esp_err_t ftb8md_bus_transmit(spi_host_device_t host, spi_device_handle_t spi, const uint8_t *cmd, size_t len);
+
+/**
+ * @brief Record a transmitted command in the wire state used by ftb8md_panel_ctrl_redundant().
+ */
+void ftb8md_panel_wire_update(ftb8md_panel_t *panel, const uint8_t *cmd, size_t len);
+
+#if FTB8MD_SCHED_ENABLED
+/**
+ * @brief Check whether commands are currently queued rather than transmitted.
+ */
+bool ftb8md_sched_running(void);
+
+/**
+ * @brief Check whether the scheduler has nothing queued or in flight.
+ */
+bool ftb8md_sched_idle(void);
+
+/**
+ * @brief Queue a command for the scheduler worker.
+ *
+ * Blocks while the queue is full. The deadline comes from the write options
+ * of the calling task.
+ *
+ * @param panel Panel state
+ * @param cmd Encoded command (CGRAM bursts are split per character)
+ * @param len Length of the command in bytes
+ * @param prio Priority class (ftb8md_priority_t), or -1 for the write options of the calling task
+ * @param refresh true to send control commands even if the panel already holds the value
+ * @return ESP_OK on success, or an error code on failure
+ */
+esp_err_t ftb8md_sched_submit(ftb8md_panel_t *panel, const uint8_t *cmd, size_t len, int prio, bool refresh);
+#else
+static inline bool ftb8md_sched_running(void)
+{
+    return false;
+}
+
+static inline bool ftb8md_sched_idle(void)
+{
+    return true;
+}
+
+static inline esp_err_t ftb8md_sched_submit(ftb8md_panel_t *panel, const uint8_t *cmd, size_t len, int prio,
+                                            bool refresh)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+#endif
+
+#if FTB8MD_PAR_ENABLED
+/**
+ * @brief Send a command to one panel of a parallel group.
+ *
+ * @param panel Panel of a parallel group
+ * @param cmd Encoded command
+ * @param len Length of the command in bytes
+ * @return ESP_OK on success, or an error code on failure
+ */
+esp_err_t ftb8md_par_transmit(ftb8md_panel_t *panel, const uint8_t *cmd, size_t len);
+
+/**
+ * @brief Take the lock of the panel's parallel group (recursive).
+ *
+ * @param panel Panel of a parallel group
+ * @param timeout Maximum time to wait in ticks
+ * @return true if the lock was taken
+ */
+bool ftb8md_par_lock(ftb8md_panel_t *panel, TickType_t timeout);
+
+/**
+ * @brief Release the lock of the panel's parallel group.
+ */
+void ftb8md_par_unlock(ftb8md_panel_t *panel);
+
+/**
+ * @brief Collect a command for the frame the calling task has open on the panel's group.
+ *
+ * Must be called with the panel lock held.
+ *
+ * @param panel Panel of a parallel group
+ * @param cmd Encoded command
+ * @param len Length of the command in bytes
+ * @return true if the command was collected, false if it has to be sent now
+ */
+bool ftb8md_par_defer(ftb8md_panel_t *panel, const uint8_t *cmd, size_t len);
+#else
+static inline esp_err_t ftb8md_par_transmit(ftb8md_panel_t *panel, const uint8_t *cmd, size_t len)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+static inline bool ftb8md_par_lock(ftb8md_panel_t *panel, TickType_t timeout)
+{
+    return true;
+}
+
+static inline void ftb8md_par_unlock(ftb8md_panel_t *panel)
+{
+}
+
+static inline bool ftb8md_par_defer(ftb8md_panel_t *panel, const uint8_t *cmd, size_t len)
+{
+    return false;
+}
+#endif
+
+#if FTB8MD_TRACE_ENABLED
+/**
+ * @brief Pass a command to the trace callback, if any.
+ *
+ * @param panel Panel the command is for
+ * @param kind FTB8MD_TRACE_TX once sent, FTB8MD_TRACE_CALL when issued by the calling task
+ * @param cmd Encoded command
+ * @param len Length of the command in bytes
+ */
+void ftb8md_trace_emit(const ftb8md_panel_t *panel, ftb8md_trace_kind_t kind, const uint8_t *cmd, size_t len);
+#else
+static inline void ftb8md_trace_emit(const ftb8md_panel_t *panel, ftb8md_trace_kind_t kind, const uint8_t *cmd,
+                                     size_t len)
+{
+}
+#endif
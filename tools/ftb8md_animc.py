@@ -0,0 +1,277 @@
+#!/usr/bin/env python3
+"""
+Animation compiler for the Futaba 8-MD-06INK VFD driver.
+
+Compiles a text timeline into the binary format played by
+ftb8md_anim_play() (see ftb-8-md-anim.h). Only values that change from one
+frame to the next are stored, so a frame costs a few bytes of flash.
+
+Source format
+-------------
+One statement per line; lines starting with ';' are comments. Statements up to the next
+"frame" belong to the current frame.
+
+  loop                      restart from the first frame at the end
+  glyphs FILE               load named glyphs from an ASCII-art .txt file
+                            (the format of tools/ftb8md_fontc.py)
+  frame MS                  start a new frame, shown for MS milliseconds
+  text DIGIT "STRING"       ROM characters from DIGIT on ("\\xNN" escapes allowed)
+  char DIGIT CODE           one character code, e.g. 0-7 for CGRAM characters
+  dot DIGIT on|off          decimal point of a digit
+  adram DIGIT VALUE         raw ADRAM value (segment pins E3-E0)
+  cgram SLOT GLYPH          load a glyph into CGRAM character SLOT: a name
+                            (spaces as "_") or U+XXXX from a glyphs file,
+                            5 column bytes, or
+                            nothing followed by 7 rows of 5 "#"/"." characters
+  dim LEVEL                 dimming level (0-240)
+
+A looping timeline restarts with the first frame, so that frame should set
+everything the later frames change.
+
+Examples
+--------
+  ftb8md_animc.py charging.txt -o charging.bin
+  parttool.py write_partition --partition-name anim --input charging.bin
+
+  ftb8md_animc.py charging.txt --header charging_anim.h --name charging_anim
+"""
+
+import argparse
+import ast
+import os
+import struct
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from ftb8md_fontc import GLYPH_COLS, GLYPH_ROWS, c_identifier, load_txt, rows_to_cols  # noqa: E402
+
+NUM_DIGITS = 8
+NUM_CGRAM = 8
+MAX_DIMMING = 240
+
+MAGIC = b'FTBA'
+VERSION = 1
+FLAG_LOOP = 1 << 0
+
+OP_END = 0x00
+OP_WAIT = 0x01
+OP_DCRAM = 0x02
+OP_ADRAM = 0x03
+OP_CGRAM = 0x04
+OP_DIMMING = 0x05
+
+
+def fail(msg):
+    sys.exit('ftb8md_animc: error: ' + msg)
+
+
+def parse_int(text, lo, hi, what, where):
+    try:
+        value = int(text, 0)
+    except ValueError:
+        fail('%s: %s must be a number' % (where, what))
+    if not lo <= value <= hi:
+        fail('%s: %s must be %d-%d' % (where, what, lo, hi))
+    return value
+
+
+class Frame:
+    def __init__(self, hold_ms):
+        self.hold_ms = hold_ms
+        self.dcram = {}
+        self.adram = {}
+        self.cgram = {}
+        self.dimming = None
+
+
+def parse(path):
+    with open(path, encoding='utf-8') as f:
+        lines = ['' if l.lstrip().startswith(';') else l.rstrip() for l in f]
+
+    glyphs = {}
+    frames = []
+    loop = False
+    dots = [0] * NUM_DIGITS
+
+    i = 0
+    while i < len(lines):
+        lineno = i + 1
+        where = '%s:%d' % (path, lineno)
+        words = lines[i].split(None, 2)
+        i += 1
+        if not words:
+            continue
+
+        cmd = words[0].lower()
+        args = words[1:]
+
+        if cmd == 'loop':
+            loop = True
+            continue
+        if cmd == 'glyphs':
+            if not args:
+                fail('%s: glyphs needs a file name' % where)
+            for g in load_txt(os.path.join(os.path.dirname(path), ' '.join(args))):
+                glyphs[c_identifier(g.name)] = g.cols
+                glyphs['U+%04X' % g.codepoint] = g.cols
+            continue
+        if cmd == 'frame':
+            if len(args) != 1:
+                fail('%s: frame needs a duration in ms' % where)
+            frames.append(Frame(parse_int(args[0], 0, 0xFFFFFFFF, 'duration', where)))
+            continue
+
+        if not frames:
+            fail('%s: "%s" before the first frame' % (where, cmd))
+        frame = frames[-1]
+
+        if cmd == 'text':
+            if len(args) != 2:
+                fail('%s: text needs a digit and a quoted string' % where)
+            digit = parse_int(args[0], 0, NUM_DIGITS - 1, 'digit', where)
+            try:
+                text = ast.literal_eval(args[1])
+            except (ValueError, SyntaxError):
+                fail('%s: text must be a quoted string' % where)
+            if not isinstance(text, str) or any(ord(c) > 0xFF for c in text):
+                fail('%s: text must be a string of 8-bit character codes' % where)
+            for n, c in enumerate(text[:NUM_DIGITS - digit]):
+                frame.dcram[digit + n] = ord(c)
+        elif cmd == 'char':
+            if len(args) != 2:
+                fail('%s: char needs a digit and a code' % where)
+            frame.dcram[parse_int(args[0], 0, NUM_DIGITS - 1, 'digit', where)] = \
+                parse_int(args[1], 0, 0xFF, 'code', where)
+        elif cmd == 'dot':
+            if len(args) != 2 or args[1].lower() not in ('on', 'off'):
+                fail('%s: dot needs a digit and on/off' % where)
+            digit = parse_int(args[0], 0, NUM_DIGITS - 1, 'digit', where)
+            dots[digit] = (dots[digit] & ~1) | (args[1].lower() == 'on')
+            frame.adram[digit] = dots[digit]
+        elif cmd == 'adram':
+            if len(args) != 2:
+                fail('%s: adram needs a digit and a value' % where)
+            digit = parse_int(args[0], 0, NUM_DIGITS - 1, 'digit', where)
+            dots[digit] = parse_int(args[1], 0, 0x0F, 'value', where)
+            frame.adram[digit] = dots[digit]
+        elif cmd == 'cgram':
+            if not args:
+                fail('%s: cgram needs a character index' % where)
+            slot = parse_int(args[0], 0, NUM_CGRAM - 1, 'character', where)
+            spec = args[1].split() if len(args) > 1 else []
+            if len(spec) == GLYPH_COLS:
+                cols = [parse_int(c, 0, 0x7F, 'column', where) for c in spec]
+            elif len(spec) == 1:
+                cols = glyphs.get(spec[0].upper()) or glyphs.get(c_identifier(spec[0]))
+                if cols is None:
+                    fail('%s: unknown glyph "%s"' % (where, spec[0]))
+            elif not spec:
+                rows = [l.strip() for l in lines[i:i + GLYPH_ROWS]]
+                if len(rows) != GLYPH_ROWS or any(len(r) != GLYPH_COLS or set(r) - set('#.') for r in rows):
+                    fail('%s: expected %d rows of %d "#"/"." characters' % (where, GLYPH_ROWS, GLYPH_COLS))
+                cols = rows_to_cols([[c == '#' for c in r] for r in rows])
+                i += GLYPH_ROWS
+            else:
+                fail('%s: cgram needs a glyph name, 5 column bytes or ASCII art' % where)
+            frame.cgram[slot] = list(cols)
+        elif cmd == 'dim':
+            if len(args) != 1:
+                fail('%s: dim needs a level' % where)
+            frame.dimming = parse_int(args[0], 0, MAX_DIMMING, 'level', where)
+        else:
+            fail('%s: unknown statement "%s"' % (where, cmd))
+
+    if not frames:
+        fail('%s: no frames' % path)
+    if loop and sum(f.hold_ms for f in frames) == 0:
+        fail('%s: a looping timeline needs a frame with a duration' % path)
+
+    return frames, loop
+
+
+def runs(changes):
+    """Group {index: value} into runs of consecutive indices."""
+    out = []
+    for index in sorted(changes):
+        if out and out[-1][0] + len(out[-1][1]) == index:
+            out[-1][1].append(changes[index])
+        else:
+            out.append((index, [changes[index]]))
+    return out
+
+
+def encode(frames, loop):
+    state = {'dcram': {}, 'adram': {}, 'cgram': {}, 'dimming': None}
+    body = bytearray()
+
+    for frame in frames:
+        # Keep only what differs from the previous frame
+        for kind in ('dcram', 'adram', 'cgram'):
+            changes = getattr(frame, kind)
+            for index in list(changes):
+                if state[kind].get(index) == changes[index]:
+                    del changes[index]
+            state[kind].update(changes)
+
+        for first, glyphs in runs(frame.cgram):
+            body += bytes([OP_CGRAM, first, len(glyphs)]) + bytes(c for g in glyphs for c in g)
+        if frame.dimming is not None and frame.dimming != state['dimming']:
+            body += bytes([OP_DIMMING, frame.dimming])
+            state['dimming'] = frame.dimming
+        for op, kind in ((OP_DCRAM, frame.dcram), (OP_ADRAM, frame.adram)):
+            for first, values in runs(kind):
+                body += bytes([op, first, len(values)]) + bytes(values)
+
+        hold = frame.hold_ms
+        while True:
+            body += struct.pack('<BH', OP_WAIT, min(hold, 0xFFFF))
+            hold -= min(hold, 0xFFFF)
+            if hold == 0:
+                break
+
+    body += bytes([OP_END])
+    header = MAGIC + struct.pack('<BBHI', VERSION, FLAG_LOOP if loop else 0, min(len(frames), 0xFFFF), len(body))
+    return header + body
+
+
+def render_header(data, path, name, source):
+    out = ['/**', ' * @file %s' % os.path.basename(path), ' * @brief Animation compiled from %s.' % source, ' *',
+           ' * Generated by tools/ftb8md_animc.py from %s. Do not edit.' % source, ' */', '',
+           '#pragma once', '', '#include <stdint.h>', '']
+    out.append('static const uint8_t %s[] = {' % name)
+    for off in range(0, len(data), 12):
+        out.append('    %s,' % ', '.join('0x%02X' % b for b in data[off:off + 12]))
+    out.append('};')
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('input', help='timeline source file')
+    parser.add_argument('-o', '--output', help='write the binary animation (for a data partition) to this file')
+    parser.add_argument('--header', help='write the animation as a C array to this header')
+    parser.add_argument('--name', help='C name of the array in --header (default: file name)')
+    args = parser.parse_args()
+
+    if not args.output and not args.header:
+        fail('nothing to do, give --output and/or --header')
+
+    frames, loop = parse(args.input)
+    duration = sum(f.hold_ms for f in frames)
+    data = encode(frames, loop)
+
+    if args.output:
+        with open(args.output, 'wb') as f:
+            f.write(data)
+
+    if args.header:
+        name = args.name or os.path.splitext(os.path.basename(args.header))[0].replace('-', '_')
+        out = render_header(data, args.header, name, os.path.relpath(args.input))
+        with open(args.header, 'w', encoding='utf-8') as f:
+            f.write('\n'.join(out) + '\n')
+
+    print('%s: %d frames, %d ms%s, %d bytes' % (args.input, len(frames), duration, ' (loop)' if loop else '', len(data)))
+
+
+if __name__ == '__main__':
+    main()
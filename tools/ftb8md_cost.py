@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+"""
+Bus cost estimator for the Futaba 8-MD-06INK VFD driver.
+
+Computes bytes, transactions, wire time and achievable frame rate of a
+command stream, with the same timing model as ftb8md_cost_add() (see
+ftb-8-md-cost.h): every byte takes 8 clock cycles, every transaction adds
+a fixed overhead for CS setup and driver latency.
+
+Input
+-----
+A trace written by ftb8md_trace_print() (see ftb-8-md-trace.h), or with
+--hex one command per line as hex bytes (e.g. "20 48 45 4C 4C 4F").
+
+The trace is cut into frames: a frame is a burst of commands to one panel,
+ended by a pause of more than --gap-ms. Plain hex input is a single frame.
+With --shared, all panels are on one SPI host and their commands form the
+frames together.
+
+Budget check
+------------
+--fps F fails (exit status 1) when the most expensive frame cannot be
+repeated F times per second within --share percent of the bus, so CI can
+reject screen designs that would exceed the bus budget.
+
+Examples
+--------
+  tools/ftb8md_cost.py trace.log
+  tools/ftb8md_cost.py trace.log --fps 30 --share 50
+  printf '2048454C4C4F202020\\nE4F0\\n' | tools/ftb8md_cost.py --hex
+"""
+
+import argparse
+import os
+import re
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from ftb8md_sim import CLOCK_HZ, TXN_OVERHEAD_US, records, wire_us  # noqa: E402
+
+
+def fail(msg):
+    sys.exit('ftb8md_cost: error: ' + msg)
+
+
+class Cost:
+    def __init__(self):
+        self.transactions = 0
+        self.bytes = 0
+        self.wire_us = 0
+
+    def add(self, length, wire):
+        self.transactions += 1
+        self.bytes += length
+        self.wire_us += wire
+
+    def __str__(self):
+        return '%d transactions, %d bytes, %d us' % (self.transactions, self.bytes, self.wire_us)
+
+
+def frame_rate(frame, share):
+    """Whole frames per second within the share of the bus, like ftb8md_cost_frame_rate()."""
+    return int(share * 1000000 // frame.wire_us) if frame.wire_us else float('inf')
+
+
+def hex_records(files):
+    streams = [open(p, encoding='utf-8') for p in files] if files else [sys.stdin]
+    for stream in streams:
+        for lineno, line in enumerate(stream, 1):
+            text = re.sub(r'(0x|,|\s)', '', line.split('#')[0])
+            if not text:
+                continue
+            if not re.fullmatch(r'[0-9A-Fa-f]+', text) or len(text) % 2:
+                fail('%s:%d: expected hex bytes' % (getattr(stream, 'name', '-'), lineno))
+            yield 0, None, bytes.fromhex(text)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('inputs', nargs='*', help='trace files (default: stdin)')
+    parser.add_argument('--hex', action='store_true', help='input is one hex command per line')
+    parser.add_argument('--gap-ms', type=float, default=5.0,
+                        help='pause that ends a frame (default 5 ms)')
+    parser.add_argument('--shared', action='store_true', help='all panels share one SPI host')
+    parser.add_argument('--clock', type=int, default=CLOCK_HZ, help='SPI clock in Hz (default 500000)')
+    parser.add_argument('--overhead-us', type=int, default=TXN_OVERHEAD_US,
+                        help='time per transaction besides the clocked bytes (default %d)' % TXN_OVERHEAD_US)
+    parser.add_argument('--share', type=float, default=100.0,
+                        help='percentage of the bus the frames may take (default 100)')
+    parser.add_argument('--fps', type=float, help='fail if the most expensive frame cannot reach this rate')
+    args = parser.parse_args()
+
+    if args.clock <= 0 or not 0 < args.share <= 100:
+        fail('--clock must be positive and --share in (0, 100]')
+
+    gap_us = args.gap_ms * 1000
+    buses = {}
+    for slot, stamp, cmd in (hex_records if args.hex else records)(args.inputs):
+        if not cmd:
+            continue
+        bus = buses.setdefault('all' if args.shared else slot,
+                               {'total': Cost(), 'frames': [], 'first': stamp, 'last': None, 'busy': None})
+        wire = wire_us(len(cmd), args.clock, args.overhead_us)
+
+        # A new frame starts after a pause, measured from when the previous command left the wire
+        if stamp is None:
+            if not bus['frames']:
+                bus['frames'].append(Cost())
+        elif bus['busy'] is None or stamp - bus['busy'] > gap_us:
+            bus['frames'].append(Cost())
+        if stamp is not None:
+            bus['busy'] = max(stamp, bus['busy'] or stamp) + wire
+            bus['last'] = stamp
+
+        bus['frames'][-1].add(len(cmd), wire)
+        bus['total'].add(len(cmd), wire)
+
+    if not buses:
+        fail('no commands found')
+
+    share = args.share / 100
+    ok = True
+    for key in sorted(buses, key=str):
+        bus = buses[key]
+        frames = bus['frames']
+        worst = max(frames, key=lambda f: f.wire_us)
+        fps = frame_rate(worst, share)
+
+        print('%s:' % ('all panels' if key == 'all' else 'panel %d' % key))
+        print('  total       %s' % bus['total'])
+        if bus['first'] is not None and bus['last'] > bus['first']:
+            span = bus['busy'] - bus['first']
+            print('  bus load    %.1f%% over %.3f s' % (100 * bus['total'].wire_us / span, span / 1e6))
+        print('  frames      %d, mean %.0f bytes / %.0f us' %
+              (len(frames), bus['total'].bytes / len(frames), bus['total'].wire_us / len(frames)))
+        print('  worst frame %s' % worst)
+        print('  frame rate  %s fps at %g%% of the bus' % ('unlimited' if fps == float('inf') else fps, args.share))
+        if args.fps is not None and fps < args.fps:
+            print('  OVER BUDGET: %g fps needs %.0f us per frame, the worst frame takes %d us' %
+                  (args.fps, share * 1e6 / args.fps, worst.wire_us))
+            ok = False
+
+    sys.exit(0 if ok else 1)
+
+
+if __name__ == '__main__':
+    main()
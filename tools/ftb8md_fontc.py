@@ -0,0 +1,285 @@
+#!/usr/bin/env python3
+"""
+Font compiler for the Futaba 8-MD-06INK VFD driver.
+
+Converts BDF fonts, PNG icon sheets and ASCII-art glyph files into glyph
+tables in the layout of ``ftb8md_glyph_table_t`` (see ftb-8-md-font.h):
+
+  - one byte per column, 5 columns per glyph, bit 0 = top row
+    (the layout ftb8md_write_custom_char() expects)
+  - code points in a separate array sorted ascending, so
+    ftb8md_glyph_find() can binary search it in place from flash
+
+Input formats
+-------------
+*.txt   ASCII art. Blocks separated by blank lines, each block is a header
+        line "U+XXXX NAME" followed by 7 rows of 5 characters, '#' for a lit
+        pixel and '.' for an unlit one. Lines starting with ';' are comments.
+*.bdf   Glyph Bitmap Distribution Format. Glyphs are placed in the 5x7 cell
+        on the font baseline; glyphs that do not fit are rejected unless
+        --clip is given.
+*.png   Icon sheet (requires Pillow). Cells of 5x7 pixels laid out row-major
+        with --pitch-x/--pitch-y spacing; dark pixels are lit unless --invert.
+        Code points are assigned from --first (default U+E000, Private Use
+        Area); --names gives each icon a name for the generated #defines.
+
+Examples
+--------
+  ftb8md_fontc.py tools/fonts/extended.txt --name ftb8md_glyphs_extended \\
+      --brief "Built-in glyphs for code points that are not in the panel ROM." \\
+      --source ftb-8-md-glyphs.c
+
+  ftb8md_fontc.py icons.png --names HEART,SMILEY --name app_icons \\
+      --source icons.c --header icons.h
+"""
+
+import argparse
+import os
+import re
+import sys
+
+GLYPH_COLS = 5
+GLYPH_ROWS = 7
+
+
+class Glyph:
+    def __init__(self, codepoint, name, cols):
+        self.codepoint = codepoint
+        self.name = name
+        self.cols = cols
+
+
+def rows_to_cols(rows):
+    """Convert 7 rows of 5 booleans into 5 column bytes (bit 0 = top row)."""
+    return [sum(1 << y for y in range(GLYPH_ROWS) if rows[y][x]) for x in range(GLYPH_COLS)]
+
+
+def fail(msg):
+    sys.exit('ftb8md_fontc: error: ' + msg)
+
+
+def load_txt(path):
+    glyphs = []
+    with open(path, encoding='utf-8') as f:
+        lines = [l.rstrip('\n') for l in f]
+
+    block = []
+    for lineno, line in enumerate(lines + [''], 1):
+        # Comments are skipped here, not filtered out beforehand, so line numbers match the file
+        if line.startswith(';'):
+            continue
+        if line.strip():
+            block.append((lineno, line))
+            continue
+        if not block:
+            continue
+
+        head_no, head = block[0]
+        m = re.match(r'U\+([0-9A-Fa-f]{4,6})\s*(.*)$', head.strip())
+        if not m:
+            fail('%s:%d: expected "U+XXXX NAME"' % (path, head_no))
+        rows = [l for _, l in block[1:]]
+        if len(rows) != GLYPH_ROWS or any(len(r) != GLYPH_COLS or set(r) - set('#.') for r in rows):
+            fail('%s:%d: glyph must be %d rows of %d "#"/"." characters' % (path, head_no, GLYPH_ROWS, GLYPH_COLS))
+
+        cols = rows_to_cols([[c == '#' for c in r] for r in rows])
+        glyphs.append(Glyph(int(m.group(1), 16), m.group(2).strip(), cols))
+        block = []
+
+    return glyphs
+
+
+def load_bdf(path, clip):
+    glyphs = []
+    ascent = GLYPH_ROWS
+    glyph = None
+
+    with open(path, encoding='latin-1') as f:
+        lines = iter(f.read().splitlines())
+
+    for line in lines:
+        words = line.split()
+        if not words:
+            continue
+        key = words[0]
+
+        if key == 'FONT_ASCENT':
+            ascent = int(words[1])
+        elif key == 'STARTCHAR':
+            glyph = {'name': ' '.join(words[1:])}
+        elif key == 'ENCODING' and glyph is not None:
+            glyph['encoding'] = int(words[1])
+        elif key == 'BBX' and glyph is not None:
+            glyph['bbx'] = [int(w) for w in words[1:5]]
+        elif key == 'BITMAP' and glyph is not None:
+            bitmap = []
+            for row in lines:
+                if row.strip() == 'ENDCHAR':
+                    break
+                bitmap.append(int(row.strip(), 16) if row.strip() else 0)
+            glyph['bitmap'] = bitmap
+            if glyph.get('encoding', -1) >= 0:
+                g = bdf_glyph(path, glyph, ascent, clip)
+                if g is not None:
+                    glyphs.append(g)
+            glyph = None
+
+    return glyphs
+
+
+def bdf_glyph(path, glyph, ascent, clip):
+    width, height, xoff, yoff = glyph['bbx']
+    # Baseline sits below the last row of the cell unless the font has no room for it
+    baseline = min(ascent, GLYPH_ROWS)
+    rows = [[False] * GLYPH_COLS for _ in range(GLYPH_ROWS)]
+    row_bytes = (width + 7) // 8
+
+    for i, bits in enumerate(glyph['bitmap']):
+        y = baseline - yoff - height + i
+        for x in range(width):
+            if not (bits >> (row_bytes * 8 - 1 - x)) & 1:
+                continue
+            cx = xoff + x
+            if 0 <= cx < GLYPH_COLS and 0 <= y < GLYPH_ROWS:
+                rows[y][cx] = True
+            elif not clip:
+                fail('%s: glyph %s (U+%04X) does not fit in %dx%d, use --clip' %
+                     (path, glyph['name'], glyph['encoding'], GLYPH_COLS, GLYPH_ROWS))
+
+    return Glyph(glyph['encoding'], glyph['name'], rows_to_cols(rows))
+
+
+def load_png(path, args):
+    try:
+        from PIL import Image
+    except ImportError:
+        fail('PNG input requires Pillow (pip install pillow)')
+
+    img = Image.open(path).convert('L')
+    pitch_x = args.pitch_x or GLYPH_COLS
+    pitch_y = args.pitch_y or GLYPH_ROWS
+    per_row = (img.width - GLYPH_COLS) // pitch_x + 1
+    rows_of_cells = (img.height - GLYPH_ROWS) // pitch_y + 1
+    names = args.names.split(',') if args.names else []
+    count = args.count or per_row * rows_of_cells
+
+    glyphs = []
+    for i in range(count):
+        ox = (i % per_row) * pitch_x
+        oy = (i // per_row) * pitch_y
+        if oy + GLYPH_ROWS > img.height:
+            fail('%s: sheet has fewer than %d cells' % (path, count))
+        rows = [[(img.getpixel((ox + x, oy + y)) < 128) != args.invert for x in range(GLYPH_COLS)]
+                for y in range(GLYPH_ROWS)]
+        name = names[i] if i < len(names) else 'ICON_%d' % i
+        glyphs.append(Glyph(args.first + i, name, rows_to_cols(rows)))
+
+    return glyphs
+
+
+def c_identifier(name):
+    return re.sub(r'[^0-9A-Za-z]+', '_', name).strip('_').upper()
+
+
+def render_table(glyphs, name, static):
+    storage = 'static ' if static else ''
+    stem = re.sub(r'^ftb8md_(glyphs_)?', '', name)
+    out = []
+    out.append('static const uint32_t s_%s_codepoints[] = {' % stem)
+    for g in glyphs:
+        out.append('    0x%04X, /* %s */' % (g.codepoint, g.name.lower()))
+    out.append('};')
+    out.append('')
+    out.append('static const uint8_t s_%s_glyphs[][FTB8MD_GLYPH_COLS] = {' % stem)
+    for g in glyphs:
+        out.append('    {%s}, /* U+%04X */' % (', '.join('0x%02X' % c for c in g.cols), g.codepoint))
+    out.append('};')
+    out.append('')
+    out.append('%sconst ftb8md_glyph_table_t %s = {' % (storage, name))
+    out.append('    .codepoints = s_%s_codepoints,' % stem)
+    out.append('    .glyphs = s_%s_glyphs,' % stem)
+    out.append('    .count = sizeof(s_%s_codepoints) / sizeof(s_%s_codepoints[0]),' % (stem, stem))
+    out.append('};')
+    return out
+
+
+def render_defines(glyphs, prefix):
+    return ['#define %s%s 0x%04X' % (prefix, c_identifier(g.name), g.codepoint) for g in glyphs if g.name]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('inputs', nargs='+', help='.txt, .bdf or .png input files')
+    parser.add_argument('--name', required=True, help='C name of the generated ftb8md_glyph_table_t')
+    parser.add_argument('--source', help='write the table definition to this .c file')
+    parser.add_argument('--header', help='write a header declaring the table (and code point defines)')
+    parser.add_argument('--header-only', action='store_true',
+                        help='put a static table into --header instead of emitting a .c file')
+    parser.add_argument('--brief', default='Glyph table.', help='@brief line of the generated files')
+    parser.add_argument('--define-prefix', default='', help='prefix for code point #defines in the header')
+    parser.add_argument('--range', help='only keep code points in this range, e.g. U+0020-U+00FF')
+    parser.add_argument('--clip', action='store_true', help='clip BDF glyphs larger than 5x7 instead of failing')
+    parser.add_argument('--first', type=lambda s: int(s.replace('U+', ''), 16), default=0xE000,
+                        help='first code point assigned to PNG icons (default U+E000)')
+    parser.add_argument('--names', help='comma separated names of PNG icons')
+    parser.add_argument('--count', type=int, help='number of PNG icons (default: all cells)')
+    parser.add_argument('--pitch-x', type=int, help='horizontal distance between PNG cells (default 5)')
+    parser.add_argument('--pitch-y', type=int, help='vertical distance between PNG cells (default 7)')
+    parser.add_argument('--invert', action='store_true', help='PNG: light pixels are lit')
+    args = parser.parse_args()
+
+    glyphs = []
+    for path in args.inputs:
+        ext = os.path.splitext(path)[1].lower()
+        if ext == '.txt':
+            glyphs += load_txt(path)
+        elif ext == '.bdf':
+            glyphs += load_bdf(path, args.clip)
+        elif ext == '.png':
+            glyphs += load_png(path, args)
+        else:
+            fail('%s: unsupported input format' % path)
+
+    if args.range:
+        lo, hi = (int(p.strip().replace('U+', ''), 16) for p in args.range.split('-'))
+        glyphs = [g for g in glyphs if lo <= g.codepoint <= hi]
+
+    by_cp = {}
+    for g in glyphs:
+        if g.codepoint in by_cp:
+            fail('duplicate glyph for U+%04X' % g.codepoint)
+        by_cp[g.codepoint] = g
+    glyphs = [by_cp[cp] for cp in sorted(by_cp)]
+
+    if not glyphs:
+        fail('no glyphs found')
+
+    inputs = ', '.join(os.path.relpath(p) for p in args.inputs)
+
+    def banner(path):
+        return ['/**', ' * @file %s' % os.path.basename(path), ' * @brief %s' % args.brief, ' *',
+                ' * Generated by tools/ftb8md_fontc.py from %s. Do not edit.' % inputs, ' */', '']
+
+    if args.header:
+        out = banner(args.header) + ['#pragma once', '', '#include "ftb-8-md-font.h"', '']
+        defines = render_defines(glyphs, args.define_prefix)
+        if defines:
+            out += defines + ['']
+        if args.header_only:
+            out += render_table(glyphs, args.name, static=True)
+        else:
+            out.append('extern const ftb8md_glyph_table_t %s;' % args.name)
+        with open(args.header, 'w', encoding='utf-8') as f:
+            f.write('\n'.join(out) + '\n')
+
+    if args.source and not args.header_only:
+        include = os.path.basename(args.header) if args.header else 'ftb-8-md-font.h'
+        out = banner(args.source) + ['#include "%s"' % include, ''] + render_table(glyphs, args.name, static=False)
+        with open(args.source, 'w', encoding='utf-8') as f:
+            f.write('\n'.join(out) + '\n')
+
+    print('%s: %d glyphs, %d bytes of rodata' % (args.name, len(glyphs), len(glyphs) * (4 + GLYPH_COLS)))
+
+
+if __name__ == '__main__':
+    main()
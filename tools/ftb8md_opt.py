@@ -0,0 +1,291 @@
+#!/usr/bin/env python3
+"""
+Trace optimiser for the Futaba 8-MD-06INK VFD driver.
+
+Replays the driver calls of a trace against a model of the panel, computes
+the shortest command stream that leaves the panel in the same state at the
+end of every frame, and reports how much bus time each call site wastes
+compared to it.
+
+Input
+-----
+A trace written by ftb8md_trace_print() (see ftb-8-md-trace.h). The
+"FTB8MD-CALL" lines hold the commands as the driver calls issued them,
+with the call site: the label set with ftb8md_trace_site() or
+FTB8MD_TRACE_HERE(), or the task name. With --wire the "FTB8MD-TX" lines
+(what reached the panel) are analysed instead.
+
+Frames
+------
+Commands to a panel form a frame until a pause of more than --gap-ms; only
+the panel contents at the end of each frame count, since nobody sees the
+states in between. --strict makes every command its own frame, so only
+writes that change nothing are optimised away.
+
+The minimal stream of a frame writes each changed digit, dot, CGRAM
+character and control register once. Neighbouring changes share a command
+where resending the unchanged entries between them is cheaper than another
+transaction, and only entries whose contents are known are resent.
+
+Waste per call site
+-------------------
+Each byte of the minimal stream is credited to the call that last changed
+the entry it writes; the command byte and transaction overhead to the call
+that wrote the first entry of the command. What a site sent beyond its
+credit is waste. Calls are also counted as
+  redundant     changed nothing the panel did not already show
+  overwritten   changed entries, but later calls of the frame changed them again
+
+Examples
+--------
+  tools/ftb8md_opt.py trace.log
+  tools/ftb8md_opt.py trace.log --emit minimal.log && tools/ftb8md_sim.py minimal.log --snapshot
+"""
+
+import argparse
+import os
+import re
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from ftb8md_fontc import GLYPH_COLS  # noqa: E402
+from ftb8md_sim import CLOCK_HZ, MAX_DIMMING, NUM_CGRAM, NUM_DIGITS, TXN_OVERHEAD_US, wire_us  # noqa: E402
+
+CALL_RE = re.compile(r'FTB8MD-CALL\s+(\d+)\s+(-?\d+)\s+([0-9A-Fa-f]+)[ \t]*(.*?)\s*$')
+TX_RE = re.compile(r'FTB8MD-TX\s+(\d+)\s+(-?\d+)\s+([0-9A-Fa-f]+)')
+
+# Entries of the panel model: (region, index)
+DCRAM, ADRAM, CGRAM, URAM = 'dcram', 'adram', 'cgram', 'uram'
+DIGIT_SET, DIMMING, POWER, STANDBY = 'digit_set', 'dimming', 'power', 'standby'
+
+RAM_OPS = {1: DCRAM, 2: CGRAM, 3: ADRAM}
+RAM_PREFIX = {DCRAM: 0x20, CGRAM: 0x40, ADRAM: 0x60}
+RAM_SIZE = {DCRAM: NUM_DIGITS, ADRAM: NUM_DIGITS, CGRAM: NUM_CGRAM}
+RAM_UNIT = {DCRAM: 1, ADRAM: 1, CGRAM: GLYPH_COLS}
+
+
+def fail(msg):
+    sys.exit('ftb8md_opt: error: ' + msg)
+
+
+def reset_state():
+    """Panel contents after RESET, as the driver assumes them."""
+    state = {}
+    for d in range(NUM_DIGITS):
+        state[(DCRAM, d)] = 0x20
+        state[(ADRAM, d)] = 0
+    for c in range(NUM_CGRAM):
+        state[(CGRAM, c)] = (0,) * GLYPH_COLS
+    state[(DIMMING, 0)] = 0
+    state[(POWER, 0)] = False
+    state[(STANDBY, 0)] = False
+    return state
+
+
+def effects(cmd, serial):
+    """Entries a command writes, as (key, value) pairs."""
+    op, addr = cmd[0] >> 5, cmd[0] & 0x1F
+    data = cmd[1:]
+
+    region = RAM_OPS.get(op)
+    if region == CGRAM:
+        slot = addr & 0x07
+        return [((CGRAM, slot + i // GLYPH_COLS), tuple(data[i:i + GLYPH_COLS]))
+                for i in range(0, len(data) - GLYPH_COLS + 1, GLYPH_COLS) if slot + i // GLYPH_COLS < NUM_CGRAM]
+    if region is not None:
+        return [((region, addr + i), v) for i, v in enumerate(data) if addr + i < NUM_DIGITS]
+    if op == 4:
+        # URAM is not modelled; each write is kept as it is
+        return [((URAM, serial), bytes(cmd))]
+    if cmd[0] & 0xFC == 0xE0 and data:
+        return [((DIGIT_SET, 0), data[0] & 0x07)]
+    if cmd[0] & 0xFC == 0xE4 and data:
+        return [((DIMMING, 0), min(data[0], MAX_DIMMING))]
+    if cmd[0] & 0xFC == 0xE8:
+        return [((POWER, 0), cmd[0] & 0x02 == 0)]
+    if cmd[0] & 0xFC == 0xEC:
+        return [((STANDBY, 0), cmd[0] & 0x01 != 0)]
+    return [((URAM, serial), bytes(cmd))]
+
+
+def encode(key, value):
+    """Command setting a single non-RAM entry."""
+    region = key[0]
+    if region == URAM:
+        return value
+    if region == DIGIT_SET:
+        return bytes([0xE0, value])
+    if region == DIMMING:
+        return bytes([0xE4, value])
+    if region == POWER:
+        return bytes([0xE8 if value else 0xEA, 0x00])
+    return bytes([0xED if value else 0xEC, 0x00])
+
+
+class Call:
+    def __init__(self, site, cmd, stamp):
+        self.site = site
+        self.cmd = cmd
+        self.stamp = stamp
+        self.changed = False
+        self.last = False
+
+
+class Site:
+    def __init__(self):
+        self.calls = 0
+        self.redundant = 0
+        self.overwritten = 0
+        self.sent_bytes = 0
+        self.sent_us = 0
+        self.needed_bytes = 0.0
+        self.needed_us = 0.0
+
+
+def minimal(changes, final, writer, clock, overhead):
+    """Shortest commands setting the changed entries; yields (cmd, [(call, bytes, us)])."""
+    byte_us = 8 * 1000000 / clock
+    out = []
+
+    for region in (CGRAM, DCRAM, ADRAM):
+        idx = sorted(i for r, i in changes if r == region)
+        unit = RAM_UNIT[region]
+        runs = []
+        for i in idx:
+            if runs:
+                first, last = runs[-1]
+                gap = range(last + 1, i)
+                # Resend unchanged known entries when that is cheaper than a new transaction
+                if all((region, g) in final for g in gap) and len(gap) * unit * byte_us <= overhead + byte_us:
+                    runs[-1] = (first, i)
+                    continue
+            runs.append((i, i))
+        for first, last in runs:
+            cmd = bytearray([RAM_PREFIX[region] | first])
+            credit = []
+            for i in range(first, last + 1):
+                value = final[(region, i)]
+                cmd += bytes(value) if region == CGRAM else bytes([value])
+                # Bridged entries are credited to the call that opened the command
+                who = writer.get((region, i)) if (region, i) in changes else writer[(region, first)]
+                credit.append((who, unit, unit * byte_us))
+            credit[0] = (credit[0][0], credit[0][1] + 1, credit[0][2] + overhead + byte_us)
+            out.append((bytes(cmd), credit))
+
+    for key in sorted((k for k in changes if k[0] not in RAM_SIZE), key=str):
+        cmd = encode(key, final[key])
+        out.append((cmd, [(writer[key], len(cmd), wire_us(len(cmd), clock, overhead))]))
+
+    return out
+
+
+def records(files, wire):
+    streams = [open(p, encoding='utf-8', errors='replace') for p in files] if files else [sys.stdin]
+    for stream in streams:
+        for line in stream:
+            m = (TX_RE if wire else CALL_RE).search(line)
+            if m and len(m.group(3)) % 2 == 0 and m.group(3):
+                site = '(wire)' if wire else (m.group(4) or '(unknown)')
+                yield int(m.group(1)), int(m.group(2)), bytes.fromhex(m.group(3)), site
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('inputs', nargs='*', help='trace files (default: stdin)')
+    parser.add_argument('--wire', action='store_true', help='analyse the sent commands instead of the calls')
+    parser.add_argument('--gap-ms', type=float, default=5.0, help='pause that ends a frame (default 5 ms)')
+    parser.add_argument('--strict', action='store_true', help='every command is a frame of its own')
+    parser.add_argument('--reset', action='store_true',
+                        help='panels start in their reset state (default: contents unknown)')
+    parser.add_argument('--clock', type=int, default=CLOCK_HZ, help='SPI clock in Hz (default 500000)')
+    parser.add_argument('--overhead-us', type=int, default=TXN_OVERHEAD_US,
+                        help='time per transaction besides the clocked bytes (default %d)' % TXN_OVERHEAD_US)
+    parser.add_argument('--top', type=int, default=20, help='call sites listed per panel (default 20)')
+    parser.add_argument('--emit', metavar='FILE', help='write the minimal stream as a trace')
+    args = parser.parse_args()
+
+    if args.clock <= 0:
+        fail('--clock must be positive')
+
+    panels = {}
+    for slot, stamp, cmd, site in records(args.inputs, args.wire):
+        panel = panels.setdefault(slot, [])
+        if not panel or args.strict or stamp - panel[-1][-1].stamp > args.gap_ms * 1000:
+            panel.append([])
+        panel[-1].append(Call(site, cmd, stamp))
+
+    if not panels:
+        fail('no %s records found' % ('FTB8MD-TX' if args.wire else 'FTB8MD-CALL'))
+
+    emit = open(args.emit, 'w', encoding='utf-8') if args.emit else None
+    serial = 0
+
+    for slot in sorted(panels):
+        state = reset_state() if args.reset else {}
+        sites = {}
+        sent = [0, 0, 0]
+        best = [0, 0, 0]
+
+        for frame in panels[slot]:
+            start = dict(state)
+            writer = {}
+            for call in frame:
+                serial += 1
+                for key, value in effects(call.cmd, serial):
+                    if state.get(key) != value or key not in state:
+                        state[key] = value
+                        writer[key] = call
+                        call.changed = True
+
+                s = sites.setdefault(call.site, Site())
+                s.calls += 1
+                s.sent_bytes += len(call.cmd)
+                s.sent_us += wire_us(len(call.cmd), args.clock, args.overhead_us)
+                sent[0] += 1
+                sent[1] += len(call.cmd)
+                sent[2] += wire_us(len(call.cmd), args.clock, args.overhead_us)
+
+            changes = {k for k in writer if start.get(k) != state[k] or k not in start}
+            for key in changes:
+                writer[key].last = True
+
+            for cmd, credit in minimal(changes, state, writer, args.clock, args.overhead_us):
+                best[0] += 1
+                best[1] += len(cmd)
+                best[2] += wire_us(len(cmd), args.clock, args.overhead_us)
+                for call, nbytes, us in credit:
+                    sites[call.site].needed_bytes += nbytes
+                    sites[call.site].needed_us += us
+                if emit:
+                    emit.write('FTB8MD-TX %d %d %s\n' % (slot, frame[-1].stamp, cmd.hex().upper()))
+
+            for call in frame:
+                if not call.changed:
+                    sites[call.site].redundant += 1
+                elif not call.last:
+                    sites[call.site].overwritten += 1
+
+        saved = 100 * (sent[2] - best[2]) / sent[2] if sent[2] else 0
+        print('panel %d: %d frames' % (slot, len(panels[slot])))
+        print('  sent     %6d transactions %7d bytes %9.1f ms' % (sent[0], sent[1], sent[2] / 1000))
+        print('  minimal  %6d transactions %7d bytes %9.1f ms  (%.0f%% less bus time)' %
+              (best[0], best[1], best[2] / 1000, saved))
+        print()
+        print('  %-32s %6s %9s %11s %8s %8s %10s' %
+              ('call site', 'calls', 'redundant', 'overwritten', 'sent B', 'wasted B', 'wasted ms'))
+        ranked = sorted(sites.items(), key=lambda kv: kv[1].needed_us - kv[1].sent_us)
+        for name, s in ranked[:args.top]:
+            label = name if len(name) <= 32 else '...' + name[-29:]
+            print('  %-32s %6d %9d %11d %8d %8.0f %10.2f' %
+                  (label, s.calls, s.redundant, s.overwritten, s.sent_bytes,
+                   s.sent_bytes - s.needed_bytes, (s.sent_us - s.needed_us) / 1000))
+        if len(ranked) > args.top:
+            print('  ... %d more' % (len(ranked) - args.top))
+        print()
+
+    if emit:
+        emit.close()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,348 @@
+#!/usr/bin/env python3
+"""
+Terminal simulator for the Futaba 8-MD-06INK VFD driver.
+
+Decodes the command stream the driver sends to the panels, as written by
+ftb8md_trace_print() (see ftb-8-md-trace.h), and renders the 8 digits,
+decimal points and CGRAM characters in the terminal. Every command is
+replayed with the wire time it takes at 500 kHz plus the per-transaction
+overhead, so the screen shows what the panel shows when it shows it, and
+a status line reports updates, visible frames, bytes and bus load per
+second. Digits written in the last moments are highlighted, and commands
+that change nothing on the panel are counted as redundant, so update
+storms stand out.
+
+Input
+-----
+Lines containing "FTB8MD-TX <panel> <time_us> <hex bytes>"; everything
+else (log output, boot messages) is ignored. Input is read from the files
+given or from stdin, so a running target can be watched live:
+
+  idf.py monitor | tools/ftb8md_sim.py
+
+Output modes
+------------
+(default)     Live ANSI rendering, paced by the trace time stamps and the
+              simulated wire time (--speed to replay faster or slower).
+--frames      Every visible change as plain text with its time, no pacing.
+--snapshot    Final panel contents and statistics as plain text, for CI.
+
+Examples
+--------
+  tools/ftb8md_sim.py trace.log --speed 0.25
+  tools/ftb8md_sim.py trace.log --snapshot > screen.txt
+  tools/ftb8md_sim.py trace.log --frames --panel 1
+"""
+
+import argparse
+import os
+import re
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from ftb8md_fontc import GLYPH_COLS, GLYPH_ROWS  # noqa: E402
+
+NUM_DIGITS = 8
+NUM_CGRAM = 8
+MAX_DIMMING = 240
+
+CLOCK_HZ = 500 * 1000
+TXN_OVERHEAD_US = 20
+
+TRACE_RE = re.compile(r'FTB8MD-TX\s+(\d+)\s+(-?\d+)\s+([0-9A-Fa-f]+)')
+
+# Character codes without a ROM glyph in the font table are drawn as a box
+BOX = [0x7F, 0x41, 0x41, 0x41, 0x7F]
+
+HIGHLIGHT_US = 150 * 1000
+REDRAW_US = 1000000 // 60
+
+
+def fail(msg):
+    sys.exit('ftb8md_sim: error: ' + msg)
+
+
+def load_rom(path):
+    """Read the ASCII glyphs from ftb-8-md-font.c, keyed by character code."""
+    rom = {}
+    with open(path, encoding='utf-8') as f:
+        for m in re.finditer(r'\{((?:\s*0x[0-9A-Fa-f]{2},?){%d})\s*\},?\s*/\*\s*0x([0-9A-Fa-f]{2})' % GLYPH_COLS,
+                             f.read()):
+            rom[int(m.group(2), 16)] = [int(b, 16) for b in re.findall(r'0x[0-9A-Fa-f]{2}', m.group(1))]
+    if not rom:
+        fail('%s: no glyphs found' % path)
+    return rom
+
+
+def wire_us(length, clock_hz, overhead_us):
+    return overhead_us + (length * 8 * 1000000 + clock_hz - 1) // clock_hz
+
+
+class Panel:
+    """Panel RAM and control registers, in their state after RESET."""
+
+    def __init__(self):
+        self.dcram = [0x20] * NUM_DIGITS
+        self.adram = [0] * NUM_DIGITS
+        self.cgram = [[0] * GLYPH_COLS for _ in range(NUM_CGRAM)]
+        self.digits = NUM_DIGITS
+        self.dimming = 0
+        self.power_on = False
+        self.standby = False
+        self.touched = [None] * NUM_DIGITS
+
+    def state(self):
+        return (tuple(self.dcram), tuple(self.adram), tuple(tuple(c) for c in self.cgram), self.digits,
+                self.dimming, self.power_on, self.standby)
+
+    def apply(self, cmd, now):
+        """Execute one command; returns False for unknown commands."""
+        op, addr = cmd[0] >> 5, cmd[0] & 0x1F
+        data = cmd[1:]
+
+        if op in (1, 3):
+            ram = self.dcram if op == 1 else self.adram
+            for i, value in enumerate(data):
+                if addr + i < NUM_DIGITS:
+                    ram[addr + i] = value
+                    self.touched[addr + i] = now
+        elif op == 2:
+            slot = addr & 0x07
+            for i in range(0, len(data) - GLYPH_COLS + 1, GLYPH_COLS):
+                if slot < NUM_CGRAM:
+                    self.cgram[slot] = list(data[i:i + GLYPH_COLS])
+                    for d in range(NUM_DIGITS):
+                        if self.dcram[d] == slot:
+                            self.touched[d] = now
+                slot += 1
+        elif op == 4:
+            pass  # URAM holds no visible state
+        elif cmd[0] & 0xFC == 0xE0 and data:
+            self.digits = (data[0] & 0x07) + 1
+        elif cmd[0] & 0xFC == 0xE4 and data:
+            self.dimming = min(data[0], MAX_DIMMING)
+        elif cmd[0] & 0xFC == 0xE8:
+            self.power_on = cmd[0] & 0x02 == 0
+        elif cmd[0] & 0xFC == 0xEC:
+            self.standby = cmd[0] & 0x01 != 0
+        else:
+            return False
+        return True
+
+    def lit(self):
+        return self.power_on and not self.standby
+
+    def columns(self, digit, rom):
+        code = self.dcram[digit]
+        if code < NUM_CGRAM:
+            return self.cgram[code]
+        return rom.get(code, BOX)
+
+
+def render(panel, rom, now=None, color=False):
+    """Rows of text drawing the panel: 5x7 dots per digit and a decimal point after it."""
+    lit = panel.lit()
+    level = panel.dimming / MAX_DIMMING if lit else 0
+    on_sgr = '\x1b[38;2;%d;%d;%dm' % (int(40 + 60 * level), int(60 + 195 * level), int(60 + 160 * level))
+    hot_sgr = '\x1b[38;2;255;200;40m'
+    off_sgr = '\x1b[38;2;45;45;45m'
+
+    def dot(on, hot):
+        if not color:
+            return '#' if on else '.'
+        if not on:
+            return off_sgr + '·'
+        return (hot_sgr if hot else on_sgr) + '█'
+
+    rows = [''] * GLYPH_ROWS
+    for d in range(NUM_DIGITS):
+        shown = lit and d < panel.digits
+        cols = panel.columns(d, rom)
+        hot = color and now is not None and panel.touched[d] is not None and now - panel.touched[d] < HIGHLIGHT_US
+        for y in range(GLYPH_ROWS):
+            rows[y] += ''.join(dot(shown and cols[x] >> y & 1, hot) for x in range(GLYPH_COLS))
+            point = shown and panel.adram[d] & 0x01 and y == GLYPH_ROWS - 1
+            rows[y] += dot(point, hot) if y == GLYPH_ROWS - 1 else ' '
+            rows[y] += ' '
+    if color:
+        rows = [r.rstrip() + '\x1b[0m' for r in rows]
+    else:
+        rows = [r.rstrip() for r in rows]
+
+    status = 'dim %d/%d' % (panel.dimming, MAX_DIMMING)
+    status += '  ' + ('standby' if panel.standby else 'on' if panel.power_on else 'off')
+    if panel.digits != NUM_DIGITS:
+        status += '  %d digits' % panel.digits
+    return rows + [status]
+
+
+class Window:
+    """Event counts over the last second of simulated time."""
+
+    def __init__(self):
+        self.events = []
+
+    def add(self, now, length, wire, visible, redundant):
+        self.events.append((now, length, wire, visible, redundant))
+        while self.events and self.events[0][0] <= now - 1000000:
+            self.events.pop(0)
+
+    def line(self):
+        txns = len(self.events)
+        nbytes = sum(e[1] for e in self.events)
+        load = sum(e[2] for e in self.events) / 10000
+        frames = sum(1 for e in self.events if e[3])
+        redundant = sum(1 for e in self.events if e[4])
+        text = '%4d upd/s %4d fps %6d B/s  bus %5.1f%%' % (txns, frames, nbytes, load)
+        if redundant:
+            text += '  %d redundant/s' % redundant
+        return text, load >= 80 or redundant * 2 > txns > 0
+
+
+class Totals:
+    def __init__(self):
+        self.txns = 0
+        self.bytes = 0
+        self.wire_us = 0
+        self.frames = 0
+        self.redundant = 0
+        self.unknown = 0
+        self.first = None
+        self.last = 0
+
+    def summary(self):
+        span = max(self.last, 1)
+        return ['transactions %d, bytes %d, wire time %.1f ms, bus load %.1f%% over %.3f s' %
+                (self.txns, self.bytes, self.wire_us / 1000, 100 * self.wire_us / span, span / 1e6),
+                'visible frames %d, redundant commands %d, unknown commands %d' %
+                (self.frames, self.redundant, self.unknown)]
+
+
+def records(files):
+    """Yield (panel, time_us, bytes) from trace lines."""
+    streams = [open(p, encoding='utf-8', errors='replace') for p in files] if files else [sys.stdin]
+    for stream in streams:
+        for line in stream:
+            m = TRACE_RE.search(line)
+            if m and len(m.group(3)) % 2 == 0:
+                yield int(m.group(1)), int(m.group(2)), bytes.fromhex(m.group(3))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('inputs', nargs='*', help='trace files (default: stdin)')
+    parser.add_argument('--panel', type=int, action='append',
+                        help='only show this panel slot (repeatable, default: all traced panels)')
+    parser.add_argument('--snapshot', action='store_true', help='print the final panel contents and statistics')
+    parser.add_argument('--frames', action='store_true', help='print every visible change as plain text')
+    parser.add_argument('--speed', type=float, default=1.0, help='replay speed factor (default 1.0)')
+    parser.add_argument('--clock', type=int, default=CLOCK_HZ, help='SPI clock in Hz (default 500000)')
+    parser.add_argument('--overhead-us', type=int, default=TXN_OVERHEAD_US,
+                        help='time per transaction besides the clocked bytes (default %d)' % TXN_OVERHEAD_US)
+    parser.add_argument('--font', default=os.path.join(os.path.dirname(os.path.abspath(__file__)), '..',
+                                                       'ftb-8-md-font.c'),
+                        help='C source of the ROM glyphs (default: the driver font)')
+    args = parser.parse_args()
+
+    if args.speed <= 0 or args.clock <= 0:
+        fail('--speed and --clock must be positive')
+
+    rom = load_rom(args.font)
+    live = not (args.snapshot or args.frames)
+    panels = {}
+    windows = {}
+    totals = Totals()
+    bus_free = {}
+    wall_start = None
+    drawn_at = None
+    drawn_lines = 0
+    pending = None
+
+    def draw(now, force=False):
+        nonlocal drawn_at, drawn_lines
+        if not force and drawn_at is not None and now - drawn_at < REDRAW_US:
+            return False
+        out = []
+        for slot in sorted(panels):
+            text, storm = windows[slot].line()
+            out.append('\x1b[2Kpanel %d  t=%.3f s  %s%s\x1b[0m' %
+                       (slot, now / 1e6, '\x1b[31m' if storm else '', text))
+            out += ['\x1b[2K' + r for r in render(panels[slot], rom, now, color=True)]
+            out.append('\x1b[2K')
+        sys.stdout.write(('\x1b[%dA' % drawn_lines if drawn_lines else '') + '\n'.join(out) + '\n')
+        sys.stdout.flush()
+        drawn_at = now
+        drawn_lines = len(out)
+        return True
+
+    try:
+        for slot, stamp, cmd in records(args.inputs):
+            if args.panel and slot not in args.panel:
+                continue
+            if not cmd:
+                continue
+            if totals.first is None:
+                totals.first = stamp
+
+            # Commands on one panel cannot overlap on the wire; the trace
+            # stamps when the driver handed a command over
+            t = stamp - totals.first
+            wire = wire_us(len(cmd), args.clock, args.overhead_us)
+            start = max(t, bus_free.get(slot, t))
+            done = start + wire
+            bus_free[slot] = done
+
+            if live:
+                # Show the screen up to now, then wait until the command is through
+                if wall_start is None:
+                    wall_start = time.monotonic()
+                delay = wall_start + done / 1e6 / args.speed - time.monotonic()
+                if delay > 0:
+                    if pending is not None:
+                        draw(pending, force=True)
+                        pending = None
+                    time.sleep(delay)
+
+            panel = panels.setdefault(slot, Panel())
+            window = windows.setdefault(slot, Window())
+            was_lit = panel.lit()
+            before = panel.state()
+            known = panel.apply(cmd, done)
+            after = panel.state()
+            visible = before != after and (was_lit or panel.lit())
+            redundant = known and before == after
+
+            totals.txns += 1
+            totals.bytes += len(cmd)
+            totals.wire_us += wire
+            totals.frames += visible
+            totals.redundant += redundant
+            totals.unknown += not known
+            totals.last = max(totals.last, done)
+            window.add(done, len(cmd), wire, visible, redundant)
+
+            if args.frames and visible:
+                print('panel %d  t=%.6f s' % (slot, done / 1e6))
+                print('\n'.join(render(panel, rom)))
+                print()
+            elif live:
+                pending = None if draw(done) else done
+    except KeyboardInterrupt:
+        pass
+    except BrokenPipeError:
+        return
+
+    if live and panels:
+        draw(totals.last, force=True)
+    if args.snapshot:
+        for slot in sorted(panels):
+            print('panel %d' % slot)
+            print('\n'.join(render(panels[slot], rom)))
+            print()
+    if not live or panels:
+        print('\n'.join(totals.summary()))
+
+
+if __name__ == '__main__':
+    main()